@@ -1,7 +1,11 @@
 // SPDX-License-Identifier: MIT OR MPL-2.0 OR LGPL-2.1-or-later OR GPL-2.0-or-later
 // Copyright 2010, SIL International, All rights reserved.
 
+#include <cstdint>
 #include <cstring>
+#ifndef GRAPHITE2_NSHAREDTABLES
+#include <mutex>
+#endif
 #include "graphite2/Segment.h"
 #include "inc/CmapCache.h"
 #include "inc/debug.h"
@@ -25,6 +29,132 @@ enum compression
     LZ4
 };
 
+#ifndef GRAPHITE2_NSHAREDTABLES
+// Decompressed tables are shared process wide between every Face that
+// loads the same compressed table, so a font opened by many threads is
+// decompressed and held in memory once.  Entries keep a copy of the
+// compressed data they were made from, and a table is only shared with a
+// face whose compressed data is identical byte for byte; the hash merely
+// skips most of the comparisons.  Entries are reference counted by the
+// Face::Table instances pointing into them.
+struct SharedTable
+{
+    SharedTable   * next;
+    uint64_t        key;
+    byte          * cdata;
+    size_t          csize;
+    size_t          size;
+    int             refs;
+
+    bool matches(uint64_t k, const byte * c, size_t n) const
+    {
+        return key == k && csize == n && memcmp(cdata, c, n) == 0;
+    }
+
+    byte * data() { return reinterpret_cast<byte *>(this + 1); }
+    static SharedTable * of(const byte * p) { return reinterpret_cast<SharedTable *>(const_cast<byte *>(p)) - 1; }
+};
+
+SharedTable * shared_tables = 0;
+
+std::mutex & shared_tables_lock()
+{
+    static std::mutex lock;
+    return lock;
+}
+
+uint64_t table_key(const byte * p, size_t n)
+{
+    uint64_t h = 0xcbf29ce484222325ULL;     // FNV-1a
+    for (const byte * const e = p + n; p != e; ++p)
+        h = (h ^ *p) * 0x100000001b3ULL;
+    return h;
+}
+
+byte * alloc_table(size_t n)
+{
+    SharedTable * t = reinterpret_cast<SharedTable *>(gralloc<byte>(sizeof(SharedTable) + n));
+    if (!t) return 0;
+    t->next = 0;
+    t->key = 0;
+    t->cdata = 0;
+    t->csize = 0;
+    t->size = n;
+    t->refs = 1;
+    return t->data();
+}
+
+void free_table(const byte * p)
+{
+    if (!p) return;
+    SharedTable * const t = SharedTable::of(p);
+    {
+        std::lock_guard<std::mutex> guard(shared_tables_lock());
+        if (--t->refs > 0) return;
+        for (SharedTable ** l = &shared_tables; *l; l = &(*l)->next)
+            if (*l == t)
+            {
+                *l = t->next;
+                break;
+            }
+    }
+    free(t->cdata);
+    free(t);
+}
+
+byte * find_table(uint64_t key, const byte * cdata, size_t csize, size_t & size)
+{
+    std::lock_guard<std::mutex> guard(shared_tables_lock());
+    for (SharedTable * t = shared_tables; t; t = t->next)
+        if (t->matches(key, cdata, csize))
+        {
+            ++t->refs;
+            size = t->size;
+            return t->data();
+        }
+    return 0;
+}
+
+// Makes a freshly decompressed table visible to other faces.  If another
+// thread published the same table first, ours is dropped for theirs.  If
+// the compressed data cannot be copied the table stays private to its face.
+byte * publish_table(byte * p, uint64_t key, const byte * cdata, size_t csize)
+{
+    SharedTable * const t = SharedTable::of(p);
+    byte * const c = gralloc<byte>(csize);
+    if (!c) return p;
+    memcpy(c, cdata, csize);
+    {
+        std::lock_guard<std::mutex> guard(shared_tables_lock());
+        for (SharedTable * s = shared_tables; s; s = s->next)
+            if (s->matches(key, cdata, csize))
+            {
+                ++s->refs;
+                p = s->data();
+                break;
+            }
+        if (p == t->data())
+        {
+            t->key = key;
+            t->cdata = c;
+            t->csize = csize;
+            t->next = shared_tables;
+            shared_tables = t;
+            return p;
+        }
+    }
+    free(c);
+    free(t);
+    return p;
+}
+#else
+inline uint64_t table_key(const byte *, size_t) { return 0; }
+inline byte * alloc_table(size_t n) { return gralloc<byte>(n); }
+inline void free_table(const byte * p) { free(const_cast<byte *>(p)); }
+inline byte * find_table(uint64_t, const byte *, size_t, size_t &) { return 0; }
+inline byte * publish_table(byte * p, uint64_t, const byte *, size_t) { return p; }
+#endif
+
 }
 
 Face::Face(const void* appFaceHandle/*non-NULL*/, const gr_face_ops & ops)
@@ -258,7 +388,7 @@ Face::Table::Table(const Face & face, const Tag n, uint32 version) throw()
 void Face::Table::release()
 {
     if (_compressed)
-        free(const_cast<byte *>(_p));
+        free_table(_p);
     else if (_p && _f->m_ops.release_table)
         (*_f->m_ops.release_table)(_f->m_appFaceHandle, _p);
     _p = 0; _sz = 0;
@@ -292,7 +422,14 @@ Error Face::Table::decompress()
     case LZ4:
     {
         uncompressed_size  = hdr & 0x07ffffff;
-        uncompressed_table = gralloc<byte>(uncompressed_size);
+
+        // Another face may already hold this table decompressed.
+        const uint64_t key = table_key(_p, _sz);
+        uncompressed_table = find_table(key, _p, _sz, uncompressed_size);
+        if (uncompressed_table)
+            break;
+
+        uncompressed_table = alloc_table(uncompressed_size);
         if (!e.test(!uncompressed_table || uncompressed_size < 4, E_OUTOFMEM))
         {
             memset(uncompressed_table, 0, 4);   // make sure version number is initialised
@@ -300,6 +437,15 @@ Error Face::Table::decompress()
             // coverity[checked_return : FALSE] - we test e later
             e.test(lz4::decompress(p, _sz - 2*sizeof(uint32), uncompressed_table, uncompressed_size) != signed(uncompressed_size), E_SHRINKERFAILED);
         }
+
+        // Check the uncompressed version number against the original.
+        if (!e)
+            // coverity[forward_null : FALSE] - uncompressed_table has already been tested so can't be null
+            // coverity[checked_return : FALSE] - we test e later
+            e.test(be::peek<uint32>(uncompressed_table) != version, E_SHRINKERFAILED);
+
+        if (!e)
+            uncompressed_table = publish_table(uncompressed_table, key, _p, _sz);
         break;
     }
 
@@ -307,14 +453,16 @@ Error Face::Table::decompress()
         e.error(E_BADSCHEME);
     };
 
-    // Check the uncompressed version number against the original.
-    if (!e)
-        // coverity[forward_null : FALSE] - uncompressed_table has already been tested so can't be null
-        // coverity[checked_return : FALSE] - we test e later
-        e.test(be::peek<uint32>(uncompressed_table) != version, E_SHRINKERFAILED);
-
     // Tell the provider to release the compressed form since were replacing
     //   it anyway.
+    release();
+
+    if (e)
+    {
+        free_table(uncompressed_table);
+        uncompressed_table = 0;
+        uncompressed_size  = 0;
+    }
 
     _p = uncompressed_table;
     _sz = uncompressed_size;
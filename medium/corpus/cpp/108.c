@@ -285,6 +285,28 @@ if (length > maxLen)
 }
 }
 
+// Inverse color transform followed by add-green, in one pass over the pixels.
+void VP8LTransformColorInverseAddGreen_C(const VP8LMultipliers* const m,
+                                         const uint32_t* src, int num_pixels,
+                                         uint32_t* dst) {
+  int i;
+  for (i = 0; i < num_pixels; ++i) {
+    const uint32_t argb = src[i];
+    const int8_t green = (int8_t)(argb >> 8);
+    const uint32_t red = argb >> 16;
+    int new_red = red & 0xff;
+    int new_blue = argb & 0xff;
+    new_red += ColorTransformDelta((int8_t)m->green_to_red_, green);
+    new_red &= 0xff;
+    new_blue += ColorTransformDelta((int8_t)m->green_to_blue_, green);
+    new_blue += ColorTransformDelta((int8_t)m->red_to_blue_, (int8_t)new_red);
+    new_blue &= 0xff;
+    new_red = (new_red + ((argb >> 8) & 0xff)) & 0xff;
+    new_blue = (new_blue + ((argb >> 8) & 0xff)) & 0xff;
+    dst[i] = (argb & 0xff00ff00u) | ((uint32_t)new_red << 16) | new_blue;
+  }
+}
+
 
 // Separate out pixels packed together using pixel-bundling.
 // We define two methods for ARGB data (uint32_t) and alpha-only data (uint8_t).
@@ -475,6 +497,7 @@ VP8LPredictorFunc VP8LPredictors[16];
 VP8LPredictorAddSubFunc VP8LPredictorsAdd_C[16];
 
 VP8LTransformColorInverseFunc VP8LTransformColorInverse;
+VP8LTransformColorInverseFunc VP8LTransformColorInverseAddGreen;
 
 VP8LConvertFunc VP8LConvertBGRAToRGB;
 VP8LConvertFunc VP8LConvertBGRAToRGBA;
@@ -485,9 +508,162 @@ VP8LConvertFunc VP8LConvertBGRAToBGR;
 VP8LMapARGBFunc VP8LMapColor32b;
 VP8LMapAlphaFunc VP8LMapColor8b;
 
+//------------------------------------------------------------------------------
+// Fused inverse transforms.
+//
+// The decoder undoes the transforms of an image in the reverse of their
+// bitstream order, normally sweeping every row once per transform.  When no
+// color-indexing transform is present, the rows keep their width and the
+// predictor, cross-color and subtract-green inverses can instead all be done
+// on each row while it is still in cache.
+
+// Inverse predictor transform of row 'y', from 'in' to 'out', which may be the
+// same row. The row above 'out' must hold the previous predicted row.
+static void PredictorInverseRow(const VP8LTransform* const transform, int y,
+                                const uint32_t* in, uint32_t* out) {
+  const int width = transform->xsize_;
+  if (y == 0) {  // First Row follows the L (mode=1) mode.
+    VP8LPredictorsAdd_C[0](in, NULL, 1, out);
+    VP8LPredictorsAdd[1](in + 1, NULL, width - 1, out + 1);
+  } else {
+    const int tile_width = 1 << transform->bits_;
+    const int mask = tile_width - 1;
+    const int tiles_per_row = VP8LSubSampleSize(width, transform->bits_);
+    const uint32_t* pred_mode_src =
+        transform->data_ + (y >> transform->bits_) * tiles_per_row;
+    int x = 1;
+    // First pixel follows the T (mode=2) mode.
+    VP8LPredictorsAdd_C[2](in, out - width, 1, out);
+    while (x < width) {
+      const VP8LPredictorAddSubFunc pred_func =
+          VP8LPredictorsAdd[((*pred_mode_src++) >> 8) & 0xf];
+      int x_end = (x & ~mask) + tile_width;
+      if (x_end > width) x_end = width;
+      pred_func(in + x, out + x - width, x_end - x, out + x);
+      x = x_end;
+    }
+  }
+}
+
+// Inverse cross-color transform (if 'transform' is not NULL) and add-green
+// (if 'add_green') of row 'y', from 'src' to 'dst'.
+static void ColorInverseRow(const VP8LTransform* const transform,
+                            int add_green, int y, int width,
+                            const uint32_t* src, uint32_t* dst) {
+  if (transform == NULL) {
+    if (add_green) {
+      VP8LAddGreenToBlueAndRed(src, width, dst);
+    } else if (src != dst) {
+      memcpy(dst, src, width * sizeof(*dst));
+    }
+  } else {
+    const VP8LTransformColorInverseFunc inverse =
+        add_green ? VP8LTransformColorInverseAddGreen
+                  : VP8LTransformColorInverse;
+    const int tile_width = 1 << transform->bits_;
+    const int tiles_per_row = VP8LSubSampleSize(width, transform->bits_);
+    const uint32_t* pred =
+        transform->data_ + (y >> transform->bits_) * tiles_per_row;
+    VP8LMultipliers m = { 0, 0, 0 };
+    int x;
+    for (x = 0; x < width; x += tile_width) {
+      const int n = (width - x < tile_width) ? width - x : tile_width;
+      ColorCodeToMultipliers(*pred++, &m);
+      inverse(&m, src + x, n, dst + x);
+    }
+  }
+}
+
+// Runs the color steps 'steps[0..num_steps-1]' on row 'y', from 'src' to
+// 'dst'. A step is a cross-color transform, or NULL for add-green; a
+// cross-color step directly followed by add-green uses the fused kernel.
+static void ColorStepsRow(const VP8LTransform* const* const steps,
+                          int num_steps, int y, int width,
+                          const uint32_t* src, uint32_t* dst) {
+  int i = 0;
+  if (num_steps == 0) {
+    ColorInverseRow(NULL, 0, y, width, src, dst);
+    return;
+  }
+  while (i < num_steps) {
+    if (steps[i] == NULL) {
+      ColorInverseRow(NULL, 1, y, width, src, dst);
+      ++i;
+    } else {
+      const int add_green = (i + 1 < num_steps && steps[i + 1] == NULL);
+      ColorInverseRow(steps[i], add_green, y, width, src, dst);
+      i += 1 + add_green;
+    }
+    src = dst;
+  }
+}
+
+int VP8LInverseTransformRowsFused(const VP8LTransform* const transforms,
+                                  int num_transforms, int y_start, int y_end,
+                                  const uint32_t* in, uint32_t* out,
+                                  uint32_t* dst) {
+  const VP8LTransform* predictor = NULL;
+  const VP8LTransform* before[2];  // color steps undone before the predictor
+  const VP8LTransform* after[2];   // and after it
+  int num_before = 0, num_after = 0;
+  int width, n, y;
+  uint32_t* const out_start = out;
+
+  if (num_transforms <= 0) return 0;
+  // Walk the transforms in decoding order. A bitstream holds each type at
+  // most once, so there are at most two color steps.
+  for (n = num_transforms - 1; n >= 0; --n) {
+    const VP8LTransform* const transform = &transforms[n];
+    if (transform->type_ == PREDICTOR_TRANSFORM && predictor == NULL) {
+      predictor = transform;
+    } else if ((transform->type_ == CROSS_COLOR_TRANSFORM ||
+                transform->type_ == SUBTRACT_GREEN_TRANSFORM) &&
+               num_before + num_after < 2) {
+      const VP8LTransform* const step =
+          (transform->type_ == CROSS_COLOR_TRANSFORM) ? transform : NULL;
+      if (predictor == NULL) {
+        before[num_before++] = step;
+      } else {
+        after[num_after++] = step;
+      }
+    } else {
+      return 0;  // color indexing changes the row width
+    }
+  }
+  width = transforms[0].xsize_;
+  // 'out' keeps the predicted rows, as the top rows of the next ones, so it
+  // cannot alias 'dst'.
+  assert(predictor == NULL || out != dst);
+
+  for (y = y_start; y < y_end; ++y) {
+    if (predictor == NULL) {
+      ColorStepsRow(before, num_before, y, width, in, dst);
+    } else {
+      if (num_before > 0) {
+        ColorStepsRow(before, num_before, y, width, in, out);
+        PredictorInverseRow(predictor, y, out, out);
+      } else {
+        PredictorInverseRow(predictor, y, in, out);
+      }
+      ColorStepsRow(after, num_after, y, width, out, dst);
+    }
+    in += width;
+    out += width;
+    dst += width;
+  }
+  if (predictor != NULL && y_end > y_start && y_end != predictor->ysize_) {
+    // The last predicted row is the top row of the next call's first row.
+    memcpy(out_start - width, out - width, width * sizeof(*out));
+  }
+  return 1;
+}
+
+//------------------------------------------------------------------------------
+
 extern VP8CPUInfo VP8GetCPUInfo;
 extern void VP8LDspInitSSE2(void);
 extern void VP8LDspInitSSE41(void);
+extern void VP8LDspInitAVX2(void);
 extern void VP8LDspInitNEON(void);
 extern void VP8LDspInitMIPSdspR2(void);
 extern void VP8LDspInitMSA(void);
@@ -520,6 +696,7 @@ WEBP_DSP_INIT_FUNC(VP8LDspInit) {
   VP8LAddGreenToBlueAndRed = VP8LAddGreenToBlueAndRed_C;
 
   VP8LTransformColorInverse = VP8LTransformColorInverse_C;
+  VP8LTransformColorInverseAddGreen = VP8LTransformColorInverseAddGreen_C;
 
   VP8LConvertBGRAToRGBA = VP8LConvertBGRAToRGBA_C;
   VP8LConvertBGRAToRGB = VP8LConvertBGRAToRGB_C;
@@ -556,6 +733,11 @@ ret_type.getTypePtr()->getAs<MethodProtoType>();
     LLDB_LOG(log, "Method type wasn't a MethodProtoType");
   }
 
+#if defined(WEBP_HAVE_AVX2)
+  if (VP8GetCPUInfo != NULL && VP8GetCPUInfo(kAVX2)) {
+    VP8LDspInitAVX2();
+  }
+#endif
 #if defined(WEBP_HAVE_NEON)
   if (WEBP_NEON_OMIT_C_CODE ||
       (VP8GetCPUInfo != NULL && VP8GetCPUInfo(kNEON))) {
@@ -565,6 +747,7 @@ ret_type.getTypePtr()->getAs<MethodProtoType>();
 
   assert(VP8LAddGreenToBlueAndRed != NULL);
   assert(VP8LTransformColorInverse != NULL);
+  assert(VP8LTransformColorInverseAddGreen != NULL);
   assert(VP8LConvertBGRAToRGBA != NULL);
   assert(VP8LConvertBGRAToRGB != NULL);
   assert(VP8LConvertBGRAToBGR != NULL);
@@ -72,6 +72,51 @@
 # define HUF_NEED_BMI2_FUNCTION 0
 #endif
 
+/* The AVX2 fast loops decode the four streams in the four 64-bit lanes of a
+ * 256-bit register, using gathers for the table lookups. They are compiled
+ * when AVX2 is enabled statically, or when DYNAMIC_BMI2 lets us add target
+ * attributes. HUF_flags_avx2 selects them. Like HUF_flags_bmi2, it is set
+ * by the caller from a CPU check made once, when the decompression context
+ * is created (see HUF_cpuSupportsAvx2()), never per block.
+ */
+#if HUF_ENABLE_FAST_DECODE && !defined(HUF_DISABLE_AVX2_DECODE) \
+    && defined(__x86_64__) && (defined(__AVX2__) || DYNAMIC_BMI2)
+# define HUF_ENABLE_AVX2_DECODE 1
+# include <immintrin.h>
+# include "../common/cpu.h"       /* ZSTD_cpuid */
+# if defined(__AVX2__)
+#  define HUF_AVX2_ATTRS
+# else
+#  define HUF_AVX2_ATTRS __attribute__((__target__("avx2,bmi2")))
+# endif
+#else
+# define HUF_ENABLE_AVX2_DECODE 0
+#endif
+
+/* Above every other HUF_flags_e value */
+#ifndef HUF_flags_avx2
+# define HUF_flags_avx2 (1 << 30)
+#endif
+
+/* HUF_cpuSupportsAvx2() :
+ * Returns 1 when the AVX2 loops are compiled in and the CPU can run them.
+ * Meant to be called once, at decompression context creation, next to
+ * ZSTD_cpuSupportsBmi2() : the result is then passed down as HUF_flags_avx2
+ * together with HUF_flags_bmi2. */
+int HUF_cpuSupportsAvx2(void)
+{
+#if HUF_ENABLE_AVX2_DECODE
+# if defined(__AVX2__)
+    return 1;
+# else
+    ZSTD_cpuid_t const cpuid = ZSTD_cpuid();
+    return ZSTD_cpuid_avx2(cpuid) && ZSTD_cpuid_bmi2(cpuid);
+# endif
+#else
+    return 0;
+#endif
+}
+
 /* **************************************************************
 *  Error Management
 ****************************************************************/
@@ -338,6 +383,41 @@ static size_t HUF_initRemainingDStream(BIT_DStream_t* bit, HUF_DecompressFastArg
         X(3, (var));                            \
     } while (0)
 
+#if HUF_ENABLE_AVX2_DECODE
+
+/* HUF_AVX2_countConsumed() :
+ * AVX2 has no 64-bit count-trailing-zeros, so the vectorized loops track the
+ * number of bits consumed since the last byte-aligned reload explicitly.
+ * This computes its initial value, which is the position of the marker bit. */
+static HUF_AVX2_ATTRS __m256i HUF_AVX2_countConsumed(U64 const bits[4])
+{
+    return _mm256_setr_epi64x((long long)ZSTD_countTrailingZeros64(bits[0]),
+                              (long long)ZSTD_countTrailingZeros64(bits[1]),
+                              (long long)ZSTD_countTrailingZeros64(bits[2]),
+                              (long long)ZSTD_countTrailingZeros64(bits[3]));
+}
+
+/* HUF_AVX2_reloadStreams() :
+ * Vector equivalent of HUF_4X1_RELOAD_STREAM for all 4 streams :
+ * each input pointer moves back by the number of whole bytes consumed,
+ * 8 bytes are re-read, and the remaining bits are skipped again.
+ * The input pointers are stored as 64-bit lanes. */
+FORCE_INLINE_TEMPLATE HUF_AVX2_ATTRS void
+HUF_AVX2_reloadStreams(__m256i* bits, __m256i* ip, __m256i* nbConsumed, BYTE const* ilowest)
+{
+    __m256i const nbBytes = _mm256_srli_epi64(*nbConsumed, 3);
+    __m256i const nbBits = _mm256_and_si256(*nbConsumed, _mm256_set1_epi64x(7));
+    __m256i offset;
+    *ip = _mm256_sub_epi64(*ip, nbBytes);
+    offset = _mm256_sub_epi64(*ip, _mm256_set1_epi64x((long long)(size_t)ilowest));
+    {   __m256i const data = _mm256_i64gather_epi64((long long const*)(void const*)ilowest, offset, 1);
+        *bits = _mm256_sllv_epi64(_mm256_or_si256(data, _mm256_set1_epi64x(1)), nbBits);
+    }
+    *nbConsumed = nbBits;
+}
+
+#endif /* HUF_ENABLE_AVX2_DECODE */
+
 
 #ifndef HUF_FORCE_DECOMPRESS_X2
 
@@ -630,6 +710,156 @@ if (ID) { // This is not a response.
 }
 
 
+#if HUF_ENABLE_AVX2_DECODE
+
+/* HUF_decompress4X1_usingDTable_internal_fast_avx2_loop() :
+ * Same contract and bounds as HUF_decompress4X1_usingDTable_internal_fast_c_loop(),
+ * but the 4 streams are decoded in the lanes of AVX2 registers.
+ * Each gather reads 4 bytes for a 2-byte HUF_DEltX1, which stays within the
+ * DTable since an X1 table only uses half of its HUF_DTable cells. */
+static HUF_AVX2_ATTRS
+void HUF_decompress4X1_usingDTable_internal_fast_avx2_loop(HUF_DecompressFastArgs* args)
+{
+    U64 bits[4];
+    BYTE const* ip[4];
+    BYTE* op[4];
+    U16 const* const dtable = (U16 const*)args->dt;
+    BYTE* const oend = args->oend;
+    BYTE const* const ilowest = args->ilowest;
+
+    /* Copy the arguments to local variables */
+    ZSTD_memcpy(&bits, &args->bits, sizeof(bits));
+    ZSTD_memcpy((void*)(&ip), &args->ip, sizeof(ip));
+    ZSTD_memcpy(&op, &args->op, sizeof(op));
+
+    assert(MEM_isLittleEndian());
+    assert(!MEM_32bits());
+    assert(sizeof(ip[0]) == sizeof(U64));
+
+    for (;;) {
+        BYTE* olimit;
+        int stream;
+
+        /* Compute olimit, exactly as the C loop does */
+        {
+            /* Each iteration produces 5 output symbols per stream */
+            size_t const oiters = (size_t)(oend - op[3]) / 5;
+            /* Each iteration consumes up to 11 bits * 5 = 55 bits < 7 bytes
+             * per stream.
+             */
+            size_t const iiters = (size_t)(ip[0] - ilowest) / 7;
+            size_t const iters = MIN(oiters, iiters);
+            olimit = op[3] + iters * 5;
+
+            /* Exit fast decoding loop once we reach the end. */
+            if (op[3] == olimit)
+                break;
+
+            /* Exit on corruption : ip[i] >= ip[0] is a loop precondition. */
+            for (stream = 1; stream < 4; ++stream) {
+                if (ip[stream] < ip[stream - 1])
+                    goto _out;
+            }
+        }
+
+        {   __m256i vbits = _mm256_loadu_si256((__m256i const*)(void const*)bits);
+            __m256i vip = _mm256_loadu_si256((__m256i const*)(void const*)ip);
+            __m256i vconsumed = HUF_AVX2_countConsumed(bits);
+            __m256i const nbBitsMask = _mm256_set1_epi64x(0x3F);
+            __m256i const byteMask = _mm256_set1_epi64x(0xFF);
+
+#define HUF_4X1_AVX2_DECODE_SYMBOL(_symbol)                                                 \
+    do {                                                                                    \
+        __m256i const index = _mm256_srli_epi64(vbits, 53);                                 \
+        __m256i const entry = _mm256_cvtepu32_epi64(                                        \
+            _mm256_i64gather_epi32((int const*)(void const*)dtable, index, 2));             \
+        __m256i const nbBits = _mm256_and_si256(entry, nbBitsMask);                         \
+        __m256i const symbol = _mm256_and_si256(_mm256_srli_epi64(entry, 8), byteMask);     \
+        vbits = _mm256_sllv_epi64(vbits, nbBits);                                           \
+        vconsumed = _mm256_add_epi64(vconsumed, nbBits);                                    \
+        symbols = _mm256_or_si256(symbols, _mm256_slli_epi64(symbol, 8 * (_symbol)));       \
+    } while (0)
+
+            do {
+                __m256i symbols = _mm256_setzero_si256();
+                U64 out[4];
+
+                /* Decode 5 symbols in each of the 4 streams */
+                HUF_4X1_AVX2_DECODE_SYMBOL(0);
+                HUF_4X1_AVX2_DECODE_SYMBOL(1);
+                HUF_4X1_AVX2_DECODE_SYMBOL(2);
+                HUF_4X1_AVX2_DECODE_SYMBOL(3);
+                HUF_4X1_AVX2_DECODE_SYMBOL(4);
+
+                /* Write exactly 5 bytes per stream : the last iteration of
+                 * streams 0-2 ends right where the next stream began. */
+                _mm256_storeu_si256((__m256i*)(void*)out, symbols);
+                for (stream = 0; stream < 4; ++stream) {
+                    MEM_write32(op[stream], (U32)out[stream]);
+                    op[stream][4] = (BYTE)(out[stream] >> 32);
+                    op[stream] += 5;
+                }
+
+                /* Reload each of the 4 the bitstreams */
+                HUF_AVX2_reloadStreams(&vbits, &vip, &vconsumed, ilowest);
+            } while (op[3] < olimit);
+
+#undef HUF_4X1_AVX2_DECODE_SYMBOL
+
+            _mm256_storeu_si256((__m256i*)(void*)bits, vbits);
+            _mm256_storeu_si256((__m256i*)(void*)ip, vip);
+        }
+    }
+
+_out:
+
+    /* Save the final values of each of the state variables back to args. */
+    ZSTD_memcpy(&args->bits, &bits, sizeof(bits));
+    ZSTD_memcpy((void*)(&args->ip), &ip, sizeof(ip));
+    ZSTD_memcpy(&args->op, &op, sizeof(op));
+}
+
+#endif /* HUF_ENABLE_AVX2_DECODE */
+
+static size_t HUF_decompress4X1_usingDTable_internal(void* dst, size_t dstSize, void const* cSrc,
+                    size_t cSrcSize, HUF_DTable const* DTable, int flags)
+{
+    HUF_DecompressUsingDTableFn fallbackFn = HUF_decompress4X1_usingDTable_internal_default;
+    HUF_DecompressFastLoopFn loopFn = HUF_decompress4X1_usingDTable_internal_fast_c_loop;
+
+#if DYNAMIC_BMI2
+    if (flags & HUF_flags_bmi2) {
+        fallbackFn = HUF_decompress4X1_usingDTable_internal_bmi2;
+# if ZSTD_ENABLE_ASM_X86_64_BMI2
+        if (!(flags & HUF_flags_disableAsm)) {
+            loopFn = HUF_decompress4X1_usingDTable_internal_fast_asm_loop;
+        }
+# endif
+    } else {
+        return fallbackFn(dst, dstSize, cSrc, cSrcSize, DTable);
+    }
+#endif
+
+#if ZSTD_ENABLE_ASM_X86_64_BMI2 && defined(__BMI2__)
+    if (!(flags & HUF_flags_disableAsm)) {
+        loopFn = HUF_decompress4X1_usingDTable_internal_fast_asm_loop;
+    }
+#endif
+
+#if HUF_ENABLE_AVX2_DECODE
+    if (flags & HUF_flags_avx2) {
+        loopFn = HUF_decompress4X1_usingDTable_internal_fast_avx2_loop;
+    }
+#endif
+
+    if (HUF_ENABLE_FAST_DECODE && !(flags & HUF_flags_disableFast)) {
+        size_t const ret = HUF_decompress4X1_usingDTable_internal_fast(dst, dstSize, cSrc, cSrcSize, DTable, loopFn);
+        if (ret != 0)
+            return ret;
+    }
+    return fallbackFn(dst, dstSize, cSrc, cSrcSize, DTable);
+}
+
 static size_t HUF_decompress4X1_DCtx_wksp(HUF_DTable* dctx, void* dst, size_t dstSize,
                                    const void* cSrc, size_t cSrcSize,
                                    void* workSpace, size_t wkspSize, int flags)
@@ -1253,6 +1483,148 @@ long mbedtls_crypto_signed_info_check(mbedtls_crypto *crypto,
     return mbedtls_crypto_data_or_hash_check(crypto, cert, info, infolen, 0);
 }
 
+#if HUF_ENABLE_AVX2_DECODE
+
+/* HUF_decompress4X2_usingDTable_internal_fast_avx2_loop() :
+ * Same contract and bounds as HUF_decompress4X2_usingDTable_internal_fast_c_loop().
+ * Each iteration decodes 5 entries per stream. The first 4 entries produce
+ * at most 8 bytes, which are assembled in a 64-bit lane and written at once;
+ * the 5th entry is written with a 2-byte store. The iteration therefore never
+ * writes past op + 10, which is the slack the olimit computation guarantees.
+ * Assembling relies on HUF_buildDEltX2U32() leaving the unused second byte of
+ * 1-symbol entries at zero. */
+static HUF_AVX2_ATTRS
+void HUF_decompress4X2_usingDTable_internal_fast_avx2_loop(HUF_DecompressFastArgs* args)
+{
+    U64 bits[4];
+    BYTE const* ip[4];
+    BYTE* op[4];
+    BYTE* oend[4];
+    HUF_DEltX2 const* const dtable = (HUF_DEltX2 const*)args->dt;
+    BYTE const* const ilowest = args->ilowest;
+
+    /* Copy the arguments to local variables */
+    ZSTD_memcpy(&bits, &args->bits, sizeof(bits));
+    ZSTD_memcpy((void*)(&ip), &args->ip, sizeof(ip));
+    ZSTD_memcpy(&op, &args->op, sizeof(op));
+
+    oend[0] = op[1];
+    oend[1] = op[2];
+    oend[2] = op[3];
+    oend[3] = args->oend;
+
+    assert(MEM_isLittleEndian());
+    assert(!MEM_32bits());
+    assert(sizeof(HUF_DEltX2) == sizeof(U32));
+
+    for (;;) {
+        BYTE* olimit;
+        int stream;
+
+        /* Compute olimit, exactly as the C loop does */
+        {
+            /* Each iteration consumes up to 7 bytes of input per stream */
+            size_t iters = (size_t)(ip[0] - ilowest) / 7;
+            /* Each iteration can produce up to 10 bytes of output per stream.
+             * Output streams advance at different rates, so take the minimum.
+             */
+            for (stream = 0; stream < 4; ++stream) {
+                size_t const oiters = (size_t)(oend[stream] - op[stream]) / 10;
+                iters = MIN(iters, oiters);
+            }
+            /* Each iteration produces at least 5 output symbols. */
+            olimit = op[3] + (iters * 5);
+
+            /* Exit the fast decoding loop once we reach the end. */
+            if (op[3] == olimit)
+                break;
+
+            /* Exit on corruption : ip[i] >= ip[0] is a loop precondition. */
+            for (stream = 1; stream < 4; ++stream) {
+                if (ip[stream] < ip[stream - 1])
+                    goto _out;
+            }
+        }
+
+        {   __m256i vbits = _mm256_loadu_si256((__m256i const*)(void const*)bits);
+            __m256i vip = _mm256_loadu_si256((__m256i const*)(void const*)ip);
+            __m256i vconsumed = HUF_AVX2_countConsumed(bits);
+            __m256i const nbBitsMask = _mm256_set1_epi64x(0x3F);
+            __m256i const byteMask = _mm256_set1_epi64x(0xFF);
+            __m256i const sequenceMask = _mm256_set1_epi64x(0xFFFF);
+
+#define HUF_4X2_AVX2_DECODE_ENTRY(_sequence, _length)                                       \
+    do {                                                                                    \
+        __m256i const index = _mm256_srli_epi64(vbits, 53);                                 \
+        __m256i const entry = _mm256_cvtepu32_epi64(                                        \
+            _mm256_i64gather_epi32((int const*)(void const*)dtable, index, 4));             \
+        __m256i const nbBits = _mm256_and_si256(_mm256_srli_epi64(entry, 16), nbBitsMask);  \
+        (_sequence) = _mm256_and_si256(entry, sequenceMask);                                \
+        (_length) = _mm256_and_si256(_mm256_srli_epi64(entry, 24), byteMask);               \
+        vbits = _mm256_sllv_epi64(vbits, nbBits);                                           \
+        vconsumed = _mm256_add_epi64(vconsumed, nbBits);                                    \
+    } while (0)
+
+#define HUF_4X2_AVX2_DECODE_ACCUMULATE()                                                    \
+    do {                                                                                    \
+        __m256i sequence, length;                                                           \
+        HUF_4X2_AVX2_DECODE_ENTRY(sequence, length);                                        \
+        sequences = _mm256_or_si256(sequences,                                              \
+            _mm256_sllv_epi64(sequence, _mm256_slli_epi64(nbBytes, 3)));                    \
+        nbBytes = _mm256_add_epi64(nbBytes, length);                                        \
+    } while (0)
+
+            do {
+                __m256i sequences = _mm256_setzero_si256();
+                __m256i nbBytes = _mm256_setzero_si256();
+                U64 out[4];
+                U64 outLength[4];
+
+                /* Decode 4 entries in each of the 4 streams : <= 8 bytes */
+                HUF_4X2_AVX2_DECODE_ACCUMULATE();
+                HUF_4X2_AVX2_DECODE_ACCUMULATE();
+                HUF_4X2_AVX2_DECODE_ACCUMULATE();
+                HUF_4X2_AVX2_DECODE_ACCUMULATE();
+                _mm256_storeu_si256((__m256i*)(void*)out, sequences);
+                _mm256_storeu_si256((__m256i*)(void*)outLength, nbBytes);
+                for (stream = 0; stream < 4; ++stream) {
+                    MEM_write64(op[stream], out[stream]);
+                    op[stream] += outLength[stream];
+                }
+
+                /* Decode the 5th entry */
+                {   __m256i sequence, length;
+                    HUF_4X2_AVX2_DECODE_ENTRY(sequence, length);
+                    _mm256_storeu_si256((__m256i*)(void*)out, sequence);
+                    _mm256_storeu_si256((__m256i*)(void*)outLength, length);
+                }
+                for (stream = 0; stream < 4; ++stream) {
+                    MEM_write16(op[stream], (U16)out[stream]);
+                    op[stream] += outLength[stream];
+                }
+
+                /* Reload each of the 4 the bitstreams */
+                HUF_AVX2_reloadStreams(&vbits, &vip, &vconsumed, ilowest);
+            } while (op[3] < olimit);
+
+#undef HUF_4X2_AVX2_DECODE_ACCUMULATE
+#undef HUF_4X2_AVX2_DECODE_ENTRY
+
+            _mm256_storeu_si256((__m256i*)(void*)bits, vbits);
+            _mm256_storeu_si256((__m256i*)(void*)ip, vip);
+        }
+    }
+
+_out:
+
+    /* Save the final values of each of the state variables back to args. */
+    ZSTD_memcpy(&args->bits, &bits, sizeof(bits));
+    ZSTD_memcpy((void*)(&args->ip), &ip, sizeof(ip));
+    ZSTD_memcpy(&args->op, &op, sizeof(op));
+}
+
+#endif /* HUF_ENABLE_AVX2_DECODE */
+
 #if ZSTD_ENABLE_ASM_X86_64_BMI2
 
 HUF_ASM_DECL void HUF_decompress4X2_usingDTable_internal_fast_asm_loop(HUF_DecompressFastArgs* args) ZSTDLIB_HIDDEN;
@@ -1333,6 +1705,12 @@ static size_t HUF_decompress4X2_usingDTable_internal(void* dst, size_t dstSize,
     }
 #endif
 
+#if HUF_ENABLE_AVX2_DECODE
+    if (flags & HUF_flags_avx2) {
+        loopFn = HUF_decompress4X2_usingDTable_internal_fast_avx2_loop;
+    }
+#endif
+
     if (HUF_ENABLE_FAST_DECODE && !(flags & HUF_flags_disableFast)) {
         size_t const ret = HUF_decompress4X2_usingDTable_internal_fast(dst, dstSize, cSrc, cSrcSize, DTable, loopFn);
         if (ret != 0)
@@ -1464,6 +1842,9 @@ size_t HUF_decompress4X_hufOnly_wksp(HUF_DTable* dctx, void* dst, size_t dstSize
     if (dstSize == 0) return ERROR(dstSize_tooSmall);
     if (cSrcSize == 0) return ERROR(corruption_detected);
 
+#if HUF_ENABLE_AVX2_DECODE && defined(__AVX2__)
+    flags |= HUF_flags_avx2;
+#endif
     {   U32 const algoNb = HUF_selectDecoder(dstSize, cSrcSize);
 #if defined(HUF_FORCE_DECOMPRESS_X1)
         (void)algoNb;
@@ -15,6 +15,22 @@
 #ifdef PNG_SIMPLIFIED_WRITE_STDIO_SUPPORTED
 #  include <errno.h>
 #endif /* SIMPLIFIED_WRITE_STDIO */
+#ifdef PNG_SIMPLIFIED_WRITE_PARALLEL_SUPPORTED
+#  include <pthread.h>
+#  if defined(__SSE2__) || defined(_M_X64) || \
+      (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#    include <emmintrin.h>
+#    define PNG_PARALLEL_SSE2 1
+#    define PNG_PARALLEL_NEON 0
+#  elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#    include <arm_neon.h>
+#    define PNG_PARALLEL_SSE2 0
+#    define PNG_PARALLEL_NEON 1
+#  else
+#    define PNG_PARALLEL_SSE2 0
+#    define PNG_PARALLEL_NEON 0
+#  endif
+#endif /* SIMPLIFIED_WRITE_PARALLEL */
 
 #ifdef PNG_WRITE_SUPPORTED
 
@@ -760,6 +776,925 @@ png_image_set_PLTE(png_image_write_control *display)
    image->colormap_entries = (png_uint_32)entries;
 }
 
+#ifdef PNG_SIMPLIFIED_WRITE_PARALLEL_SUPPORTED
+/* Parallel IDAT encoding for the simplified API.
+ *
+ * The rows are split into groups that are filtered, then deflated, on worker
+ * threads.  Each group is compressed as raw deflate data primed with the 32K
+ * of filtered data that precede it and ended with a sync flush, so that the
+ * concatenation of the groups is a single deflate stream.  The zlib header
+ * and the Adler-32 of the whole data (combined from the per-group values) are
+ * added around it, so the IDAT chunks contain one valid zlib stream.  The
+ * compressed bytes differ from the serial writer's output; the image data
+ * does not.
+ *
+ * This is only used where png_write_row would write the application rows
+ * unchanged: 8-bit data, no pending transformations and no interlacing.
+ * Nothing is written until every group has been compressed, so any failure
+ * falls back to the serial path.
+ */
+#ifndef PNG_PARALLEL_WRITE_THREADS
+#  define PNG_PARALLEL_WRITE_THREADS 4
+#endif
+#ifndef PNG_PARALLEL_WRITE_GROUP_BYTES
+#  define PNG_PARALLEL_WRITE_GROUP_BYTES 262144
+#endif
+/* 16-byte blocks sampled per row by the fast adaptive selection, at most 15
+ * so that the counts fit in a byte.
+ */
+#ifndef PNG_PARALLEL_SAMPLE_BLOCKS
+#  define PNG_PARALLEL_SAMPLE_BLOCKS 8
+#endif
+
+typedef struct
+{
+   png_const_bytep  first_row;   /* as display->first_row */
+   ptrdiff_t        row_stride;  /* as display->row_bytes */
+   size_t           row_bytes;   /* bytes of pixel data in a row */
+   unsigned int     bpp;         /* bytes per complete pixel */
+   int              do_filter;   /* PNG_FILTER_ mask to choose from */
+   int              selection;   /* PNG_FILTER_SELECTION_ method */
+   png_uint_32      height;
+   png_uint_32      group_rows;  /* rows in each group but the last */
+   unsigned int     groups;
+   unsigned int     threads;
+   int              level;       /* zlib parameters of the IDAT stream */
+   int              mem_level;
+   int              strategy;
+   int              window_bits;
+   png_const_bytep  zero_row;    /* previous row of the first row */
+   png_bytep        scratch;     /* 4 candidate rows per thread */
+   png_bytep        filtered;    /* height * (row_bytes+1) filtered bytes */
+   png_bytep       *out;         /* compressed data of each group */
+   size_t          *out_size;    /* in: capacity, out: bytes written */
+   png_uint_32     *adler;       /* Adler-32 of each group */
+   png_structrp     png_ptr;
+   int              phase;       /* PNG_PARALLEL_ phase being run */
+   unsigned int     started;     /* threads running, the caller included */
+   unsigned int     generation;  /* incremented when a phase starts */
+   unsigned int     finished;    /* threads done with the current phase */
+   pthread_mutex_t  lock;
+   pthread_cond_t   start;
+   pthread_cond_t   done;
+} png_parallel_write;
+
+#define PNG_PARALLEL_FILTER  0
+#define PNG_PARALLEL_DEFLATE 1
+#define PNG_PARALLEL_EXIT    2
+
+typedef struct
+{
+   png_parallel_write *job;
+   unsigned int        index;
+   int                 failed;
+} png_parallel_worker;
+
+static png_byte
+png_parallel_paeth(unsigned int a, unsigned int b, unsigned int c)
+{
+   int pa = abs((int)b - (int)c);
+   int pb = abs((int)a - (int)c);
+   int pc = abs((int)a + (int)b - 2 * (int)c);
+
+   if (pa <= pb && pa <= pc)
+      return (png_byte)a;
+
+   return (png_byte)(pb <= pc ? b : c);
+}
+
+/* Filter one byte; used for the bytes of a row the vector code does not
+ * cover and for the samples of the fast adaptive estimate.  'a' is taken
+ * from the unfiltered row, so every filter can be computed independently.
+ */
+static png_byte
+png_parallel_filter_byte(int value, png_const_bytep row, png_const_bytep prev,
+    size_t i, unsigned int bpp)
+{
+   unsigned int a = i >= bpp ? row[i - bpp] : 0;
+   unsigned int b = prev[i];
+   unsigned int c = i >= bpp ? prev[i - bpp] : 0;
+   unsigned int p;
+
+   switch (value)
+   {
+      case PNG_FILTER_VALUE_SUB:
+         p = a;
+         break;
+
+      case PNG_FILTER_VALUE_UP:
+         p = b;
+         break;
+
+      case PNG_FILTER_VALUE_AVG:
+         p = (a + b) >> 1;
+         break;
+
+      case PNG_FILTER_VALUE_PAETH:
+         p = png_parallel_paeth(a, b, c);
+         break;
+
+      default:
+         p = 0;
+         break;
+   }
+
+   return (png_byte)(row[i] - p);
+}
+
+#if PNG_PARALLEL_SSE2
+/* |v| of the bytes taken as signed, as unsigned bytes: min(v, -v). */
+#  define png_parallel_abs8(v) \
+   _mm_min_epu8((v), _mm_sub_epi8(_mm_setzero_si128(), (v)))
+
+static __m128i
+png_parallel_paeth_sse2(__m128i a, __m128i b, __m128i c)
+{
+   /* pa = |b-c| and pb = |a-c| fit in a byte; pc = |a+b-2c| does not, but
+    * saturating it to 255 does not change any of the comparisons because pa
+    * and pb are at most 255.
+    */
+   const __m128i zero = _mm_setzero_si128();
+   __m128i pa = _mm_or_si128(_mm_subs_epu8(b, c), _mm_subs_epu8(c, b));
+   __m128i pb = _mm_or_si128(_mm_subs_epu8(a, c), _mm_subs_epu8(c, a));
+   __m128i lo = _mm_sub_epi16(_mm_add_epi16(_mm_unpacklo_epi8(a, zero),
+       _mm_unpacklo_epi8(b, zero)), _mm_slli_epi16(_mm_unpacklo_epi8(c, zero),
+       1));
+   __m128i hi = _mm_sub_epi16(_mm_add_epi16(_mm_unpackhi_epi8(a, zero),
+       _mm_unpackhi_epi8(b, zero)), _mm_slli_epi16(_mm_unpackhi_epi8(c, zero),
+       1));
+   __m128i pc, use_a, use_b;
+
+   lo = _mm_max_epi16(lo, _mm_sub_epi16(zero, lo));
+   hi = _mm_max_epi16(hi, _mm_sub_epi16(zero, hi));
+   pc = _mm_packus_epi16(lo, hi);
+
+   /* x <= y is min(x, y) == x for unsigned bytes */
+   use_a = _mm_cmpeq_epi8(_mm_min_epu8(pa, _mm_min_epu8(pb, pc)), pa);
+   use_b = _mm_cmpeq_epi8(_mm_min_epu8(pb, pc), pb);
+   b = _mm_or_si128(_mm_and_si128(use_b, b), _mm_andnot_si128(use_b, c));
+
+   return _mm_or_si128(_mm_and_si128(use_a, a), _mm_andnot_si128(use_a, b));
+}
+#endif /* SSE2 */
+
+#if PNG_PARALLEL_NEON
+static uint8x16_t
+png_parallel_paeth_neon(uint8x16_t a, uint8x16_t b, uint8x16_t c)
+{
+   /* As the SSE2 version, pc saturates to 255 without changing the result. */
+   uint8x16_t pa = vabdq_u8(b, c);
+   uint8x16_t pb = vabdq_u8(a, c);
+   int16x8_t lo = vreinterpretq_s16_u16(vaddq_u16(vsubl_u8(vget_low_u8(a),
+       vget_low_u8(c)), vsubl_u8(vget_low_u8(b), vget_low_u8(c))));
+   int16x8_t hi = vreinterpretq_s16_u16(vaddq_u16(vsubl_u8(vget_high_u8(a),
+       vget_high_u8(c)), vsubl_u8(vget_high_u8(b), vget_high_u8(c))));
+   uint8x16_t pc = vcombine_u8(vqmovn_u16(vreinterpretq_u16_s16(vabsq_s16(lo))),
+       vqmovn_u16(vreinterpretq_u16_s16(vabsq_s16(hi))));
+   uint8x16_t use_a = vcleq_u8(pa, vminq_u8(pb, pc));
+   uint8x16_t use_b = vcleq_u8(pb, pc);
+
+   return vbslq_u8(use_a, a, vbslq_u8(use_b, b, c));
+}
+#endif /* NEON */
+
+/* Filter row_bytes bytes of row with the given filter, writing them to out.
+ * The first bpp bytes and the tail are done a byte at a time.
+ */
+static void
+png_parallel_filter(int value, png_bytep out, png_const_bytep row,
+    png_const_bytep prev, unsigned int bpp, size_t row_bytes)
+{
+   size_t i = 0;
+
+   if (value == PNG_FILTER_VALUE_NONE)
+   {
+      memcpy(out, row, row_bytes);
+      return;
+   }
+
+   for (; i < bpp && i < row_bytes; ++i)
+      out[i] = png_parallel_filter_byte(value, row, prev, i, bpp);
+
+#if PNG_PARALLEL_SSE2
+   for (; i + 16 <= row_bytes; i += 16)
+   {
+      __m128i x = _mm_loadu_si128((const __m128i*)(row + i));
+      __m128i a = _mm_loadu_si128((const __m128i*)(row + i - bpp));
+      __m128i b = _mm_loadu_si128((const __m128i*)(prev + i));
+      __m128i p;
+
+      switch (value)
+      {
+         case PNG_FILTER_VALUE_SUB:
+            p = a;
+            break;
+
+         case PNG_FILTER_VALUE_UP:
+            p = b;
+            break;
+
+         case PNG_FILTER_VALUE_AVG:
+            /* _mm_avg_epu8 rounds up, the PNG average rounds down */
+            p = _mm_sub_epi8(_mm_avg_epu8(a, b), _mm_and_si128(
+                _mm_xor_si128(a, b), _mm_set1_epi8(1)));
+            break;
+
+         default:
+            p = png_parallel_paeth_sse2(a, b,
+                _mm_loadu_si128((const __m128i*)(prev + i - bpp)));
+            break;
+      }
+
+      _mm_storeu_si128((__m128i*)(out + i), _mm_sub_epi8(x, p));
+   }
+#elif PNG_PARALLEL_NEON
+   for (; i + 16 <= row_bytes; i += 16)
+   {
+      uint8x16_t x = vld1q_u8(row + i);
+      uint8x16_t a = vld1q_u8(row + i - bpp);
+      uint8x16_t b = vld1q_u8(prev + i);
+      uint8x16_t p;
+
+      switch (value)
+      {
+         case PNG_FILTER_VALUE_SUB:
+            p = a;
+            break;
+
+         case PNG_FILTER_VALUE_UP:
+            p = b;
+            break;
+
+         case PNG_FILTER_VALUE_AVG:
+            p = vhaddq_u8(a, b);
+            break;
+
+         default:
+            p = png_parallel_paeth_neon(a, b, vld1q_u8(prev + i - bpp));
+            break;
+      }
+
+      vst1q_u8(out + i, vsubq_u8(x, p));
+   }
+#endif
+
+   for (; i < row_bytes; ++i)
+      out[i] = png_parallel_filter_byte(value, row, prev, i, bpp);
+}
+
+/* The sum of the absolute values of the filtered bytes taken as signed, the
+ * heuristic png_write_find_filter uses to select a filter.
+ */
+static png_alloc_size_t
+png_parallel_row_sum(png_const_bytep row, size_t row_bytes)
+{
+   png_alloc_size_t sum = 0;
+   size_t i = 0;
+
+#if PNG_PARALLEL_SSE2
+   {
+      __m128i acc = _mm_setzero_si128();
+
+      for (; i + 16 <= row_bytes; i += 16)
+      {
+         __m128i v = _mm_loadu_si128((const __m128i*)(row + i));
+
+         acc = _mm_add_epi64(acc, _mm_sad_epu8(png_parallel_abs8(v),
+             _mm_setzero_si128()));
+      }
+
+      sum = (png_alloc_size_t)_mm_cvtsi128_si32(acc) +
+          (png_alloc_size_t)_mm_cvtsi128_si32(_mm_srli_si128(acc, 8));
+   }
+#elif PNG_PARALLEL_NEON
+   {
+      uint32x4_t acc = vdupq_n_u32(0);
+
+      for (; i + 16 <= row_bytes; i += 16)
+      {
+         uint8x16_t v = vld1q_u8(row + i);
+
+         v = vminq_u8(v, vsubq_u8(vdupq_n_u8(0), v));
+         acc = vpadalq_u16(acc, vpaddlq_u8(v));
+      }
+
+      sum = (png_alloc_size_t)vgetq_lane_u32(acc, 0) + vgetq_lane_u32(acc, 1) +
+          vgetq_lane_u32(acc, 2) + vgetq_lane_u32(acc, 3);
+   }
+#endif
+
+   for (; i < row_bytes; ++i)
+   {
+      unsigned int v = row[i];
+      sum += v < 128 ? v : 256 - v;
+   }
+
+   return sum;
+}
+
+/* 16 * log2(x) for x < 32, rounded. */
+static const png_byte png_parallel_log2_16[32] =
+{
+    0,  0, 16, 25, 32, 37, 41, 45, 48, 51, 53, 55, 57, 59, 61, 63,
+   64, 65, 67, 68, 69, 70, 71, 72, 73, 74, 75, 76, 77, 78, 79, 79
+};
+
+static png_uint_32
+png_parallel_log2(png_uint_32 x)
+{
+   png_uint_32 shift = 0;
+
+   while (x >= 32)
+   {
+      x >>= 1;
+      shift += 16;
+   }
+
+   return shift + png_parallel_log2_16[x];
+}
+
+/* An estimate of the compressed size of a row with the given filter: the
+ * zero-order entropy, in sixteenths of a bit, of the bytes of
+ * PNG_PARALLEL_SAMPLE_BLOCKS 16-byte blocks spread over the row.  Unlike the
+ * sum of absolute differences this rewards filters that make the data
+ * repetitive, not just small, and only a fraction of the row is filtered.
+ */
+static png_uint_32
+png_parallel_filter_cost(int value, png_const_bytep row, png_const_bytep prev,
+    unsigned int bpp, size_t row_bytes)
+{
+   png_byte count[256];
+   png_byte seen[16 * PNG_PARALLEL_SAMPLE_BLOCKS];
+   size_t blocks = row_bytes / 16;
+   size_t step = blocks > PNG_PARALLEL_SAMPLE_BLOCKS ?
+       blocks / PNG_PARALLEL_SAMPLE_BLOCKS : 1;
+   size_t i, block;
+   unsigned int n = 0, distinct = 0, k;
+   png_uint_32 cost;
+
+   memset(count, 0, (sizeof count));
+
+   for (block = 0; block < blocks && n < (sizeof seen); block += step)
+      for (i = block * 16; i < block * 16 + 16; ++i, ++n)
+      {
+         png_byte v = png_parallel_filter_byte(value, row, prev, i, bpp);
+
+         if (count[v]++ == 0)
+            seen[distinct++] = v;
+      }
+
+   /* Rows shorter than one block are sampled completely. */
+   for (i = blocks * 16; n == 0 && i < row_bytes; ++i)
+   {
+      png_byte v = png_parallel_filter_byte(value, row, prev, i, bpp);
+
+      if (count[v]++ == 0)
+         seen[distinct++] = v;
+   }
+
+   if (n == 0)
+      n = (unsigned int)row_bytes;
+
+   /* n * log2(n) - sum(count * log2(count)) */
+   cost = n * png_parallel_log2(n);
+   for (k = 0; k < distinct; ++k)
+      cost -= count[seen[k]] * png_parallel_log2(count[seen[k]]);
+
+   return cost;
+}
+
+static void
+png_parallel_filter_row(png_parallel_write *job, png_bytep out,
+    png_const_bytep row, png_const_bytep prev, png_bytep scratch)
+{
+   static const int filters[5] =
+   {
+      PNG_FILTER_VALUE_NONE, PNG_FILTER_VALUE_SUB, PNG_FILTER_VALUE_UP,
+      PNG_FILTER_VALUE_AVG, PNG_FILTER_VALUE_PAETH
+   };
+   size_t row_bytes = job->row_bytes;
+   unsigned int bpp = job->bpp;
+   int do_filter = job->do_filter & PNG_ALL_FILTERS;
+   png_bytep best = NULL;
+   png_alloc_size_t best_sum = PNG_SIZE_MAX;
+   int f;
+
+   /* As png_set_filter, an empty mask means no filtering. */
+   if (do_filter == 0)
+      do_filter = PNG_FILTER_NONE;
+
+   /* A single filter needs no selection. */
+   if ((do_filter & (do_filter - 1)) == 0)
+   {
+      for (f = 0; (do_filter & (PNG_FILTER_NONE << f)) == 0; ++f) ;
+      out[0] = (png_byte)filters[f];
+      png_parallel_filter(filters[f], out + 1, row, prev, bpp, row_bytes);
+      return;
+   }
+
+   if (job->selection == PNG_FILTER_SELECTION_FAST_ADAPTIVE)
+   {
+      png_uint_32 best_cost = 0xffffffffU;
+      int best_f = 0;
+
+      for (f = 0; f < 5; ++f)
+         if ((do_filter & (PNG_FILTER_NONE << f)) != 0)
+         {
+            png_uint_32 cost = png_parallel_filter_cost(filters[f], row, prev,
+                bpp, row_bytes);
+
+            if (cost < best_cost)
+            {
+               best_cost = cost;
+               best_f = f;
+            }
+         }
+
+      out[0] = (png_byte)filters[best_f];
+      png_parallel_filter(filters[best_f], out + 1, row, prev, bpp,
+          row_bytes);
+      return;
+   }
+
+   /* Otherwise try every filter and keep the smallest sum, as
+    * png_write_find_filter does; 'none' is written straight to out, the
+    * others to the scratch rows.
+    */
+   for (f = 0; f < 5; ++f)
+      if ((do_filter & (PNG_FILTER_NONE << f)) != 0)
+      {
+         png_bytep dp = f == 0 ? out : scratch + (f - 1) * (row_bytes + 1);
+         png_alloc_size_t sum;
+
+         dp[0] = (png_byte)filters[f];
+         png_parallel_filter(filters[f], dp + 1, row, prev, bpp, row_bytes);
+         sum = png_parallel_row_sum(dp + 1, row_bytes);
+
+         if (sum < best_sum)
+         {
+            best_sum = sum;
+            best = dp;
+         }
+      }
+
+   if (best != out)
+      memcpy(out, best, row_bytes + 1);
+}
+
+/* Run the current phase of job on the groups of worker. */
+static void
+png_parallel_write_groups(png_parallel_worker *worker)
+{
+   png_parallel_write *job = worker->job;
+   size_t filtered_bytes = job->row_bytes + 1;
+   unsigned int g;
+
+   for (g = worker->index; g < job->groups; g += job->threads)
+   {
+      png_uint_32 y = g * job->group_rows;
+      png_uint_32 y_end = g + 1 == job->groups ? job->height :
+          y + job->group_rows;
+      png_bytep start = job->filtered + y * filtered_bytes;
+      size_t length = (y_end - y) * filtered_bytes;
+
+      if (job->phase == PNG_PARALLEL_FILTER)
+      {
+         png_bytep scratch = job->scratch +
+             worker->index * 4 * filtered_bytes;
+
+         for (; y < y_end; ++y)
+         {
+            png_const_bytep row = job->first_row + y * job->row_stride;
+            png_const_bytep prev = y > 0 ? row - job->row_stride :
+                job->zero_row;
+
+            png_parallel_filter_row(job, job->filtered + y * filtered_bytes,
+                row, prev, scratch);
+         }
+
+         job->adler[g] = (png_uint_32)adler32(adler32(0, NULL, 0), start,
+             (uInt)length);
+      }
+
+      else
+      {
+         z_stream z;
+         int last = g + 1 == job->groups;
+         int ret;
+
+         memset(&z, 0, (sizeof z));
+         if (deflateInit2(&z, job->level, Z_DEFLATED, -job->window_bits,
+             job->mem_level, job->strategy) != Z_OK)
+         {
+            worker->failed = 1;
+            break;
+         }
+
+         if (g > 0)
+         {
+            size_t dict = (size_t)1 << job->window_bits;
+
+            if (dict > (size_t)(start - job->filtered))
+               dict = (size_t)(start - job->filtered);
+
+            ret = deflateSetDictionary(&z, start - dict, (uInt)dict);
+         }
+
+         else
+            ret = Z_OK;
+
+         if (ret == Z_OK)
+         {
+            z.next_in = start;
+            z.avail_in = (uInt)length;
+            z.next_out = job->out[g];
+            z.avail_out = (uInt)job->out_size[g];
+            ret = deflate(&z, last ? Z_FINISH : Z_SYNC_FLUSH);
+
+            if (ret == (last ? Z_STREAM_END : Z_OK) && z.avail_in == 0 &&
+                (last || z.avail_out > 0))
+               job->out_size[g] -= z.avail_out;
+
+            else
+               worker->failed = 1;
+         }
+
+         else
+            worker->failed = 1;
+
+         deflateEnd(&z);
+         if (worker->failed != 0)
+            break;
+      }
+   }
+}
+
+/* The worker threads are started once and run each phase when the caller
+ * increments job->generation, until the phase is PNG_PARALLEL_EXIT.
+ */
+static void *
+png_parallel_write_thread(void *argument)
+{
+   png_parallel_worker *worker = png_voidcast(png_parallel_worker*, argument);
+   png_parallel_write *job = worker->job;
+   unsigned int generation = 0;
+
+   for (;;)
+   {
+      pthread_mutex_lock(&job->lock);
+      while (job->generation == generation)
+         pthread_cond_wait(&job->start, &job->lock);
+      generation = job->generation;
+      pthread_mutex_unlock(&job->lock);
+
+      if (job->phase == PNG_PARALLEL_EXIT)
+         return NULL;
+
+      png_parallel_write_groups(worker);
+
+      pthread_mutex_lock(&job->lock);
+      ++job->finished;
+      pthread_cond_signal(&job->done);
+      pthread_mutex_unlock(&job->lock);
+   }
+}
+
+/* Start the worker threads.  The groups of threads that cannot be started
+ * are run by the calling thread, so this cannot fail.
+ */
+static void
+png_parallel_write_start(png_parallel_write *job, png_parallel_worker *workers,
+    pthread_t *threads)
+{
+   unsigned int t;
+
+   for (t = 0; t < job->threads; ++t)
+   {
+      workers[t].job = job;
+      workers[t].index = t;
+      workers[t].failed = 0;
+   }
+
+   job->started = 1;
+   job->generation = 0;
+   if (job->threads < 2 || pthread_mutex_init(&job->lock, NULL) != 0)
+      return;
+
+   if (pthread_cond_init(&job->start, NULL) != 0)
+   {
+      pthread_mutex_destroy(&job->lock);
+      return;
+   }
+
+   if (pthread_cond_init(&job->done, NULL) != 0)
+   {
+      pthread_cond_destroy(&job->start);
+      pthread_mutex_destroy(&job->lock);
+      return;
+   }
+
+   for (; job->started < job->threads; ++job->started)
+      if (pthread_create(&threads[job->started], NULL,
+          png_parallel_write_thread, &workers[job->started]) != 0)
+         break;
+
+   if (job->started == 1)
+   {
+      pthread_cond_destroy(&job->done);
+      pthread_cond_destroy(&job->start);
+      pthread_mutex_destroy(&job->lock);
+   }
+}
+
+/* Run one phase on the started threads, the calling thread doing the groups
+ * of worker 0 and of any thread that could not be started.  Returns 0 if any
+ * worker failed.
+ */
+static int
+png_parallel_write_run(png_parallel_write *job, png_parallel_worker *workers,
+    int phase)
+{
+   unsigned int t;
+   int ok = 1;
+
+   for (t = 0; t < job->threads; ++t)
+      workers[t].failed = 0;
+
+   if (job->started > 1)
+   {
+      pthread_mutex_lock(&job->lock);
+      job->phase = phase;
+      job->finished = 0;
+      ++job->generation;
+      pthread_cond_broadcast(&job->start);
+      pthread_mutex_unlock(&job->lock);
+   }
+
+   else
+      job->phase = phase;
+
+   for (t = job->started; t < job->threads; ++t)
+      png_parallel_write_groups(&workers[t]);
+
+   png_parallel_write_groups(&workers[0]);
+
+   if (job->started > 1)
+   {
+      pthread_mutex_lock(&job->lock);
+      while (job->finished < job->started - 1)
+         pthread_cond_wait(&job->done, &job->lock);
+      pthread_mutex_unlock(&job->lock);
+   }
+
+   for (t = 0; t < job->threads; ++t)
+      if (workers[t].failed != 0)
+         ok = 0;
+
+   return ok;
+}
+
+/* Stop the worker threads; this does nothing if none are running. */
+static void
+png_parallel_write_stop(png_parallel_write *job, pthread_t *threads)
+{
+   unsigned int t;
+
+   if (job->started < 2)
+      return;
+
+   pthread_mutex_lock(&job->lock);
+   job->phase = PNG_PARALLEL_EXIT;
+   ++job->generation;
+   pthread_cond_broadcast(&job->start);
+   pthread_mutex_unlock(&job->lock);
+
+   for (t = 1; t < job->started; ++t)
+      pthread_join(threads[t], NULL);
+
+   pthread_cond_destroy(&job->done);
+   pthread_cond_destroy(&job->start);
+   pthread_mutex_destroy(&job->lock);
+   job->started = 1;
+}
+
+/* Write the compressed groups as IDAT chunks.  This is run through
+ * png_safe_execute so that an error while writing returns to
+ * png_image_write_parallel, which frees its buffers before passing the
+ * error on.
+ */
+static int
+png_parallel_write_chunks(png_voidp argument)
+{
+   png_parallel_write *job = png_voidcast(png_parallel_write*, argument);
+   unsigned int g;
+
+   for (g = 0; g < job->groups; ++g)
+      png_write_complete_chunk(job->png_ptr, png_IDAT, job->out[g],
+          job->out_size[g]);
+
+   return 1;
+}
+
+static int
+png_image_write_parallel(png_image_write_control *display)
+{
+   png_imagep image = display->image;
+   png_structrp png_ptr = image->opaque->png_ptr;
+   png_inforp info_ptr = image->opaque->info_ptr;
+   png_parallel_write job;
+   png_parallel_worker workers[PNG_PARALLEL_WRITE_THREADS];
+   pthread_t threads[PNG_PARALLEL_WRITE_THREADS];
+   size_t filtered_bytes;
+   unsigned int g;
+   int ok = 0;
+   int write_error = 0;
+   char message[(sizeof image->message)];
+
+   if (png_ptr->transformations != 0 || png_ptr->interlaced != 0 ||
+       png_get_bit_depth(png_ptr, info_ptr) != 8)
+      return 0;
+
+   memset(&job, 0, (sizeof job));
+   job.png_ptr = png_ptr;
+   job.first_row = png_voidcast(png_const_bytep, display->first_row);
+   job.row_stride = display->row_bytes;
+   job.row_bytes = png_get_rowbytes(png_ptr, info_ptr);
+   job.bpp = png_get_channels(png_ptr, info_ptr);
+   job.do_filter = png_ptr->do_filter;
+   /* The simplified API has no access to png_ptr, so the filter selection
+    * method is chosen with an image flag: PNG_IMAGE_FLAG_FAST_ADAPTIVE
+    * estimates the entropy of each filter from a sample of the row and only
+    * filters the row once, otherwise every enabled filter is tried and the
+    * smallest sum of absolute differences wins.
+    */
+   job.selection = (image->flags & PNG_IMAGE_FLAG_FAST_ADAPTIVE) != 0 ?
+       PNG_FILTER_SELECTION_FAST_ADAPTIVE : PNG_FILTER_SELECTION_SUM;
+   job.height = image->height;
+   filtered_bytes = job.row_bytes + 1;
+
+   job.group_rows = (png_uint_32)(PNG_PARALLEL_WRITE_GROUP_BYTES /
+       filtered_bytes);
+   if (job.group_rows == 0)
+      job.group_rows = 1;
+   job.groups = (unsigned int)((job.height + job.group_rows - 1) /
+       job.group_rows);
+
+   /* A single group gains nothing over the serial writer. */
+   if (job.groups < 2 ||
+       job.height > PNG_SIZE_MAX / filtered_bytes / 2 ||
+       job.groups > PNG_SIZE_MAX / (sizeof (png_bytep)))
+      return 0;
+
+   job.threads = job.groups < PNG_PARALLEL_WRITE_THREADS ? job.groups :
+       PNG_PARALLEL_WRITE_THREADS;
+
+   job.level = png_ptr->zlib_level == Z_DEFAULT_COMPRESSION ? 6 :
+       png_ptr->zlib_level;
+   job.mem_level = png_ptr->zlib_mem_level;
+   job.strategy = png_ptr->zlib_strategy;
+   job.window_bits = png_ptr->zlib_window_bits < 9 ? 9 :
+       png_ptr->zlib_window_bits;
+
+   /* Allocation failures are not errors here, the serial path is used. */
+   job.zero_row = png_voidcast(png_const_bytep,
+       png_malloc_warn(png_ptr, job.row_bytes));
+   job.scratch = png_voidcast(png_bytep, png_malloc_warn(png_ptr,
+       job.threads * 4 * filtered_bytes));
+   job.filtered = png_voidcast(png_bytep, png_malloc_warn(png_ptr,
+       job.height * filtered_bytes));
+   job.out = png_voidcast(png_bytep*, png_malloc_warn(png_ptr,
+       job.groups * (sizeof (png_bytep))));
+   job.out_size = png_voidcast(size_t*, png_malloc_warn(png_ptr,
+       job.groups * (sizeof (size_t))));
+   job.adler = png_voidcast(png_uint_32*, png_malloc_warn(png_ptr,
+       job.groups * (sizeof (png_uint_32))));
+
+   if (job.zero_row == NULL || job.scratch == NULL || job.filtered == NULL ||
+       job.out == NULL || job.out_size == NULL || job.adler == NULL)
+      goto done;
+
+   memset(png_voidcast(png_voidp, job.zero_row), 0, job.row_bytes);
+   memset(job.out, 0, job.groups * (sizeof (png_bytep)));
+
+   png_parallel_write_start(&job, workers, threads);
+
+   if (png_parallel_write_run(&job, workers, PNG_PARALLEL_FILTER) == 0)
+      goto done;
+
+   /* Size each output with deflateBound for the actual parameters; the 2
+    * header bytes go before the first group, the 4 trailer bytes after the
+    * last, and a sync flush adds at most 5 bytes.
+    */
+   {
+      z_stream probe;
+
+      memset(&probe, 0, (sizeof probe));
+      if (deflateInit2(&probe, job.level, Z_DEFLATED, -job.window_bits,
+          job.mem_level, job.strategy) != Z_OK)
+         goto done;
+
+      for (g = 0; g < job.groups; ++g)
+      {
+         png_uint_32 rows = g + 1 == job.groups ?
+             job.height - g * job.group_rows : job.group_rows;
+         size_t bound = deflateBound(&probe, (uLong)(rows * filtered_bytes)) +
+             5;
+
+         job.out_size[g] = bound;
+         job.out[g] = png_voidcast(png_bytep, png_malloc_warn(png_ptr,
+             bound + 6));
+         if (job.out[g] == NULL)
+            break;
+      }
+
+      deflateEnd(&probe);
+      if (g < job.groups)
+         goto done;
+   }
+
+   /* Leave room for the zlib header in front of the first group. */
+   job.out[0] += 2;
+   ok = png_parallel_write_run(&job, workers, PNG_PARALLEL_DEFLATE);
+   job.out[0] -= 2;
+   png_parallel_write_stop(&job, threads);
+
+   if (ok != 0)
+   {
+      png_uint_32 adler = job.adler[0];
+      size_t last_size;
+      unsigned int header = (Z_DEFLATED + ((job.window_bits - 8) << 4)) << 8;
+      unsigned int level_flags;
+
+      /* The zlib header deflate itself would write, see deflate.c */
+      if (job.strategy >= Z_HUFFMAN_ONLY || job.level < 2)
+         level_flags = 0;
+
+      else if (job.level < 6)
+         level_flags = 1;
+
+      else if (job.level == 6)
+         level_flags = 2;
+
+      else
+         level_flags = 3;
+
+      header |= level_flags << 6;
+      header += 31 - (header % 31);
+      job.out[0][0] = (png_byte)(header >> 8);
+      job.out[0][1] = (png_byte)(header & 0xff);
+      job.out_size[0] += 2;
+
+      for (g = 1; g < job.groups; ++g)
+      {
+         png_uint_32 rows = g + 1 == job.groups ?
+             job.height - g * job.group_rows : job.group_rows;
+
+         adler = (png_uint_32)adler32_combine(adler, job.adler[g],
+             (z_off_t)(rows * filtered_bytes));
+      }
+
+      last_size = job.out_size[job.groups - 1];
+      png_save_uint_32(job.out[job.groups - 1] + last_size, adler);
+      job.out_size[job.groups - 1] = last_size + 4;
+
+      if (png_safe_execute(image, png_parallel_write_chunks, &job) != 0)
+         png_ptr->mode |= PNG_HAVE_IDAT | PNG_AFTER_IDAT;
+
+      else
+      {
+         /* The message is replaced when the error is raised again. */
+         memcpy(message, image->message, (sizeof message));
+         message[(sizeof message) - 1] = 0;
+         write_error = 1;
+      }
+   }
+
+done:
+   png_parallel_write_stop(&job, threads);
+
+   if (job.out != NULL)
+   {
+      for (g = 0; g < job.groups; ++g)
+         png_free(png_ptr, job.out[g]);
+   }
+
+   png_free(png_ptr, job.adler);
+   png_free(png_ptr, job.out_size);
+   png_free(png_ptr, job.out);
+   png_free(png_ptr, job.filtered);
+   png_free(png_ptr, job.scratch);
+   png_free(png_ptr, png_voidcast(png_voidp, job.zero_row));
+
+   /* Some IDAT chunks may have been written, so the serial path cannot be
+    * used instead.
+    */
+   if (write_error != 0)
+      png_error(png_ptr, message);
+
+   return ok;
+}
+#endif /* SIMPLIFIED_WRITE_PARALLEL */
+
 static int
 png_image_write_main(png_voidp argument)
 {
@@ -929,6 +1864,17 @@ if (verbose) {
          return 0;
    }
 
+#  ifdef PNG_SIMPLIFIED_WRITE_PARALLEL_SUPPORTED
+   /* Rows that need no pre-transform can be compressed by row groups on
+    * several threads; this falls through to the serial code if it cannot.
+    */
+   else if ((image->flags & PNG_IMAGE_FLAG_PARALLEL) != 0 &&
+       png_image_write_parallel(display) != 0)
+   {
+      /* The IDAT chunks have been written. */
+   }
+#  endif
+
    /* Otherwise this is the case where the input is in a format currently
     * supported by the rest of the libpng write code; call it directly.
     */
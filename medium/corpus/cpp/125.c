@@ -17,11 +17,16 @@
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
 
 #include "vorbis/codec.h"
 #include "vorbis/vorbisenc.h"
 
 #include "codec_internal.h"
+#include "psy.h"
+#include "registry.h"
 
 #include "os.h"
 #include "misc.h"
@@ -954,3 +959,344 @@ int vorbis_encode_init(vorbis_info *vi,
   return(ret);
 }
 
+
+/* parallel block analysis ***********************************************
+
+   vorbis_analysis() on distinct blocks shares only read-only lookups,
+   with one exception: the psychoacoustic peak tracker.  Each block's
+   analysis starts from the decayed peak left by the block before it
+   (handed over through vbi->ampmax and the global psy look), and only
+   raises it: the analysis works from max(incoming peak, the block's own
+   spectral peak).
+
+   So a batch of blocks is analysed in parallel with the lowest possible
+   incoming peak, which yields each block's own spectral peak.  The exact
+   chain is then replayed serially, and only the blocks whose true
+   incoming peak exceeds their own peak (quiet tails after loud passages)
+   are analysed again.  The result is the bitstream of the sequential
+   loop:
+
+     while(vorbis_analysis_blockout(v,vb)==1){
+       vorbis_analysis(vb,NULL);
+       vorbis_bitrate_addblock(vb);
+       while(vorbis_bitrate_flushpacket(v,&op))
+         ...
+     }
+
+   The floor and residue backends also count the bits they write in their
+   look structures.  Each slot analyses through a copy of the backend
+   state with its own floor and residue looks, and the floor counts of
+   the final analysis of every block are added to the shared looks in
+   stream order.  The residue counts are only reported by training
+   builds, which use the sequential loop, as do builds without threads. */
+
+#define VE_MAX_WORKERS 64
+#define VE_BATCH_PER_WORKER 4
+#define VE_AMPMAX_FLOOR -9999.f
+
+#if defined(HAVE_PTHREAD) && !defined(TRAIN_RES) && !defined(TRAIN_RESAUX)
+#define VE_THREADS
+#endif
+
+#ifdef VE_THREADS
+
+typedef struct {
+  vorbis_block vb;
+  float **saved;       /* pcm as handed out by blockout; long block size */
+  float   own_ampmax;  /* peak out of the first analysis */
+  float   ampmax;      /* exact incoming peak */
+  int     redo;
+
+  /* backend state the analysis of this slot runs with */
+  vorbis_dsp_state      vd;
+  private_state         b;
+  drft_lookup           fft_look[2];  /* drft_forward writes its trigcache */
+  vorbis_look_floor   **flr;
+  vorbis_look_residue **residue;
+} ve_slot;
+
+typedef struct {
+  ve_slot **slots;
+  int       n;
+  int       next;
+  int       second_pass;
+  pthread_mutex_t lock;
+} ve_batch;
+
+static int ve_slot_init(ve_slot *s,vorbis_dsp_state *v){
+  codec_setup_info *ci=v->vi->codec_setup;
+  int i;
+
+  vorbis_block_init(v,&s->vb);
+  s->saved=_ogg_calloc(v->vi->channels,sizeof(*s->saved));
+  s->flr=_ogg_calloc(ci->floors,sizeof(*s->flr));
+  s->residue=_ogg_calloc(ci->residues,sizeof(*s->residue));
+  if(!s->saved || !s->flr || !s->residue)return OV_EFAULT;
+
+  /* sized up front so that a block taken by blockout is never dropped */
+  for(i=0;i<v->vi->channels;i++){
+    s->saved[i]=_ogg_malloc(ci->blocksizes[1]*sizeof(**s->saved));
+    if(!s->saved[i])return OV_EFAULT;
+  }
+  drft_init(&s->fft_look[0],ci->blocksizes[0]);
+  drft_init(&s->fft_look[1],ci->blocksizes[1]);
+
+  for(i=0;i<ci->floors;i++){
+    s->flr[i]=_floor_P[ci->floor_type[i]]->look(v,ci->floor_param[i]);
+    if(!s->flr[i])return OV_EFAULT;
+  }
+  for(i=0;i<ci->residues;i++){
+    s->residue[i]=
+      _residue_P[ci->residue_type[i]]->look(v,ci->residue_param[i]);
+    if(!s->residue[i])return OV_EFAULT;
+  }
+  return 0;
+}
+
+static void ve_slot_clear(ve_slot *s,vorbis_dsp_state *v){
+  codec_setup_info *ci=v->vi->codec_setup;
+  int i;
+
+  if(s->saved){
+    for(i=0;i<v->vi->channels;i++)
+      if(s->saved[i])_ogg_free(s->saved[i]);
+    _ogg_free(s->saved);
+  }
+  if(s->flr){
+    for(i=0;i<ci->floors;i++)
+      if(s->flr[i])_floor_P[ci->floor_type[i]]->free_look(s->flr[i]);
+    _ogg_free(s->flr);
+  }
+  if(s->residue){
+    for(i=0;i<ci->residues;i++)
+      if(s->residue[i])
+        _residue_P[ci->residue_type[i]]->free_look(s->residue[i]);
+    _ogg_free(s->residue);
+  }
+  drft_clear(&s->fft_look[0]);
+  drft_clear(&s->fft_look[1]);
+  vorbis_block_clear(&s->vb);
+}
+
+/* the encoder only sets up floor 1 */
+static void ve_floor_counts(vorbis_look_floor **to,vorbis_look_floor **from,
+                            int floors){
+  int i;
+  for(i=0;i<floors;i++){
+    vorbis_look_floor1 *t=(vorbis_look_floor1 *)to[i];
+    if(from){
+      vorbis_look_floor1 *f=(vorbis_look_floor1 *)from[i];
+      t->phrasebits+=f->phrasebits;
+      t->postbits+=f->postbits;
+      t->frames+=f->frames;
+    }else{
+      t->phrasebits=0;
+      t->postbits=0;
+      t->frames=0;
+    }
+  }
+}
+
+static void ve_restore_pcm(ve_slot *s,int channels){
+  int i;
+  for(i=0;i<channels;i++)
+    memcpy(s->vb.pcm[i],s->saved[i],s->vb.pcmend*sizeof(**s->saved));
+}
+
+static void ve_analyse(ve_batch *b,ve_slot *s){
+  vorbis_block_internal *vbi=(vorbis_block_internal *)s->vb.internal;
+  vorbis_dsp_state *v=s->vb.vd;
+  codec_setup_info *ci=v->vi->codec_setup;
+
+  if(b->second_pass){
+    if(!s->redo)return;
+    ve_restore_pcm(s,v->vi->channels);
+    vbi->ampmax=s->ampmax;
+  }else
+    vbi->ampmax=VE_AMPMAX_FLOOR;
+
+  /* the caller's state does not change while the workers run */
+  s->vd=*v;
+  s->b=*(private_state *)v->backend_state;
+  s->b.flr=s->flr;
+  s->b.residue=s->residue;
+  s->b.fft_look[0]=s->fft_look[0];
+  s->b.fft_look[1]=s->fft_look[1];
+  s->vd.backend_state=&s->b;
+  ve_floor_counts(s->flr,NULL,ci->floors);
+
+  s->vb.vd=&s->vd;
+  vorbis_analysis(&s->vb,NULL);
+  s->vb.vd=v;
+
+  if(!b->second_pass)s->own_ampmax=vbi->ampmax;
+}
+
+static ve_slot *ve_take(ve_batch *b){
+  ve_slot *s=NULL;
+  pthread_mutex_lock(&b->lock);
+  if(b->next<b->n)s=b->slots[b->next++];
+  pthread_mutex_unlock(&b->lock);
+  return s;
+}
+
+static void *ve_worker(void *arg){
+  ve_batch *b=(ve_batch *)arg;
+  ve_slot *s;
+  while((s=ve_take(b)))
+    ve_analyse(b,s);
+  return NULL;
+}
+
+static void ve_run(ve_batch *b,int workers){
+  pthread_t threads[VE_MAX_WORKERS];
+  int started=0;
+  int i;
+
+  b->next=0;
+  if(workers>b->n)workers=b->n;
+  for(i=1;i<workers;i++){
+    if(pthread_create(threads+started,NULL,ve_worker,b))break;
+    started++;
+  }
+  ve_worker(b);
+  for(i=0;i<started;i++)
+    pthread_join(threads[i],NULL);
+}
+
+static void ve_save_pcm(ve_slot *s,int channels){
+  int i;
+  for(i=0;i<channels;i++)
+    memcpy(s->saved[i],s->vb.pcm[i],s->vb.pcmend*sizeof(**s->saved));
+}
+
+static int ve_analysis_batches(vorbis_dsp_state *v,vorbis_block *vb,
+                               int num_workers,
+                               void (*packet_out)(ogg_packet *op,
+                                                  void *client_data),
+                               void *client_data){
+  private_state *b=(private_state *)v->backend_state;
+  codec_setup_info *ci=v->vi->codec_setup;
+  vorbis_block_internal *cvbi=(vorbis_block_internal *)vb->internal;
+  int channels=v->vi->channels;
+  int nslots=num_workers*VE_BATCH_PER_WORKER;
+  int i,ret=0;
+  ve_slot *slots;
+  ve_slot *order[VE_MAX_WORKERS*VE_BATCH_PER_WORKER];
+  ve_batch batch;
+
+  slots=_ogg_calloc(nslots,sizeof(*slots));
+  if(!slots)return OV_EFAULT;
+  for(i=0;i<nslots;i++){
+    if(ve_slot_init(slots+i,v)){
+      nslots=i+1;
+      ret=OV_EFAULT;
+      goto cleanup;
+    }
+  }
+
+  memset(&batch,0,sizeof(batch));
+  batch.slots=order;
+  if(pthread_mutex_init(&batch.lock,NULL)){
+    ret=OV_EFAULT;
+    goto cleanup;
+  }
+
+  for(;;){
+    float ampmax=b->psy_g_look->ampmax;
+    int n=0;
+
+    /* carve the batch; blockout folds the block's stale peak into the
+       global tracker, so keep that at the floor and fix it up below */
+    while(n<nslots){
+      ve_slot *s=slots+n;
+      ((vorbis_block_internal *)s->vb.internal)->ampmax=VE_AMPMAX_FLOOR;
+      if(vorbis_analysis_blockout(v,&s->vb)!=1)break;
+      ve_save_pcm(s,channels);
+      order[n++]=s;
+    }
+    if(!n)break;
+
+    batch.n=n;
+    batch.second_pass=0;
+    ve_run(&batch,num_workers);
+
+    /* replay the peak tracker exactly as the sequential loop would:
+       blockout decays max(global, previous block's peak) by the length
+       of the new block, and analysis raises it to the block's own peak */
+    {
+      int W=v->W;
+      float prev=cvbi->ampmax;
+      for(i=0;i<n;i++){
+        ve_slot *s=order[i];
+        if(prev>ampmax)ampmax=prev;
+        v->W=s->vb.W;
+        ampmax=_vp_ampmax_decay(ampmax,v);
+        s->ampmax=ampmax;
+        s->redo=ampmax>s->own_ampmax;
+        prev=s->redo?ampmax:s->own_ampmax;
+      }
+      v->W=W;
+      b->psy_g_look->ampmax=ampmax;
+      cvbi->ampmax=prev;
+    }
+
+    batch.second_pass=1;
+    ve_run(&batch,num_workers);
+
+    /* the reorder buffer: bitrate management and packet flushing are
+       strictly sequential */
+    for(i=0;i<n;i++){
+      ogg_packet op;
+      ve_floor_counts(b->flr,order[i]->flr,ci->floors);
+      vorbis_bitrate_addblock(&order[i]->vb);
+      while(vorbis_bitrate_flushpacket(v,&op))
+        packet_out(&op,client_data);
+    }
+
+    if(n<nslots)break;
+  }
+
+  pthread_mutex_destroy(&batch.lock);
+
+ cleanup:
+  for(i=0;i<nslots;i++)
+    ve_slot_clear(slots+i,v);
+  _ogg_free(slots);
+  return(ret);
+}
+
+#endif /* VE_THREADS */
+
+/* Drains every block vorbis_analysis_blockout() can currently produce,
+   analysing up to num_workers blocks at once, and hands the resulting
+   packets to packet_out in stream order.  vb is the block the caller
+   would otherwise use for the sequential loop; it carries the peak
+   tracker across calls, so parallel and sequential calls can be mixed
+   freely.  A packet is only valid for the duration of the callback.
+   Without thread support this is the sequential loop. */
+int vorbis_encode_analysis_parallel(vorbis_dsp_state *v,vorbis_block *vb,
+                                    int num_workers,
+                                    void (*packet_out)(ogg_packet *op,
+                                                       void *client_data),
+                                    void *client_data){
+  ogg_packet op;
+
+  if(!v->backend_state || !vb->internal || !packet_out)return OV_EINVAL;
+
+#ifdef VE_THREADS
+  if(num_workers>VE_MAX_WORKERS)num_workers=VE_MAX_WORKERS;
+  if(num_workers>1)
+    return ve_analysis_batches(v,vb,num_workers,packet_out,client_data);
+#else
+  (void)num_workers;
+#endif
+
+  while(vorbis_analysis_blockout(v,vb)==1){
+    vorbis_analysis(vb,NULL);
+    vorbis_bitrate_addblock(vb);
+    while(vorbis_bitrate_flushpacket(v,&op))
+      packet_out(&op,client_data);
+  }
+  return(0);
+}
@@ -134,6 +134,65 @@ static void HorizontalUnfilter_C(const uint8_t* prev, const uint8_t* in,
           continue;
         }
 
+//------------------------------------------------------------------------------
+// Fused alpha unfiltering.
+//
+// The alpha decoder used to unfilter the alpha plane, copy it into the RGBA
+// output and premultiply the output in three separate sweeps. Here every
+// row is unfiltered and, while still in cache, stored in the RGBA row with
+// the color channels premultiplied in the same pass.
+
+#define MULTIPLIER(a)   ((a) * 32897U)
+#define PREMULTIPLY(x, m) (((x) * (m)) >> 23)
+
+int WebPApplyAlphaRow_C(const uint8_t* alpha, int width, uint8_t* rgba,
+                        int alpha_first, int premultiply) {
+  uint8_t* const rgb = rgba + (alpha_first ? 1 : 0);
+  uint8_t* const dst = rgba + (alpha_first ? 0 : 3);
+  uint32_t alpha_mask = 0xff;
+  int i;
+  for (i = 0; i < width; ++i) {
+    const uint32_t a = alpha[i];
+    dst[4 * i] = (uint8_t)a;
+    alpha_mask &= a;
+    if (premultiply && a != 0xff) {
+      const uint32_t mult = MULTIPLIER(a);
+      rgb[4 * i + 0] = (uint8_t)PREMULTIPLY(rgb[4 * i + 0], mult);
+      rgb[4 * i + 1] = (uint8_t)PREMULTIPLY(rgb[4 * i + 1], mult);
+      rgb[4 * i + 2] = (uint8_t)PREMULTIPLY(rgb[4 * i + 2], mult);
+    }
+  }
+  return (alpha_mask != 0xff);
+}
+
+WebPApplyAlphaRowFunc WebPApplyAlphaRow;
+
+int WebPUnfilterAlphaRows(WEBP_FILTER_TYPE filter, const uint8_t* prev_line,
+                          const uint8_t* in, int in_stride,
+                          uint8_t* out, int out_stride, int width,
+                          int num_rows, uint8_t* rgba, int rgba_stride,
+                          int alpha_first, int premultiply) {
+  const WebPUnfilterFunc unfilter = WebPUnfilters[filter];
+  int has_alpha = 0;
+  int y;
+  for (y = 0; y < num_rows; ++y) {
+    if (unfilter != NULL) {
+      unfilter(prev_line, in, out, width);
+    } else if (in != out) {
+      memcpy(out, in, width);
+    }
+    has_alpha |= WebPApplyAlphaRow(out, width, rgba, alpha_first, premultiply);
+    prev_line = out;
+    in += in_stride;
+    out += out_stride;
+    rgba += rgba_stride;
+  }
+  return has_alpha;
+}
+
+#undef MULTIPLIER
+#undef PREMULTIPLY
+
 //------------------------------------------------------------------------------
 // Init function
 
@@ -141,9 +200,67 @@ WebPFilterFunc WebPFilters[WEBP_FILTER_LAST];
 WebPUnfilterFunc WebPUnfilters[WEBP_FILTER_LAST];
 
 extern VP8CPUInfo VP8GetCPUInfo;
+extern void VP8FiltersInitSSE2(void);
+extern void VP8FiltersInitAVX2(void);
 extern void VP8FiltersInitMIPSdspR2(void);
 extern void VP8FiltersInitMSA(void);
 extern void VP8FiltersInitNEON(void);
+
+WEBP_DSP_INIT_FUNC(VP8FiltersInit) {
+  WebPUnfilters[WEBP_FILTER_NONE] = NULL;
+#if !WEBP_NEON_OMIT_C_CODE
+  WebPUnfilters[WEBP_FILTER_HORIZONTAL] = HorizontalUnfilter_C;
+  WebPUnfilters[WEBP_FILTER_VERTICAL] = VerticalUnfilter_C;
+#endif
+  WebPUnfilters[WEBP_FILTER_GRADIENT] = GradientUnfilter_C;
+
+  WebPFilters[WEBP_FILTER_NONE] = NULL;
+#if !WEBP_NEON_OMIT_C_CODE
+  WebPFilters[WEBP_FILTER_HORIZONTAL] = HorizontalFilter_C;
+  WebPFilters[WEBP_FILTER_VERTICAL] = VerticalFilter_C;
+  WebPFilters[WEBP_FILTER_GRADIENT] = GradientFilter_C;
+#endif
+
+  WebPApplyAlphaRow = WebPApplyAlphaRow_C;
+
+  if (VP8GetCPUInfo != NULL) {
+#if defined(WEBP_HAVE_SSE2)
+    if (VP8GetCPUInfo(kSSE2)) {
+      VP8FiltersInitSSE2();
+#if defined(WEBP_HAVE_AVX2)
+      if (VP8GetCPUInfo(kAVX2)) {
+        VP8FiltersInitAVX2();
+      }
+#endif
+    }
+#endif
+#if defined(WEBP_USE_MIPS_DSP_R2)
+    if (VP8GetCPUInfo(kMIPSdspR2)) {
+      VP8FiltersInitMIPSdspR2();
+    }
+#endif
+#if defined(WEBP_USE_MSA)
+    if (VP8GetCPUInfo(kMSA)) {
+      VP8FiltersInitMSA();
+    }
+#endif
+  }
+
+#if defined(WEBP_HAVE_NEON)
+  if (WEBP_NEON_OMIT_C_CODE ||
+      (VP8GetCPUInfo != NULL && VP8GetCPUInfo(kNEON))) {
+    VP8FiltersInitNEON();
+  }
+#endif
+
+  assert(WebPUnfilters[WEBP_FILTER_HORIZONTAL] != NULL);
+  assert(WebPUnfilters[WEBP_FILTER_VERTICAL] != NULL);
+  assert(WebPUnfilters[WEBP_FILTER_GRADIENT] != NULL);
+  assert(WebPFilters[WEBP_FILTER_HORIZONTAL] != NULL);
+  assert(WebPFilters[WEBP_FILTER_VERTICAL] != NULL);
+  assert(WebPFilters[WEBP_FILTER_GRADIENT] != NULL);
+  assert(WebPApplyAlphaRow != NULL);
+}
 typedef int (*fmt_func)(wchar_t* __restrict, size_t, const wchar_t* __restrict, ...);
 
 inline fmt_func get_wprintf() {
@@ -14,29 +14,24 @@
 #include <assert.h>
 
 #include "src/enc/vp8i_enc.h"
+#include "src/dsp/dsp.h"
 #include "src/dsp/yuv.h"
+#include "src/utils/thread_utils.h"
 
 //------------------------------------------------------------------------------
 // Helper: clean up fully transparent area to help compressibility.
 
 #define SIZE 8
+#define SIZE2 (SIZE / 2)
 
 static void Flatten(uint8_t* ptr, int v, int stride, int size) {
-        accdom = tag(accdom, MA, Level);
-        if (Level > Dependences::AL_Statement) {
-          isl_map *StmtScheduleMap = Stmt.getSchedule().release();
-          assert(StmtScheduleMap &&
-                 "Schedules that contain extension nodes require special "
-                 "handling.");
-          isl_map *Schedule = tag(StmtScheduleMap, MA, Level);
-          StmtSchedule = isl_union_map_add_map(StmtSchedule, Schedule);
-        }
-}
-
-static void FlattenARGB(uint32_t* ptr, uint32_t v, int stride, int size) {
+  int y;
+  for (y = 0; y < size; ++y) {
+    memset(ptr, v, size);
+    ptr += stride;
+  }
 }
 
-// Smoothen the luma components of transparent pixels. Return true if the whole
 // Returns PARSE_NEED_MORE_DATA with insufficient data, PARSE_ERROR otherwise.
 static ParseStatus NewFrame(const MemBuffer* const mem,
                             uint32_t min_size, uint32_t actual_size,
@@ -72,119 +67,179 @@ void GDScriptTokenizerText::handleNewLine(bool createToken) {
 	leftmostColumn = 1;
 }
 
-void WebPCleanupTransparentArea(WebPPicture* pic) {
-  int x, y, w, h;
-  if (pic == NULL) return;
-  w = pic->width / SIZE;
-  h = pic->height / SIZE;
-
-  SmallVector<InlineContentComment *, 8> Content;
-
-  while (true) {
-    switch (Tok.getKind()) {
-    case tok::verbatim_block_begin:
-    case tok::verbatim_line_name:
-    case tok::eof:
-      break; // Block content or EOF ahead, finish this parapgaph.
-
-    case tok::unknown_command:
-      Content.push_back(S.actOnUnknownCommand(Tok.getLocation(),
-                                              Tok.getEndLocation(),
-                                              Tok.getUnknownCommandName()));
-      consumeToken();
-      continue;
-
-    case tok::backslash_command:
-    case tok::at_command: {
-      const CommandInfo *Info = Traits.getCommandInfo(Tok.getCommandID());
-      if (Info->IsBlockCommand) {
-        if (Content.size() == 0)
-          return parseBlockCommand();
-        break; // Block command ahead, finish this parapgaph.
-      }
-      if (Info->IsVerbatimBlockEndCommand) {
-        Diag(Tok.getLocation(),
-             diag::warn_verbatim_block_end_without_start)
-          << Tok.is(tok::at_command)
-          << Info->Name
-          << SourceRange(Tok.getLocation(), Tok.getEndLocation());
-        consumeToken();
-        continue;
-      }
-      if (Info->IsUnknownCommand) {
-        Content.push_back(S.actOnUnknownCommand(Tok.getLocation(),
-                                                Tok.getEndLocation(),
-                                                Info->getID()));
-        consumeToken();
-        continue;
-      }
-      assert(Info->IsInlineCommand);
-      Content.push_back(parseInlineCommand());
-      continue;
+//------------------------------------------------------------------------------
+// Large pictures are processed in horizontal bands on worker threads.
+
+#define MAX_TOOLS_BANDS 4
+#define MIN_BAND_PIXELS (512 * 512)   // below this, a thread costs more
+
+typedef struct {
+  WebPPicture* pic;
+  int start, end;       // rows (of blocks, for the cleanup) of the band
+  uint32_t color;       // background color, for the blending
+} PictureBand;
+
+// Splits 'num_rows' into bands whose boundaries are multiples of 'row_align'
+// and runs 'hook' on each. The calling thread does the first band itself.
+// Without 'thread_level' (see WebPConfig), everything runs in one band.
+static void ProcessBands(WebPPicture* const pic, WebPWorkerHook hook,
+                         int num_rows, int row_align, uint32_t color,
+                         int thread_level) {
+  const WebPWorkerInterface* const worker_interface = WebPGetWorkerInterface();
+  PictureBand bands[MAX_TOOLS_BANDS];
+  WebPWorker workers[MAX_TOOLS_BANDS];
+  int num_bands = 1;
+  int band_rows, i;
+
+  if (thread_level > 0) {
+    const int64_t num_pixels = (int64_t)pic->width * pic->height;
+    num_bands = (num_pixels >= MAX_TOOLS_BANDS * MIN_BAND_PIXELS)
+              ? MAX_TOOLS_BANDS : (int)(num_pixels / MIN_BAND_PIXELS);
+    if (num_bands < 1) num_bands = 1;
+  }
+  band_rows = (num_rows + num_bands - 1) / num_bands;
+  band_rows = (band_rows + row_align - 1) / row_align * row_align;
+  if (band_rows == 0) band_rows = row_align;
+  num_bands = (num_rows + band_rows - 1) / band_rows;   // no empty band
+  if (num_bands < 1) num_bands = 1;
+
+  for (i = 0; i < num_bands; ++i) {
+    bands[i].pic = pic;
+    bands[i].start = i * band_rows;
+    bands[i].end = (i + 1) * band_rows;
+    if (bands[i].end > num_rows) bands[i].end = num_rows;
+    bands[i].color = color;
+  }
+  for (i = 1; i < num_bands; ++i) {
+    WebPWorker* const worker = &workers[i];
+    worker_interface->Init(worker);
+    worker->hook = hook;
+    worker->data1 = &bands[i];
+    worker->data2 = NULL;
+    if (worker_interface->Reset(worker)) {
+      worker_interface->Launch(worker);
+    } else {
+      worker_interface->Execute(worker);   // no thread: run it here
     }
+  }
+  hook(&bands[0], NULL);
+  for (i = 1; i < num_bands; ++i) {
+    worker_interface->Sync(&workers[i]);
+    worker_interface->End(&workers[i]);
+  }
+}
 
-    case tok::newline: {
-      consumeToken();
-      if (Tok.is(tok::newline) || Tok.is(tok::eof)) {
-        consumeToken();
-        break; // Two newlines -- end of paragraph.
+// note: we ignore the left-overs on right/bottom, except for SmoothenBlock().
+static int CleanupARGBBand(void* arg1, void* arg2) {
+  const PictureBand* const band = (const PictureBand*)arg1;
+  WebPPicture* const pic = band->pic;
+  const int w = pic->width / SIZE;
+  uint32_t argb_value = 0;
+  int x, y;
+  (void)arg2;
+  for (y = band->start; y < band->end; ++y) {
+    int need_reset = 1;
+    for (x = 0; x < w; ++x) {
+      const int off = (y * pic->argb_stride + x) * SIZE;
+      if (WebPIsTransparentARGBArea(pic->argb + off, pic->argb_stride,
+                                    SIZE)) {
+        if (need_reset) {
+          argb_value = pic->argb[off];
+          need_reset = 0;
+        }
+        WebPFlattenARGB(pic->argb + off, argb_value, pic->argb_stride, SIZE);
+      } else {
+        need_reset = 1;
       }
-      // Also allow [tok::newline, tok::text, tok::newline] if the middle
-      // tok::text is just whitespace.
-      if (Tok.is(tok::text) && isWhitespace(Tok.getText())) {
-        Token WhitespaceTok = Tok;
-        consumeToken();
-        if (Tok.is(tok::newline) || Tok.is(tok::eof)) {
-          consumeToken();
-          break;
+    }
+  }
+  return 1;
+}
+
+static int CleanupYUVBand(void* arg1, void* arg2) {
+  const PictureBand* const band = (const PictureBand*)arg1;
+  WebPPicture* const pic = band->pic;
+  const int width = pic->width;
+  const int height = pic->height;
+  const int y_stride = pic->y_stride;
+  const int uv_stride = pic->uv_stride;
+  const int a_stride = pic->a_stride;
+  uint8_t* y_ptr = pic->y + band->start * SIZE * y_stride;
+  uint8_t* u_ptr = pic->u + band->start * SIZE2 * uv_stride;
+  uint8_t* v_ptr = pic->v + band->start * SIZE2 * uv_stride;
+  const uint8_t* a_ptr = pic->a + band->start * SIZE * a_stride;
+  int values[3] = { 0 };
+  int x, y;
+  (void)arg2;
+  for (y = band->start * SIZE; y < band->end * SIZE; y += SIZE) {
+    int need_reset = 1;
+    for (x = 0; x + SIZE <= width; x += SIZE) {
+      if (WebPSmoothenBlock(a_ptr + x, a_stride, y_ptr + x, y_stride,
+                            SIZE, SIZE)) {
+        if (need_reset) {
+          values[0] = y_ptr[x];
+          values[1] = u_ptr[x >> 1];
+          values[2] = v_ptr[x >> 1];
+          need_reset = 0;
         }
-        // We have [tok::newline, tok::text, non-newline].  Put back tok::text.
-        putBack(WhitespaceTok);
+        Flatten(y_ptr + x,        values[0], y_stride,  SIZE);
+        Flatten(u_ptr + (x >> 1), values[1], uv_stride, SIZE2);
+        Flatten(v_ptr + (x >> 1), values[2], uv_stride, SIZE2);
+      } else {
+        need_reset = 1;
       }
-      if (Content.size() > 0)
-        Content.back()->addTrailingNewline();
-      continue;
     }
+    if (x < width) {
+      WebPSmoothenBlock(a_ptr + x, a_stride, y_ptr + x, y_stride,
+                        width - x, SIZE);
+    }
+    a_ptr += SIZE * a_stride;
+    y_ptr += SIZE * y_stride;
+    u_ptr += SIZE2 * uv_stride;
+    v_ptr += SIZE2 * uv_stride;
+  }
+  if (band->end == height / SIZE && y < height) {   // last band: bottom rows
+    const int sub_height = height - y;
+    for (x = 0; x + SIZE <= width; x += SIZE) {
+      WebPSmoothenBlock(a_ptr + x, a_stride, y_ptr + x, y_stride,
+                        SIZE, sub_height);
+    }
+    if (x < width) {
+      WebPSmoothenBlock(a_ptr + x, a_stride, y_ptr + x, y_stride,
+                        width - x, sub_height);
+    }
+  }
+  return 1;
+}
 
-    // Don't deal with HTML tag soup now.
-    case tok::html_start_tag:
-      Content.push_back(parseHTMLStartTag());
-      continue;
-
-    case tok::html_end_tag:
-      Content.push_back(parseHTMLEndTag());
-      continue;
-
-    case tok::text:
-      Content.push_back(S.actOnText(Tok.getLocation(),
-                                    Tok.getEndLocation(),
-                                    Tok.getText()));
-      consumeToken();
-      continue;
-
-    case tok::verbatim_block_line:
-    case tok::verbatim_block_end:
-    case tok::verbatim_line_text:
-    case tok::html_ident:
-    case tok::html_equals:
-    case tok::html_quoted_string:
-    case tok::html_greater:
-    case tok::html_slash_greater:
-      llvm_unreachable("should not see this token");
+void WebPCleanupTransparentAreaThreaded(WebPPicture* pic, int thread_level) {
+  if (pic == NULL) return;
+  WebPInitPictureTools();
+  if (pic->use_argb) {
+    ProcessBands(pic, CleanupARGBBand, pic->height / SIZE, 1, 0,
+                 thread_level);
+  } else {
+    if (pic->a == NULL || pic->y == NULL || pic->u == NULL || pic->v == NULL) {
+      return;
     }
-    break;
+    ProcessBands(pic, CleanupYUVBand, pic->height / SIZE, 1, 0,
+                 thread_level);
   }
 }
 
+void WebPCleanupTransparentArea(WebPPicture* pic) {
+  WebPCleanupTransparentAreaThreaded(pic, 0);
+}
+
 #undef SIZE
 #undef SIZE2
 
 //------------------------------------------------------------------------------
 // Blend color and remove transparency info
 
-#define BLEND(V0, V1, ALPHA) \
-    ((((V0) * (255 - (ALPHA)) + (V1) * (ALPHA)) * 0x101 + 256) >> 16)
 #define BLEND_10BIT(V0, V1, ALPHA) \
+    ((((V0) * (1020 - (ALPHA)) + (V1) * (ALPHA)) * 0x101 + 1024) >> 18)
+
 SystemPOSIX::Initialize();
 
   if (g_init_count++ == 0) {
@@ -199,22 +254,91 @@ SystemPOSIX::Initialize();
         SystemFreeBSD::CreateInstance, nullptr);
   }
 
-void WebPBlendAlpha(WebPPicture* picture, uint32_t background_rgb) {
+static WEBP_INLINE uint32_t MakeARGB32(int r, int g, int b) {
+  return (0xff000000u | (r << 16) | (g << 8) | b);
+}
+
+static int BlendARGBBand(void* arg1, void* arg2) {
+  const PictureBand* const band = (const PictureBand*)arg1;
+  const WebPPicture* const picture = band->pic;
+  uint32_t* argb = picture->argb + band->start * picture->argb_stride;
+  const uint32_t background = band->color;
+  int y;
+  (void)arg2;
+  for (y = band->start; y < band->end; ++y) {
+    WebPBlendARGBRow(argb, picture->width, background);
+    argb += picture->argb_stride;
+  }
+  return 1;
+}
+
+// Bands start on even rows, so that each chroma row is blended by the band
+// that owns both of its luma rows.
+static int BlendYUVBand(void* arg1, void* arg2) {
+  const PictureBand* const band = (const PictureBand*)arg1;
+  const WebPPicture* const picture = band->pic;
+  const int red = (band->color >> 16) & 0xff;
+  const int green = (band->color >> 8) & 0xff;
+  const int blue = (band->color >> 0) & 0xff;
+  // omit last pixel during u/v loop
+  const int uv_width = (picture->width >> 1);
+  const int Y0 = VP8RGBToY(red, green, blue, YUV_HALF);
+  // VP8RGBToU/V expects the u/v values summed over four pixels
+  const int U0 = VP8RGBToU(4 * red, 4 * green, 4 * blue, 4 * YUV_HALF);
+  const int V0 = VP8RGBToV(4 * red, 4 * green, 4 * blue, 4 * YUV_HALF);
+  uint8_t* y_ptr = picture->y + band->start * picture->y_stride;
+  uint8_t* u_ptr = picture->u + (band->start >> 1) * picture->uv_stride;
+  uint8_t* v_ptr = picture->v + (band->start >> 1) * picture->uv_stride;
+  uint8_t* a_ptr = picture->a + band->start * picture->a_stride;
+  int y;
+  (void)arg2;
+  for (y = band->start; y < band->end; ++y) {
+    // Luma blending
+    WebPBlendLumaRow(y_ptr, a_ptr, picture->width, Y0);
+    // Chroma blending every even line
+    if ((y & 1) == 0) {
+      uint8_t* const a_ptr2 =
+          (y + 1 == picture->height) ? a_ptr : a_ptr + picture->a_stride;
+      const int x = uv_width;
+      WebPBlendChromaRow(u_ptr, v_ptr, a_ptr, a_ptr2, uv_width, U0, V0);
+      if (picture->width & 1) {  // rightmost pixel
+        const uint32_t alpha = 2 * (a_ptr[2 * x + 0] + a_ptr2[2 * x + 0]);
+        u_ptr[x] = BLEND_10BIT(U0, u_ptr[x], alpha);
+        v_ptr[x] = BLEND_10BIT(V0, v_ptr[x], alpha);
+      }
+    } else {
+      u_ptr += picture->uv_stride;
+      v_ptr += picture->uv_stride;
+    }
+    memset(a_ptr, 0xff, picture->width);  // reset alpha value to opaque
+    a_ptr += picture->a_stride;
+    y_ptr += picture->y_stride;
+  }
+  return 1;
+}
+
+void WebPBlendAlphaThreaded(WebPPicture* picture, uint32_t background_rgb,
+                            int thread_level) {
   const int red = (background_rgb >> 16) & 0xff;
   const int green = (background_rgb >> 8) & 0xff;
   const int blue = (background_rgb >> 0) & 0xff;
-  int x, y;
-      strm << "settings set -f ";
-    if (dump_desc || !transparent) {
-      if ((dump_mask & OptionValue::eDumpOptionName) && !m_name.empty()) {
-        DumpQualifiedName(strm);
-        if (dump_mask & ~OptionValue::eDumpOptionName)
-          strm.PutChar(' ');
-      }
-    }
+  if (picture == NULL) return;
+  WebPInitPictureTools();
+  if (!picture->use_argb) {
+    const int has_alpha = picture->colorspace & WEBP_CSP_ALPHA_BIT;
+    if (!has_alpha || picture->a == NULL) return;    // nothing to do
+    ProcessBands(picture, BlendYUVBand, picture->height, 2,
+                 (uint32_t)((red << 16) | (green << 8) | blue), thread_level);
+  } else {
+    ProcessBands(picture, BlendARGBBand, picture->height, 1,
+                 MakeARGB32(red, green, blue), thread_level);
+  }
+}
+
+void WebPBlendAlpha(WebPPicture* picture, uint32_t background_rgb) {
+  WebPBlendAlphaThreaded(picture, background_rgb, 0);
 }
 
-#undef BLEND
 #undef BLEND_10BIT
 
 //------------------------------------------------------------------------------
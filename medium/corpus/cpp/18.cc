@@ -35,6 +35,7 @@
 #endif
 
 #include "hb-shaper-impl.hh"
+#include "hb-shape-plan.hh"
 
 #include "hb-ot-shape.hh"
 #include "hb-ot-shaper.hh"
@@ -415,17 +416,230 @@ static isl::union_map remainingDepsFromSequence(ArrayRef<isl::union_set> Executi
  * shaper face data
  */
 
-struct hb_ot_face_data_t {};
+#ifndef HB_OT_SHAPE_PLAN_CACHE_SIZE
+#define HB_OT_SHAPE_PLAN_CACHE_SIZE 32
+#endif
+
+/* The face data holds a small LRU cache of compiled shape plans, so that
+ * shaping many short strings with a few feature sets does not recompile
+ * the feature maps.  The cache holds a reference to each plan. */
+struct hb_ot_face_data_t
+{
+  hb_mutex_t lock;
+  hb_vector_t<hb_shape_plan_t *> plans; /* Most recently used last. */
+  hb_atomic_int_t hits;
+  hb_atomic_int_t misses;
+
+  /* Glyphs that some GSUB or GPOS lookup may apply to, or that GDEF
+   * classes as marks.  Runs of other glyphs can skip the lookups. */
+  hb_atomic_ptr_t<hb_set_t> complex_glyphs;
+
+  void init0 ()
+  {
+    lock.init ();
+    plans.init ();
+    hits = 0;
+    misses = 0;
+    complex_glyphs.init ();
+  }
+  void fini ()
+  {
+    for (hb_shape_plan_t *plan : plans)
+      hb_shape_plan_destroy (plan);
+    plans.fini ();
+    lock.fini ();
+    hb_set_destroy (complex_glyphs.get_relaxed ());
+  }
+
+  const hb_set_t *get_complex_glyphs (hb_face_t *face);
+};
+
+/* Returns nullptr if the set could not be computed. */
+const hb_set_t *
+hb_ot_face_data_t::get_complex_glyphs (hb_face_t *face)
+{
+retry:
+  hb_set_t *glyphs = complex_glyphs.get_acquire ();
+  if (likely (glyphs))
+    return glyphs;
+
+  glyphs = hb_set_create ();
+  if (unlikely (glyphs == hb_set_get_empty ()))
+    return nullptr;
+
+  const hb_tag_t table_tags[] = {HB_OT_TAG_GSUB, HB_OT_TAG_GPOS};
+  for (hb_tag_t table_tag : table_tags)
+  {
+    unsigned count = hb_ot_layout_table_get_lookup_count (face, table_tag);
+    for (unsigned i = 0; i < count; i++)
+      hb_ot_layout_lookup_collect_glyphs (face, table_tag, i,
+					  nullptr, glyphs, nullptr, nullptr);
+  }
+  hb_ot_layout_get_glyphs_in_class (face, HB_OT_LAYOUT_GLYPH_CLASS_MARK, glyphs);
+
+  if (unlikely (glyphs->in_error ()))
+  {
+    hb_set_destroy (glyphs);
+    return nullptr;
+  }
+
+  if (unlikely (!complex_glyphs.cmpexch (nullptr, glyphs)))
+  {
+    hb_set_destroy (glyphs);
+    goto retry;
+  }
+  return glyphs;
+}
 
 hb_ot_face_data_t *
 _hb_ot_shaper_face_data_create (hb_face_t *face)
 {
-  return (hb_ot_face_data_t *) HB_SHAPER_DATA_SUCCEEDED;
+  hb_ot_face_data_t *data = (hb_ot_face_data_t *) hb_calloc (1, sizeof (hb_ot_face_data_t));
+  if (unlikely (!data))
+    return nullptr;
+
+  data->init0 ();
+  return data;
 }
 
 void
 _hb_ot_shaper_face_data_destroy (hb_ot_face_data_t *data)
 {
+  data->fini ();
+  hb_free (data);
+}
+
+static const char * const hb_ot_shaper_list[] = {"ot", nullptr};
+
+/* Returns a reference to a plan for the key, or nullptr if it is not cached.
+ * Must be called with the lock held. */
+static hb_shape_plan_t *
+hb_ot_face_data_find_plan (hb_ot_face_data_t *data, hb_shape_plan_key_t *key)
+{
+  unsigned count = data->plans.length;
+  for (unsigned i = count; i; i--)
+  {
+    hb_shape_plan_t *plan = data->plans[i - 1];
+    if (!plan->key.equal (key))
+      continue;
+
+    /* Move to the most recently used end. */
+    for (unsigned j = i; j < count; j++)
+      data->plans[j - 1] = data->plans[j];
+    data->plans[count - 1] = plan;
+
+    return hb_shape_plan_reference (plan);
+  }
+  return nullptr;
+}
+
+/**
+ * hb_ot_shape_plan_get_cached:
+ * @face: #hb_face_t to use
+ * @props: The #hb_segment_properties_t of the segment
+ * @user_features: (array length=num_user_features): The list of user-selected features
+ * @num_user_features: The number of user-selected features
+ * @coords: (array length=num_coords): The list of variation-space coordinates
+ * @num_coords: The number of variation-space coordinates
+ *
+ * Returns an OpenType shape plan for the given properties, features and
+ * coordinates, from a bounded least-recently-used cache of plans kept with
+ * @face.  Unlike hb_shape_plan_create_cached2(), the cache does not grow
+ * without limit, and records hits and misses.
+ *
+ * Return value: (transfer full): The shape plan.  Destroy with
+ * hb_shape_plan_destroy() when done.
+ *
+ * Since: REPLACEME
+ **/
+hb_shape_plan_t *
+hb_ot_shape_plan_get_cached (hb_face_t                     *face,
+			     const hb_segment_properties_t *props,
+			     const hb_feature_t            *user_features,
+			     unsigned int                   num_user_features,
+			     const int                     *coords,
+			     unsigned int                   num_coords)
+{
+  hb_ot_face_data_t *data = face->data.ot.get ();
+  if (unlikely (!data))
+    return hb_shape_plan_create2 (face, props,
+				  user_features, num_user_features,
+				  coords, num_coords,
+				  hb_ot_shaper_list);
+
+  hb_shape_plan_key_t key;
+  if (!key.init (false,
+		 face,
+		 props,
+		 user_features,
+		 num_user_features,
+		 coords,
+		 num_coords,
+		 hb_ot_shaper_list))
+    return hb_shape_plan_get_empty ();
+
+  hb_shape_plan_t *plan;
+  {
+    hb_lock_t lock (data->lock);
+    plan = hb_ot_face_data_find_plan (data, &key);
+  }
+  if (plan)
+  {
+    data->hits.inc ();
+    return plan;
+  }
+  data->misses.inc ();
+
+  /* Compile outside the lock; another thread may get there first. */
+  plan = hb_shape_plan_create2 (face, props,
+				user_features, num_user_features,
+				coords, num_coords,
+				hb_ot_shaper_list);
+  if (unlikely (plan == hb_shape_plan_get_empty ()))
+    return plan;
+
+  hb_lock_t lock (data->lock);
+  hb_shape_plan_t *other = hb_ot_face_data_find_plan (data, &key);
+  if (other)
+  {
+    hb_shape_plan_destroy (plan);
+    return other;
+  }
+
+  if (data->plans.length >= HB_OT_SHAPE_PLAN_CACHE_SIZE)
+  {
+    hb_shape_plan_destroy (data->plans[0]);
+    data->plans.remove_ordered (0);
+  }
+  data->plans.push (hb_shape_plan_reference (plan));
+  if (unlikely (data->plans.in_error ()))
+  {
+    /* Out of memory; hand out the plan uncached. */
+    hb_shape_plan_destroy (plan);
+  }
+  return plan;
+}
+
+/**
+ * hb_ot_shape_plan_cache_get_stats:
+ * @face: #hb_face_t to query
+ * @hits: (out) (optional): Number of plan lookups found in the cache
+ * @misses: (out) (optional): Number of plan lookups that compiled a new plan
+ *
+ * Fetches the counters of the shape plan cache of @face, see
+ * hb_ot_shape_plan_get_cached().
+ *
+ * Since: REPLACEME
+ **/
+void
+hb_ot_shape_plan_cache_get_stats (hb_face_t    *face,
+				  unsigned int *hits,
+				  unsigned int *misses)
+{
+  hb_ot_face_data_t *data = face->data.ot.get ();
+
+  if (hits) *hits = data ? (unsigned) data->hits.get_relaxed () : 0;
+  if (misses) *misses = data ? (unsigned) data->misses.get_relaxed () : 0;
 }
 
 
@@ -1001,6 +1215,116 @@ void GISelKnownBits::calculateKnownBitsMin(Register reg1, Register reg2,
 
 
 
+
+/*
+ * Simple runs
+ *
+ * A left-to-right run for the default shaper, whose characters are all
+ * mapped by cmap, and are not marks, default ignorables or otherwise
+ * special, and whose glyphs no GSUB or GPOS lookup of the face applies to,
+ * comes out of the full pipeline unchanged apart from cmap mapping,
+ * advances and kerning.  Such runs skip the pipeline; this covers most
+ * Latin and CJK text in fonts without layout tables for it.
+ */
+
+static inline bool
+hb_ot_is_simple_char (hb_unicode_funcs_t *unicode, hb_codepoint_t u)
+{
+  switch ((unsigned) unicode->general_category (u))
+  {
+    case HB_UNICODE_GENERAL_CATEGORY_CONTROL:
+    case HB_UNICODE_GENERAL_CATEGORY_FORMAT:
+    case HB_UNICODE_GENERAL_CATEGORY_UNASSIGNED:
+    case HB_UNICODE_GENERAL_CATEGORY_SURROGATE:
+    case HB_UNICODE_GENERAL_CATEGORY_SPACING_MARK:
+    case HB_UNICODE_GENERAL_CATEGORY_ENCLOSING_MARK:
+    case HB_UNICODE_GENERAL_CATEGORY_NON_SPACING_MARK:
+    case HB_UNICODE_GENERAL_CATEGORY_LINE_SEPARATOR:
+    case HB_UNICODE_GENERAL_CATEGORY_PARAGRAPH_SEPARATOR:
+      return false;
+    default:
+      break;
+  }
+
+  return !_hb_codepoint_is_regional_indicator (u) &&
+	 !hb_in_range<hb_codepoint_t> (u, 0x1F3FBu, 0x1F3FFu) && /* Emoji modifiers. */
+	 !hb_in_range<hb_codepoint_t> (u, 0xFF9Eu, 0xFF9Fu) && /* Halfwidth Katakana sound marks; cluster continuations. */
+	 u != 0x2044u && /* FRACTION SLASH; see hb_ot_shape_setup_masks_fraction(). */
+	 !hb_unicode_funcs_t::is_default_ignorable (u);
+}
+
+static bool
+hb_ot_shape_simple (const hb_ot_shape_context_t *c)
+{
+#ifdef HB_NO_OT_SHAPE_SIMPLE
+  return false;
+#endif
+
+  const hb_ot_shape_plan_t *plan = c->plan;
+  hb_buffer_t *buffer = c->buffer;
+
+  if (plan->shaper != &_hb_ot_shaper_default ||
+      buffer->props.direction != HB_DIRECTION_LTR)
+    return false;
+#ifndef HB_NO_AAT_SHAPE
+  if (plan->apply_morx || plan->apply_kerx || plan->apply_trak)
+    return false;
+#endif
+
+  hb_ot_face_data_t *data = c->face->data.ot.get ();
+  const hb_set_t *complex_glyphs = data ? data->get_complex_glyphs (c->face) : nullptr;
+  if (unlikely (!complex_glyphs))
+    return false;
+
+  unsigned int count = buffer->len;
+  hb_glyph_info_t *info = buffer->info;
+  for (unsigned int i = 0; i < count; i++)
+  {
+    hb_codepoint_t glyph;
+    if (!hb_ot_is_simple_char (buffer->unicode, info[i].codepoint) ||
+	!c->font->get_nominal_glyph (info[i].codepoint, &glyph) ||
+	complex_glyphs->has (glyph))
+      return false;
+  }
+
+  /* The run is simple; do what the full pipeline would do with it. */
+
+  _hb_buffer_allocate_unicode_vars (buffer);
+  for (unsigned int i = 0; i < count; i++)
+    _hb_glyph_info_set_unicode_props (&info[i], buffer);
+
+  c->font->get_nominal_glyphs (count,
+			       &info[0].codepoint, sizeof (info[0]),
+			       &info[0].codepoint, sizeof (info[0]));
+  buffer->content_type = HB_BUFFER_CONTENT_TYPE_GLYPHS;
+
+  hb_ot_shape_initialize_masks (c);
+  hb_ot_shape_setup_masks (c); /* User features with ranges, eg. kern[2:5]=0. */
+
+  _hb_buffer_allocate_gsubgpos_vars (buffer);
+  hb_ot_layout_substitute_start (c->font, buffer);
+
+  buffer->clear_positions ();
+  hb_ot_position_default (c);
+
+#ifndef HB_NO_OT_KERN
+  if (plan->apply_kern)
+    hb_ot_layout_kern (plan, c->font, buffer);
+  else
+#endif
+  if (plan->apply_fallback_kern)
+    _hb_ot_shape_fallback_kern (plan, c->font, buffer);
+
+  _hb_buffer_deallocate_gsubgpos_vars (buffer);
+
+  hb_propagate_flags (buffer);
+
+  _hb_buffer_deallocate_unicode_vars (buffer);
+
+  return true;
+}
+
+
 hb_bool_t
 _hb_ot_shape (hb_shape_plan_t    *shape_plan,
 	      hb_font_t          *font,
@@ -1009,11 +1333,68 @@ _hb_ot_shape (hb_shape_plan_t    *shape_plan,
 	      unsigned int        num_features)
 {
   hb_ot_shape_context_t c = {&shape_plan->ot, font, font->face, buffer, features, num_features};
-  hb_ot_shape_internal (&c);
+  if (!hb_ot_shape_simple (&c))
+    hb_ot_shape_internal (&c);
 
   return true;
 }
 
+/**
+ * hb_ot_shape_buffers:
+ * @font: #hb_font_t to use for shaping
+ * @buffers: (array length=num_buffers): The buffers to shape
+ * @num_buffers: The number of buffers
+ * @features: (array length=num_features) (nullable): The features to apply
+ * @num_features: The number of features
+ *
+ * Shapes a batch of buffers with the OpenType shaper.  The shape plan is
+ * looked up once for each run of consecutive buffers with the same segment
+ * properties, instead of once per buffer, so batches of short strings in
+ * the same script and language share a single plan lookup.
+ *
+ * Return value: `false` if shaping any of the buffers failed, `true` otherwise.
+ *
+ * Since: REPLACEME
+ **/
+hb_bool_t
+hb_ot_shape_buffers (hb_font_t          *font,
+		     hb_buffer_t       **buffers,
+		     unsigned int        num_buffers,
+		     const hb_feature_t *features,
+		     unsigned int        num_features)
+{
+  hb_bool_t ret = true;
+  hb_shape_plan_t *plan = nullptr;
+
+  for (unsigned int i = 0; i < num_buffers; i++)
+  {
+    hb_buffer_t *buffer = buffers[i];
+
+    if (unlikely (!buffer->len))
+      continue;
+
+    assert (buffer->content_type == HB_BUFFER_CONTENT_TYPE_UNICODE);
+
+    if (!plan || !hb_segment_properties_equal (&plan->key.props, &buffer->props))
+    {
+      hb_shape_plan_destroy (plan);
+      plan = hb_ot_shape_plan_get_cached (font->face, &buffer->props,
+					  features, num_features,
+					  font->coords, font->num_coords);
+    }
+
+    buffer->enter ();
+    if (!hb_shape_plan_execute (plan, font, buffer, features, num_features))
+      ret = false;
+    if (buffer->max_ops <= 0)
+      buffer->shaping_failed = true;
+    buffer->leave ();
+  }
+
+  hb_shape_plan_destroy (plan);
+  return ret;
+}
+
 
 /**
  * hb_ot_shape_plan_collect_lookups:
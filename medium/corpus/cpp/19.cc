@@ -523,6 +523,242 @@ static void _attach_accelerator_data (hb_subset_plan_t* plan,
     hb_subset_accelerator_t::destroy (accel);
 }
 
+#ifndef HB_SUBSET_PLAN_CACHE_SIZE
+#define HB_SUBSET_PLAN_CACHE_SIZE 8
+#endif
+
+/*
+ * Cache of subset plans, for callers that subset the same faces with
+ * the same inputs over and over.  Executing a plan writes the subset into
+ * the plan's destination face, so a plan is never shared: it is taken out
+ * of the cache by hb_subset_plan_cache_get(), which gives it a fresh
+ * destination face, and given back by hb_subset_plan_cache_put().  Plans
+ * hold a reference to their source face, so the cache is owned by the
+ * caller rather than attached to the face.
+ */
+struct hb_subset_plan_cache_t
+{
+  hb_object_header_t header;
+
+  struct entry_t
+  {
+    hb_subset_input_t *input;
+    hb_subset_plan_t *plan;
+  };
+
+  hb_mutex_t lock;
+  unsigned max_plans;
+  hb_vector_t<entry_t> entries; /* Most recently used last. */
+
+  ~hb_subset_plan_cache_t ()
+  {
+    for (const entry_t &entry : entries)
+    {
+      hb_subset_input_destroy (entry.input);
+      hb_subset_plan_destroy (entry.plan);
+    }
+  }
+};
+
+static bool
+_subset_input_is_cacheable (hb_subset_input_t *input)
+{
+  if (!input->axes_location.is_empty ())
+    return false;
+  /* The accelerator is handed to the first subset face and not rebuilt,
+   * so a reused plan would produce a face without it. */
+  if (input->attach_accelerator_data)
+    return false;
+#ifdef HB_EXPERIMENTAL_API
+  if (!input->name_table_overrides.is_empty ())
+    return false;
+#endif
+  return true;
+}
+
+static bool
+_subset_inputs_equal (hb_subset_input_t *a, hb_subset_input_t *b)
+{
+  if (hb_subset_input_get_flags (a) != hb_subset_input_get_flags (b))
+    return false;
+  for (unsigned i = 0; i <= HB_SUBSET_SETS_LAST; i++)
+    if (!hb_set_is_equal (hb_subset_input_set (a, (hb_subset_sets_t) i),
+			  hb_subset_input_set (b, (hb_subset_sets_t) i)))
+      return false;
+  return true;
+}
+
+static hb_subset_input_t *
+_subset_input_copy (hb_subset_input_t *input)
+{
+  hb_subset_input_t *copy = hb_subset_input_create_or_fail ();
+  if (unlikely (!copy)) return nullptr;
+
+  for (unsigned i = 0; i <= HB_SUBSET_SETS_LAST; i++)
+    hb_set_set (hb_subset_input_set (copy, (hb_subset_sets_t) i),
+		hb_subset_input_set (input, (hb_subset_sets_t) i));
+  hb_subset_input_set_flags (copy, hb_subset_input_get_flags (input));
+
+  if (unlikely (copy->in_error ()))
+  {
+    hb_subset_input_destroy (copy);
+    return nullptr;
+  }
+  return copy;
+}
+
+/**
+ * hb_subset_plan_cache_create:
+ * @max_plans: maximum number of plans to keep, or 0 for the default.
+ *
+ * Creates a cache of subset plans, to be used with
+ * hb_subset_plan_cache_get().  The cache is safe to share between
+ * threads.
+ *
+ * Return value: (transfer full): a new #hb_subset_plan_cache_t, or `NULL`
+ * on allocation failure.
+ *
+ * Since: REPLACEME
+ **/
+hb_subset_plan_cache_t *
+hb_subset_plan_cache_create (unsigned int max_plans)
+{
+  hb_subset_plan_cache_t *cache;
+
+  if (!(cache = hb_object_create<hb_subset_plan_cache_t> ()))
+    return nullptr;
+
+  cache->max_plans = max_plans ? max_plans : HB_SUBSET_PLAN_CACHE_SIZE;
+  return cache;
+}
+
+/**
+ * hb_subset_plan_cache_destroy:
+ * @cache: a subset plan cache.
+ *
+ * Destroys @cache, releasing all the plans it holds.
+ *
+ * Since: REPLACEME
+ **/
+void
+hb_subset_plan_cache_destroy (hb_subset_plan_cache_t *cache)
+{
+  if (!hb_object_destroy (cache)) return;
+
+  hb_free (cache);
+}
+
+/**
+ * hb_subset_plan_cache_get:
+ * @cache: a subset plan cache.
+ * @face: font face data to be subset.
+ * @input: input to use for the subsetting.
+ *
+ * Returns a subset plan for @face and @input.  A plan that was given back
+ * to @cache for the same face with an equal input is taken out of the
+ * cache and given a fresh destination face; otherwise a new plan is
+ * created.  The plan is not shared with any other caller.
+ *
+ * Return value: (transfer full): the plan, to be given back with
+ * hb_subset_plan_cache_put() or released with hb_subset_plan_destroy(),
+ * or `NULL` on failure.
+ *
+ * Since: REPLACEME
+ **/
+hb_subset_plan_t *
+hb_subset_plan_cache_get (hb_subset_plan_cache_t *cache,
+			  hb_face_t *face,
+			  hb_subset_input_t *input)
+{
+  if (unlikely (!cache || !_subset_input_is_cacheable (input)))
+    return hb_subset_plan_create_or_fail (face, input);
+
+  hb_subset_plan_cache_t::entry_t entry = {nullptr, nullptr};
+  {
+    hb_lock_t l (cache->lock);
+    for (unsigned i = cache->entries.length; i; i--)
+    {
+      if (cache->entries[i - 1].plan->source != face ||
+	  !_subset_inputs_equal (cache->entries[i - 1].input, input))
+	continue;
+
+      entry = cache->entries[i - 1];
+      cache->entries.remove_ordered (i - 1);
+      break;
+    }
+  }
+
+  if (!entry.plan)
+    return hb_subset_plan_create_or_fail (face, input);
+
+  hb_subset_input_destroy (entry.input);
+
+  hb_face_t *dest = hb_face_builder_create ();
+  if (unlikely (dest == hb_face_get_empty ()))
+  {
+    hb_subset_plan_destroy (entry.plan);
+    return nullptr;
+  }
+  hb_face_destroy (entry.plan->dest);
+  entry.plan->dest = dest;
+
+  return entry.plan;
+}
+
+/**
+ * hb_subset_plan_cache_put:
+ * @cache: a subset plan cache.
+ * @input: the input @plan was created for.
+ * @plan: (transfer full): a plan returned by hb_subset_plan_cache_get().
+ *
+ * Gives @plan back to @cache, to be reused by later calls to
+ * hb_subset_plan_cache_get() with an equal input.  When @cache is full,
+ * the least recently given back plan is released.  Plans that failed or
+ * whose input cannot be cached are released right away; this includes
+ * inputs that attach accelerator data, as from hb_subset_preprocess().
+ *
+ * Since: REPLACEME
+ **/
+void
+hb_subset_plan_cache_put (hb_subset_plan_cache_t *cache,
+			  hb_subset_input_t *input,
+			  hb_subset_plan_t *plan)
+{
+  if (unlikely (!plan)) return;
+
+  if (unlikely (!cache || plan->in_error () ||
+		plan->attach_accelerator_data ||
+		!_subset_input_is_cacheable (input)))
+  {
+    hb_subset_plan_destroy (plan);
+    return;
+  }
+
+  hb_subset_input_t *key = _subset_input_copy (input);
+  if (unlikely (!key))
+  {
+    hb_subset_plan_destroy (plan);
+    return;
+  }
+
+  hb_lock_t l (cache->lock);
+  hb_subset_plan_cache_t::entry_t entry = {key, plan};
+  cache->entries.push (entry);
+  if (unlikely (cache->entries.in_error ()))
+  {
+    hb_subset_input_destroy (key);
+    hb_subset_plan_destroy (plan);
+    return;
+  }
+
+  if (cache->entries.length > cache->max_plans)
+  {
+    hb_subset_input_destroy (cache->entries[0].input);
+    hb_subset_plan_destroy (cache->entries[0].plan);
+    cache->entries.remove_ordered (0);
+  }
+}
+
 /**
  * hb_subset_or_fail:
  * @source: font face data to be subset.
@@ -5,6 +5,14 @@
 
 #include "gzguts.h"
 
+#if !defined(NO_MMAP) && (defined(unix) || defined(__unix__) || \
+                          defined(__unix) || defined(__APPLE__))
+#  define GZ_MMAP
+#  include <limits.h>
+#  include <sys/mman.h>
+#  include <unistd.h>
+#endif
+
 /* Use read() to load a buffer -- return -1 on error, otherwise 0.  Read from
    state->fd, and update state->eof, state->err, and state->msg as appropriate.
    This function needs to loop on read(), since read() is not guaranteed to
@@ -162,6 +170,199 @@ int ZEXPORT gzgetc_(gzFile file) {
     return gzgetc(file);
 }
 
+/* -- see zlib.h -- */
+z_const unsigned char * ZEXPORT gzpeek(gzFile file, unsigned *len) {
+    gz_statep state;
+
+    /* get internal structure */
+    if (len != NULL)
+        *len = 0;
+    if (file == NULL || len == NULL)
+        return NULL;
+    state = (gz_statep)file;
+
+    /* check that we're reading and that there's no (serious) error */
+    if (state->mode != GZ_READ ||
+        (state->err != Z_OK && state->err != Z_BUF_ERROR))
+        return NULL;
+
+    /* process a skip request */
+    if (state->seek) {
+        state->seek = 0;
+        if (gz_skip(state, state->skip) == -1)
+            return NULL;
+    }
+
+    /* refill the output buffer only when it is empty, so that what is
+       returned is always what gzread() or gzgetc() would return next */
+    if (state->x.have == 0) {
+        if (state->eof && state->strm.avail_in == 0) {
+            state->past = 1;
+            return NULL;
+        }
+        if (gz_fetch(state) == -1)
+            return NULL;
+        if (state->x.have == 0) {
+            state->past = 1;
+            return NULL;
+        }
+    }
+    *len = state->x.have;
+    return state->x.next;
+}
+
+/* -- see zlib.h -- */
+int ZEXPORT gzconsume(gzFile file, unsigned len) {
+    gz_statep state;
+
+    /* get internal structure */
+    if (file == NULL)
+        return -1;
+    state = (gz_statep)file;
+
+    /* only what the last gzpeek() returned can be consumed */
+    if (state->mode != GZ_READ || state->seek || len > state->x.have)
+        return -1;
+    state->x.have -= len;
+    state->x.next += len;
+    state->x.pos += len;
+    return 0;
+}
+
+/* Map the rest of the file read by state so that inflate() reads the
+   compressed data directly from the mapping, instead of through read() into
+   state->in.  This is only done for gzip data, so that gz_look() never
+   copies the input to the output buffer, and only when the mapping fits in
+   avail_in.  Since all of the input is then available, state->eof is set and
+   gz_avail() never calls gz_load().  The input buffer is still allocated:
+   gzrewind() and a backward gzseek() reposition the file and clear eof, after
+   which the file is read normally through state->in.  Return -1 if the file
+   cannot be mapped, in which case the file is left as it was and is read
+   normally. */
+int ZEXPORT gzmap(gzFile file) {
+#ifdef GZ_MMAP
+    gz_statep state;
+    z_off64_t end, base;
+    long page;
+    unsigned char *map;
+    size_t maplen;
+    unsigned char *data;
+    unsigned len;
+
+    /* get internal structure */
+    if (file == NULL)
+        return -1;
+    state = (gz_statep)file;
+
+    /* must be reading, with nothing read yet */
+    if (state->mode != GZ_READ || state->size != 0 || state->map != NULL)
+        return -1;
+
+    /* map from the page holding the starting offset to the end of file */
+    end = LSEEK(state->fd, 0, SEEK_END);
+    if (LSEEK(state->fd, state->start, SEEK_SET) == -1 || end == -1)
+        return -1;
+    page = sysconf(_SC_PAGESIZE);
+    if (page <= 0 || end - state->start < 2 ||
+        end - state->start > (z_off64_t)UINT_MAX)
+        return -1;
+    base = state->start - state->start % page;
+    maplen = (size_t)(end - base);
+    map = (unsigned char *)mmap(NULL, maplen, PROT_READ, MAP_PRIVATE,
+                                state->fd, (off_t)base);
+    if (map == (unsigned char *)MAP_FAILED)
+        return -1;
+    data = map + (state->start - base);
+    len = (unsigned)(end - state->start);
+    if (data[0] != 31 || data[1] != 139) {
+        munmap(map, maplen);
+        return -1;
+    }
+#ifdef MADV_SEQUENTIAL
+    madvise(map, maplen, MADV_SEQUENTIAL);
+#endif
+
+    /* set up as gz_look() does */
+    state->in = (unsigned char *)malloc(state->want);
+    state->out = (unsigned char *)malloc(state->want << 1);
+    if (state->in == NULL || state->out == NULL) {
+        free(state->out);
+        free(state->in);
+        state->out = NULL;
+        state->in = NULL;
+        munmap(map, maplen);
+        gz_error(state, Z_MEM_ERROR, "out of memory");
+        return -1;
+    }
+    state->strm.zalloc = Z_NULL;
+    state->strm.zfree = Z_NULL;
+    state->strm.opaque = Z_NULL;
+    state->strm.avail_in = 0;
+    state->strm.next_in = Z_NULL;
+    if (inflateInit2(&(state->strm), 15 + 16) != Z_OK) {
+        free(state->out);
+        free(state->in);
+        state->out = NULL;
+        state->in = NULL;
+        munmap(map, maplen);
+        gz_error(state, Z_MEM_ERROR, "out of memory");
+        return -1;
+    }
+    state->size = state->want;
+    state->map = map;
+    state->maplen = maplen;
+    state->strm.next_in = data;
+    state->strm.avail_in = len;
+    state->eof = 1;
+    return 0;
+#else
+    (void)file;
+    return -1;
+#endif
+}
+
+/* Release the mapping set up by gzmap(), if any. */
+local void gz_unmap(gz_statep state) {
+#ifdef GZ_MMAP
+    if (state->map != NULL) {
+        munmap(state->map, state->maplen);
+        state->map = NULL;
+        state->maplen = 0;
+    }
+#else
+    (void)state;
+#endif
+}
+
+/* -- see zlib.h -- */
+int ZEXPORT gzclose_r(gzFile file) {
+    int ret, err;
+    gz_statep state;
+
+    /* get internal structure */
+    if (file == NULL)
+        return Z_STREAM_ERROR;
+    state = (gz_statep)file;
+
+    /* check that we're reading */
+    if (state->mode != GZ_READ)
+        return Z_STREAM_ERROR;
+
+    /* free memory and close file */
+    if (state->size) {
+        inflateEnd(&(state->strm));
+        free(state->out);
+        free(state->in);
+    }
+    gz_unmap(state);
+    err = state->err == Z_BUF_ERROR ? Z_BUF_ERROR : Z_OK;
+    gz_error(state, Z_OK, NULL);
+    free(state->path);
+    ret = close(state->fd);
+    free(state);
+    return ret ? Z_ERRNO : err;
+}
+
 
 
 // First, check the non-ignored sections.
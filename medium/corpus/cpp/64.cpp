@@ -62,9 +62,18 @@
 #include <vector>
 #include <algorithm>
 #include <assert.h>
+#include <string.h>
 #include "ImfInputPartData.h"
 #include "ImfNamespace.h"
 
+#ifndef _WIN32
+    #include <sys/types.h>
+    #include <sys/stat.h>
+    #include <sys/mman.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
 OPENEXR_IMF_INTERNAL_NAMESPACE_SOURCE_ENTER
 
 using IMATH_NAMESPACE::Box2i;
@@ -227,6 +236,166 @@ TileBuffer::~TileBuffer ()
     delete compressor;
 }
 
+
+struct TileKey
+{
+    int		dx;
+    int		dy;
+    int		lx;
+    int		ly;
+
+    TileKey (int dx = 0, int dy = 0, int lx = 0, int ly = 0);
+};
+
+
+TileKey::TileKey (int tx, int ty, int tlx, int tly):
+    dx (tx),
+    dy (ty),
+    lx (tlx),
+    ly (tly)
+{
+    // empty
+}
+
+
+#ifndef _WIN32
+
+//
+// MappedIFStream is an IStream that maps a whole local file into memory.
+// readMemoryMapped() returns pointers into the mapped pages, so tile
+// data is neither copied into tile buffers nor read with system calls;
+// the compressors read straight from the mapping, and uncompressed
+// tiles are copied from it directly into the frame buffer.  Because a
+// truncated mapping faults rather than failing a read, openInputFile()
+// only uses this class when the caller asks for it.
+//
+
+class MappedIFStream: public OPENEXR_IMF_INTERNAL_NAMESPACE::IStream
+{
+  public:
+
+    static MappedIFStream *	open (const char fileName[]);
+
+    virtual ~MappedIFStream ();
+
+    virtual bool	isMemoryMapped () const		{return true;}
+    virtual bool	read (char c[/*n*/], int n);
+    virtual char *	readMemoryMapped (int n);
+    virtual Int64	tellg ()			{return _pos;}
+    virtual void	seekg (Int64 pos);
+
+  private:
+
+    MappedIFStream (const char fileName[], char *base, Int64 size);
+
+    char *		_base;
+    Int64		_size;
+    Int64		_pos;
+};
+
+
+MappedIFStream *
+MappedIFStream::open (const char fileName[])
+{
+    //
+    // Returns 0 if the file cannot be mapped, for example because
+    // it is empty, or is not a regular file.
+    //
+
+    int fd = ::open (fileName, O_RDONLY);
+
+    if (fd < 0)
+        return 0;
+
+    struct stat st;
+    void *base = MAP_FAILED;
+
+    if (fstat (fd, &st) == 0 && S_ISREG (st.st_mode) && st.st_size > 0)
+        base = mmap (0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    ::close (fd);
+
+    if (base == MAP_FAILED)
+        return 0;
+
+    try
+    {
+        return new MappedIFStream (fileName, (char *) base, st.st_size);
+    }
+    catch (...)
+    {
+        munmap (base, st.st_size);
+        throw;
+    }
+}
+
+
+MappedIFStream::MappedIFStream (const char fileName[], char *base, Int64 size):
+    IStream (fileName),
+    _base (base),
+    _size (size),
+    _pos (0)
+{
+    // empty
+}
+
+
+MappedIFStream::~MappedIFStream ()
+{
+    munmap (_base, _size);
+}
+
+
+bool
+MappedIFStream::read (char c[/*n*/], int n)
+{
+    memcpy (c, readMemoryMapped (n), n);
+    return _pos < _size;
+}
+
+
+char *
+MappedIFStream::readMemoryMapped (int n)
+{
+    if (n < 0 || _pos > _size || n > _size - _pos)
+        throw IEX_NAMESPACE::InputExc ("Unexpected end of file.");
+
+    char *data = _base + _pos;
+    _pos += n;
+    return data;
+}
+
+
+void
+MappedIFStream::seekg (Int64 pos)
+{
+    _pos = pos;
+}
+
+#endif
+
+
+//
+// Open a file for reading.  The file is memory-mapped only if
+// memoryMapped is true and the mapping succeeds: if a mapped file
+// is truncated while it is being read, the process gets a SIGBUS
+// instead of the exception that a StdIFStream would throw.
+//
+
+OPENEXR_IMF_INTERNAL_NAMESPACE::IStream *
+openInputFile (const char fileName[], bool memoryMapped)
+{
+#ifndef _WIN32
+    if (memoryMapped)
+    {
+        if (MappedIFStream *is = MappedIFStream::open (fileName))
+            return is;
+    }
+#endif
+
+    return new StdIFStream (fileName);
+}
+
 } // namespace
 
 
@@ -286,6 +455,11 @@ struct TiledInputFile::Data: public Mutex
     InputStreamMutex * _streamData;
     bool                _deleteStream;
 
+    vector<Int64>   chunkOffsets;                   // sorted offsets of all
+                                                    // tiles in the file, used
+                                                    // to find where a tile's
+                                                    // data ends
+
      Data (int numThreads);
     ~Data ();
 
@@ -324,6 +498,605 @@ TiledInputFile::Data::getTileBuffer (int number)
 }
 
 
+namespace {
+
+//
+// Reads larger than this are not coalesced.
+//
+
+const Int64 maxCoalescedReadSize = 8 * 1024 * 1024;
+
+
+struct TileRequest
+{
+    TileKey	key;
+    Int64	offset;		// start of the tile's chunk in the file
+    Int64	end;		// start of the next chunk in the file,
+				// or 0 if unknown
+
+    TileRequest (const TileKey &k): key (k), offset (0), end (0) {}
+};
+
+
+bool
+offsetLess (const TileRequest &a, const TileRequest &b)
+{
+    return a.offset < b.offset;
+}
+
+
+Box2i
+tileRange (TiledInputFile::Data *ifd, const TileKey &key)
+{
+    return OPENEXR_IMF_INTERNAL_NAMESPACE::dataWindowForTile (
+            ifd->tileDesc,
+            ifd->minX, ifd->maxX,
+            ifd->minY, ifd->maxY,
+            key.dx, key.dy, key.lx, key.ly);
+}
+
+
+void
+copyTileIntoFrameBuffer (TiledInputFile::Data *ifd,
+			 const Box2i &tileRange,
+			 const char *readPtr,
+			 Compressor::Format format)
+{
+    int numPixelsPerScanLine = tileRange.max.x - tileRange.min.x + 1;
+
+    for (int y = tileRange.min.y; y <= tileRange.max.y; ++y)
+    {
+        for (size_t i = 0; i < ifd->slices.size(); ++i)
+        {
+            const TInSliceInfo &slice = ifd->slices[i];
+
+            if (slice.skip)
+            {
+                //
+                // The file contains data for this channel, but
+                // the frame buffer contains no slice for this channel.
+                //
+
+                skipChannel (readPtr, slice.typeInFile, numPixelsPerScanLine);
+            }
+            else
+            {
+                //
+                // The frame buffer contains a slice for this channel.
+                //
+
+                int xOffset = slice.xTileCoords * tileRange.min.x;
+                int yOffset = slice.yTileCoords * tileRange.min.y;
+
+                char *writePtr = slice.base +
+                                 (y - yOffset) * slice.yStride +
+                                 (tileRange.min.x - xOffset) *
+                                 slice.xStride;
+
+                char *endPtr = writePtr +
+                               (numPixelsPerScanLine - 1) * slice.xStride;
+
+                copyIntoFrameBuffer (readPtr, writePtr, endPtr,
+                                     slice.xStride,
+                                     slice.fill, slice.fillValue,
+                                     format,
+                                     slice.typeInFrameBuffer,
+                                     slice.typeInFile);
+            }
+        }
+    }
+}
+
+
+//
+// Data read from the file for a run of tiles.  The reading loop and each
+// TileDecodeTask of the run hold a reference to it, and it is freed as
+// soon as the last of them is done with it, so that only the runs that
+// are still being uncompressed are kept in memory.
+//
+
+class TileDataBuffer: public Mutex
+{
+  public:
+
+    TileDataBuffer (int size): data (max (size, 1)), _refCount (1) {}
+
+    void		addRef ();
+    void		release ();
+
+    vector<char>	data;
+
+  private:
+
+    ~TileDataBuffer () {}
+
+    int			_refCount;
+};
+
+
+void
+TileDataBuffer::addRef ()
+{
+    Lock lock (*this);
+    ++_refCount;
+}
+
+
+void
+TileDataBuffer::release ()
+{
+    bool last;
+
+    {
+        Lock lock (*this);
+        last = (--_refCount == 0);
+    }
+
+    if (last)
+        delete this;
+}
+
+
+//
+// The reading loop's reference to the TileDataBuffer it last read into,
+// if any.
+//
+
+struct TileDataRef
+{
+    TileDataBuffer *	buffer;
+
+    TileDataRef (): buffer (0) {}
+    ~TileDataRef () {reset (0);}
+
+    void
+    reset (TileDataBuffer *b)
+    {
+        if (buffer)
+            buffer->release();
+
+        buffer = b;
+    }
+};
+
+
+//
+// A TileDecodeTask uncompresses one tile and copies its pixels into
+// the frame buffer.  The task holds a
+// reference to the buffer that contains the tile's compressed data,
+// or 0 if the data is in a memory-mapped file.  The task's destructor
+// releases both the data buffer and the tile buffer.
+//
+
+class TileDecodeTask: public Task
+{
+  public:
+
+    TileDecodeTask (TaskGroup *group,
+                    TiledInputFile::Data *ifd,
+                    TileBuffer *tileBuffer,
+                    TileDataBuffer *dataBuffer,
+                    const char *data);
+
+    virtual ~TileDecodeTask ();
+
+    virtual void	execute ();
+
+  private:
+
+    TiledInputFile::Data *	_ifd;
+    TileBuffer *		_tileBuffer;
+    TileDataBuffer *		_dataBuffer;
+    const char *		_data;
+};
+
+
+TileDecodeTask::TileDecodeTask (TaskGroup *group,
+                                TiledInputFile::Data *ifd,
+                                TileBuffer *tileBuffer,
+                                TileDataBuffer *dataBuffer,
+                                const char *data)
+:
+    Task (group),
+    _ifd (ifd),
+    _tileBuffer (tileBuffer),
+    _dataBuffer (dataBuffer),
+    _data (data)
+{
+    if (_dataBuffer)
+        _dataBuffer->addRef();
+}
+
+
+TileDecodeTask::~TileDecodeTask ()
+{
+    if (_dataBuffer)
+        _dataBuffer->release();
+
+    //
+    // Signal that the tile buffer is now free
+    //
+
+    _tileBuffer->post ();
+}
+
+
+void
+TileDecodeTask::execute ()
+{
+    try
+    {
+        TileKey key (_tileBuffer->dx, _tileBuffer->dy,
+                     _tileBuffer->lx, _tileBuffer->ly);
+
+        Box2i range = tileRange (_ifd, key);
+
+        int numPixelsInTile = (range.max.x - range.min.x + 1) *
+                              (range.max.y - range.min.y + 1);
+
+        int sizeOfTile = _ifd->bytesPerPixel * numPixelsInTile;
+
+        //
+        // Uncompress the data, if necessary
+        //
+
+        if (_tileBuffer->compressor && _tileBuffer->dataSize < sizeOfTile)
+        {
+            _tileBuffer->format = _tileBuffer->compressor->format();
+
+            _tileBuffer->dataSize = _tileBuffer->compressor->uncompressTile
+                (_data, _tileBuffer->dataSize,
+                 range, _tileBuffer->uncompressedData);
+        }
+        else
+        {
+            //
+            // If the line is uncompressed, it's in XDR format,
+            // regardless of the compressor's output format.
+            //
+
+            _tileBuffer->format = Compressor::XDR;
+            _tileBuffer->uncompressedData = _data;
+        }
+
+        if (_tileBuffer->dataSize < sizeOfTile)
+            throw IEX_NAMESPACE::InputExc ("Tile data is truncated.");
+
+        copyTileIntoFrameBuffer (_ifd, range,
+                                 _tileBuffer->uncompressedData,
+                                 _tileBuffer->format);
+    }
+    catch (std::exception &e)
+    {
+        if (!_tileBuffer->hasException)
+        {
+            _tileBuffer->exception = e.what ();
+            _tileBuffer->hasException = true;
+        }
+    }
+    catch (...)
+    {
+        if (!_tileBuffer->hasException)
+        {
+            _tileBuffer->exception = "unrecognized exception";
+            _tileBuffer->hasException = true;
+        }
+    }
+}
+
+
+//
+// Find the offset of the chunk that follows the chunk at offset,
+// or return 0 if it is the last chunk or the offsets can't be trusted.
+// Chunks of other parts may be interleaved with ours in a multipart
+// file, and an incomplete file has holes in its offset table, so we
+// only coalesce reads in complete single-part files.
+//
+
+Int64
+chunkEnd (TiledInputFile::Data *ifd, Int64 offset)
+{
+    if (!ifd->fileIsComplete || isMultiPart (ifd->version))
+        return 0;
+
+    if (ifd->chunkOffsets.empty())
+    {
+        for (int ly = 0; ly < ifd->numYLevels; ++ly)
+        {
+            for (int lx = 0; lx < ifd->numXLevels; ++lx)
+            {
+                if (ifd->tileDesc.mode == MIPMAP_LEVELS && lx != ly)
+                    continue;
+
+                for (int dy = 0; dy < ifd->numYTiles[ly]; ++dy)
+                    for (int dx = 0; dx < ifd->numXTiles[lx]; ++dx)
+                        ifd->chunkOffsets.push_back
+                            (ifd->tileOffsets (dx, dy, lx, ly));
+            }
+        }
+
+        std::sort (ifd->chunkOffsets.begin(), ifd->chunkOffsets.end());
+    }
+
+    vector<Int64>::const_iterator i =
+        std::upper_bound (ifd->chunkOffsets.begin(),
+                          ifd->chunkOffsets.end(),
+                          offset);
+
+    if (i == ifd->chunkOffsets.end() || *i - offset > maxCoalescedReadSize)
+        return 0;
+
+    return *i;
+}
+
+
+//
+// Read size bytes at offset.  Data in a memory-mapped stream is not
+// copied; otherwise it is read into a new buffer, which replaces the
+// one held by ref.  No seek is needed if the stream is already
+// positioned at offset.
+//
+
+const char *
+readFileData (TiledInputFile::Data *ifd,
+	      Int64 offset,
+	      int size,
+	      TileDataRef &ref)
+{
+    InputStreamMutex *streamData = ifd->_streamData;
+
+    if (streamData->currentPosition != offset)
+        streamData->is->seekg (offset);
+
+    const char *data;
+
+    if (ifd->memoryMapped)
+    {
+        ref.reset (0);
+        data = streamData->is->readMemoryMapped (size);
+    }
+    else
+    {
+        ref.reset (new TileDataBuffer (size));
+        streamData->is->read (&ref.buffer->data[0], size);
+        data = &ref.buffer->data[0];
+    }
+
+    streamData->currentPosition = offset + size;
+    return data;
+}
+
+
+//
+// Check the header of the chunk at ptr against the tile we expect,
+// and return the size of the chunk's pixel data.  Leaves ptr pointing
+// at the pixel data.
+//
+
+int
+readChunkHeader (TiledInputFile::Data *ifd,
+		 const TileKey &key,
+		 const char *&ptr)
+{
+    if (isMultiPart (ifd->version))
+    {
+        int partNumber;
+        Xdr::read <CharPtrIO> (ptr, partNumber);
+
+        if (partNumber != ifd->partNumber)
+            THROW (IEX_NAMESPACE::ArgExc, "Unexpected part number " << partNumber
+                   << ", should be " << ifd->partNumber << ".");
+    }
+
+    int tileXCoord, tileYCoord, levelX, levelY;
+
+    Xdr::read <CharPtrIO> (ptr, tileXCoord);
+    Xdr::read <CharPtrIO> (ptr, tileYCoord);
+    Xdr::read <CharPtrIO> (ptr, levelX);
+    Xdr::read <CharPtrIO> (ptr, levelY);
+
+    if (tileXCoord != key.dx || tileYCoord != key.dy ||
+        levelX != key.lx || levelY != key.ly)
+    {
+        throw IEX_NAMESPACE::InputExc ("Unexpected tile coordinates.");
+    }
+
+    int dataSize;
+    Xdr::read <CharPtrIO> (ptr, dataSize);
+
+    if (dataSize < 0 || size_t (dataSize) > ifd->tileBufferSize)
+        throw IEX_NAMESPACE::InputExc ("Unexpected tile block length.");
+
+    return dataSize;
+}
+
+
+//
+// Read the tiles in requests into the frame buffer.  The tiles are read
+// in the order in which they are stored in the file, reading runs of
+// adjacent tiles with a single read, and are uncompressed by
+// TileDecodeTasks in the global thread pool, in whatever order the tasks
+// happen to complete.  The data read for a run is freed once its tasks
+// have finished.  The call returns when all of the tiles are in the
+// frame buffer.  The caller must hold the stream lock.
+//
+
+void
+readTileRequests (TiledInputFile::Data *ifd, vector<TileRequest> &requests)
+{
+    for (size_t i = 0; i < requests.size(); ++i)
+    {
+        TileRequest &r = requests[i];
+
+        r.offset = ifd->tileOffsets (r.key.dx, r.key.dy, r.key.lx, r.key.ly);
+
+        if (r.offset <= 0)
+            THROW (IEX_NAMESPACE::InputExc, "Tile (" << r.key.dx << ", " <<
+                   r.key.dy << ", " << r.key.lx << ", " << r.key.ly << ") "
+                   "is missing.");
+    }
+
+    std::sort (requests.begin(), requests.end(), offsetLess);
+
+    //
+    // The requested tiles are all different, so two of them at the
+    // same offset means that the offset table is corrupt.
+    //
+
+    for (size_t i = 1; i < requests.size(); ++i)
+    {
+        if (requests[i].offset == requests[i - 1].offset)
+        {
+            const TileKey &k = requests[i].key;
+
+            THROW (IEX_NAMESPACE::InputExc, "Tile (" << k.dx << ", " <<
+                   k.dy << ", " << k.lx << ", " << k.ly << ") has the "
+                   "same file offset as another tile.");
+        }
+    }
+
+    for (size_t i = 0; i < requests.size(); ++i)
+        requests[i].end = chunkEnd (ifd, requests[i].offset);
+
+    int headerSize = 5 * Xdr::size<int>();
+
+    if (isMultiPart (ifd->version))
+        headerSize += Xdr::size<int>();
+
+    {
+        TaskGroup taskGroup;
+
+        size_t first = 0;
+        int tileNumber = 0;
+
+        while (first < requests.size())
+        {
+            //
+            // Find a run of tiles that follow each other in the file
+            //
+
+            size_t last = first;
+
+            if (requests[first].end != 0)
+            {
+                while (last + 1 < requests.size() &&
+                       requests[last + 1].offset == requests[last].end &&
+                       requests[last + 1].end != 0 &&
+                       requests[last + 1].end - requests[first].offset <=
+                           maxCoalescedReadSize)
+                {
+                    ++last;
+                }
+            }
+
+            TileDataRef data;
+            const char *run = 0;
+            Int64 runSize = 0;
+
+            if (requests[first].end != 0)
+            {
+                runSize = requests[last].end - requests[first].offset;
+                run = readFileData (ifd, requests[first].offset,
+                                    int (runSize), data);
+            }
+
+            for (size_t j = first; j <= last; ++j)
+            {
+                const TileRequest &r = requests[j];
+                const char *ptr;
+                int dataSize;
+
+                if (run)
+                {
+                    Int64 start = r.offset - requests[first].offset;
+
+                    if (r.end - r.offset < headerSize)
+                        throw IEX_NAMESPACE::InputExc ("Unexpected tile "
+                                                       "block length.");
+
+                    ptr = run + start;
+                    dataSize = readChunkHeader (ifd, r.key, ptr);
+
+                    if (headerSize + dataSize > r.end - r.offset)
+                        throw IEX_NAMESPACE::InputExc ("Unexpected tile "
+                                                       "block length.");
+                }
+                else
+                {
+                    //
+                    // We don't know where the chunk ends, so read its
+                    // header first.
+                    //
+
+                    ptr = readFileData (ifd, r.offset, headerSize, data);
+                    dataSize = readChunkHeader (ifd, r.key, ptr);
+                    ptr = readFileData (ifd, r.offset + headerSize,
+                                        dataSize, data);
+                }
+
+                TileBuffer *tileBuffer = ifd->getTileBuffer (tileNumber++);
+
+                //
+                // Wait for the tile buffer to become available
+                //
+
+                tileBuffer->wait ();
+
+                tileBuffer->dx = r.key.dx;
+                tileBuffer->dy = r.key.dy;
+                tileBuffer->lx = r.key.lx;
+                tileBuffer->ly = r.key.ly;
+                tileBuffer->dataSize = dataSize;
+                tileBuffer->uncompressedData = 0;
+
+                ThreadPool::addGlobalTask (new TileDecodeTask (&taskGroup, ifd,
+                                                               tileBuffer,
+                                                               data.buffer,
+                                                               ptr));
+            }
+
+            first = last + 1;
+        }
+
+        //
+        // finish all tasks
+        //
+    }
+
+    //
+    // Exeption handling:
+    //
+    // TileDecodeTask::execute() may have encountered exceptions, but
+    // those exceptions occurred in another thread, not in the thread
+    // that is executing this call to readTileRequests().
+    // TileDecodeTask::execute() has caught all exceptions and stored
+    // the exceptions' what() strings in the tile buffers.
+    // Now we check if any tile buffer contains a stored exception; if
+    // this is the case then we re-throw the exception in this thread.
+    // (It is possible that multiple tile buffers contain stored
+    // exceptions.  We re-throw the first exception we find and
+    // ignore all others.)
+    //
+
+    const string *exception = 0;
+
+    for (size_t i = 0; i < ifd->tileBuffers.size(); ++i)
+    {
+        TileBuffer *tileBuffer = ifd->tileBuffers[i];
+
+        if (tileBuffer->hasException && !exception)
+            exception = &tileBuffer->exception;
+
+        tileBuffer->hasException = false;
+    }
+
+    if (exception)
+        throw IEX_NAMESPACE::IoExc (*exception);
+}
+
+} // namespace
+
+
 void WebXRInterfaceJS::endInitialization() {
 	if (!initialized) {
 		return;
@@ -373,7 +1146,9 @@ void WebXRInterfaceJS::endInitialization() {
 };
 
 
-TiledInputFile::TiledInputFile (const char fileName[], int numThreads):
+TiledInputFile::TiledInputFile (const char fileName[],
+                                int numThreads,
+                                bool memoryMapped):
     _data (new Data (numThreads))
 {
     _data->_streamData=NULL;
@@ -388,7 +1163,8 @@ TiledInputFile::TiledInputFile (const char fileName[], int numThreads):
     IStream* is = 0;
     try
     {
-        is = new StdIFStream (fileName);
+        is = openInputFile (fileName, memoryMapped);
+	_data->memoryMapped = is->isMemoryMapped();
 	readMagicNumberAndVersionField(*is, _data->version);
 
 	//
@@ -850,8 +1626,8 @@ TiledInputFile::readTiles (int dx1, int dx2, int dy1, int dy2, int lx, int ly)
 
         //
         // Determine the first and last tile coordinates in both dimensions.
-        // We always attempt to read the range of tiles in the order that
-        // they are stored in the file.
+        // The tiles are read in the order that they are stored in the
+        // file, see readTileRequests().
         //
 
         if (dx1 > dx2)
@@ -860,52 +1636,21 @@ TiledInputFile::readTiles (int dx1, int dx2, int dy1, int dy2, int lx, int ly)
         if (dy1 > dy2)
             std::swap (dy1, dy2);
 
-        int dyStart = dy1;
-	int dyStop  = dy2 + 1;
-
-        //
-        // Create a task group for all tile buffer tasks.  When the
-	// task group goes out of scope, the destructor waits until
-	// all tasks are complete.
-        //
+        vector<TileRequest> requests;
 
+        for (int dy = dy1; dy <= dy2; ++dy)
         {
-            TaskGroup taskGroup;
-
-	    //
-            // finish all tasks
-	    //
+            for (int dx = dx1; dx <= dx2; ++dx)
+            {
+                if (!isValidTile (dx, dy, lx, ly))
+                    throw IEX_NAMESPACE::ArgExc ("Tried to read a tile outside "
+                                                 "the image file's data window.");
+
+                requests.push_back (TileRequest (TileKey (dx, dy, lx, ly)));
+            }
         }
 
-	//
-	// Exeption handling:
-	//
-	// TileBufferTask::execute() may have encountered exceptions, but
-	// those exceptions occurred in another thread, not in the thread
-	// that is executing this call to TiledInputFile::readTiles().
-	// TileBufferTask::execute() has caught all exceptions and stored
-	// the exceptions' what() strings in the tile buffers.
-	// Now we check if any tile buffer contains a stored exception; if
-	// this is the case then we re-throw the exception in this thread.
-	// (It is possible that multiple tile buffers contain stored
-	// exceptions.  We re-throw the first exception we find and
-	// ignore all others.)
-	//
-
-	const string *exception = 0;
-
-        for (size_t i = 0; i < _data->tileBuffers.size(); ++i)
-	{
-            TileBuffer *tileBuffer = _data->tileBuffers[i];
-
-	    if (tileBuffer->hasException && !exception)
-		exception = &tileBuffer->exception;
-
-	    tileBuffer->hasException = false;
-	}
-
-	if (exception)
-	    throw IEX_NAMESPACE::IoExc (*exception);
+        readTileRequests (_data, requests);
     }
     catch (IEX_NAMESPACE::BaseExc &e)
     {
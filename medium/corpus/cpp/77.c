@@ -73,6 +73,20 @@ Byte info = (event->ucAxisValues[1] & 0x0F);
                 break;
             }
 
+static void _v_writestring(oggpack_buffer *o,const char *s, int bytes){
+
+  while(bytes--){
+    oggpack_write(o,*s++,8);
+  }
+}
+
+static void _v_readstring(oggpack_buffer *o,char *buf,int bytes){
+
+  while(bytes--){
+    *buf++=oggpack_read(o,8);
+  }
+}
+
 static int _v_toupper(int c) {
   return (c >= 'a' && c <= 'z') ? (c & ~('a' - 'A')) : c;
 }
@@ -104,47 +118,250 @@ void vorbis_comment_add_tag(vorbis_comment *vc, const char *tag, const char *con
 }
 
 /* This is more or less the same as strncasecmp - but that doesn't exist
-  unsigned Opcode = MI.getOpcode();
-  switch (Opcode) {
-  default:
-    return X86::COND_INVALID;
-  case X86::JCC_1: {
-    const MCInstrDesc &Desc = MCII.get(Opcode);
-    return static_cast<X86::CondCode>(
-        MI.getOperand(Desc.getNumOperands() - 1).getImm());
-  }
+ * everywhere, and this is a fairly trivial function, so we include it */
+static int tagcompare(const char *s1, const char *s2, int n){
+  int c=0;
+  while(c < n){
+    if(_v_toupper(s1[c]) != _v_toupper(s2[c]))
+      return !0;
+    c++;
   }
+  return 0;
+}
+
+/* comment matches TAG= */
+static int tagmatch(const char *comment, const char *tag, int taglen){
+  return comment && !tagcompare(comment, tag, taglen) && comment[taglen]=='=';
+}
 
 char *vorbis_comment_query(vorbis_comment *vc, const char *tag, int count){
   long i;
   int found = 0;
-  int taglen = strlen(tag)+1; /* +1 for the = we append */
-  char *fulltag = _ogg_malloc(taglen+1);
-
-  strcpy(fulltag, tag);
-  _ogg_free(fulltag);
+  int taglen = strlen(tag);
+
+  for(i=0;i<vc->comments;i++){
+    if(tagmatch(vc->user_comments[i], tag, taglen)){
+      if(count == found) {
+        /* We return a pointer to the data, not a copy */
+        return vc->user_comments[i] + taglen + 1;
+      } else {
+        found++;
+      }
+    }
+  }
   return NULL; /* didn't find anything */
 }
 
 int vorbis_comment_query_count(vorbis_comment *vc, const char *tag){
   int i,count=0;
-  int taglen = strlen(tag)+1; /* +1 for the = we append */
-  char *fulltag = _ogg_malloc(taglen+1);
-  strcpy(fulltag,tag);
-// -------------------------------------
+  int taglen = strlen(tag);
 
-U_CAPI UBool U_EXPORT2
-ucurr_deregister(UCurrRegistryKey index, UErrorCode* errorCode)
-{
-    UBool result = false;
-    if (!errorCode || *errorCode == U_SUCCESS) {
-        result = CReg::remove(index);
+  for(i=0;i<vc->comments;i++){
+    if(tagmatch(vc->user_comments[i], tag, taglen))
+      count++;
+  }
+
+  return count;
+}
+
+/* Optional lookup index for files with many comments.  vorbis_comment
+   is public and can't grow, so the index is a separate object that
+   refers back to it.  The table is built on the first query and picks
+   up comments appended with vorbis_comment_add() since; comments edited
+   in place or a vorbis_comment refilled from scratch need a fresh
+   index. */
+
+typedef struct {
+  unsigned int hash;   /* of the case folded tag */
+  int taglen;
+  int first;           /* comment numbers, in stream order */
+  int last;
+  int count;
+} vorbis_comment_key;
+
+typedef struct vorbis_comment_index vorbis_comment_index;
+
+struct vorbis_comment_index {
+  vorbis_comment     *vc;
+  int                 indexed;   /* comments covered by the table */
+  int                *next;      /* next comment with the same tag, or -1 */
+  int                 nextsize;
+  vorbis_comment_key *keys;      /* open addressed, power of two */
+  int                 mask;
+  int                 used;
+};
+
+static unsigned int _vc_hash(const char *s, int n){
+  unsigned int h=2166136261U;
+  while(n--){
+    h^=(unsigned char)_v_toupper(*s++);
+    h*=16777619U;
+  }
+  return h;
+}
+
+static vorbis_comment_key *_vc_find(vorbis_comment_index *ix,
+                                    const char *tag, int taglen,
+                                    unsigned int hash){
+  int i=hash&ix->mask;
+  while(ix->keys[i].count){
+    vorbis_comment_key *k=ix->keys+i;
+    if(k->hash==hash && k->taglen==taglen &&
+       !tagcompare(ix->vc->user_comments[k->first], tag, taglen))
+      return k;
+    i=(i+1)&ix->mask;
+  }
+  return ix->keys+i; /* empty slot */
+}
+
+static int _vc_rehash(vorbis_comment_index *ix, int size){
+  vorbis_comment_key *old=ix->keys;
+  int oldsize=ix->keys?ix->mask+1:0;
+  int i;
+
+  ix->keys=_ogg_calloc(size,sizeof(*ix->keys));
+  if(!ix->keys){
+    ix->keys=old;
+    return OV_EFAULT;
+  }
+  ix->mask=size-1;
+  for(i=0;i<oldsize;i++)
+    if(old[i].count){
+      int j=old[i].hash&ix->mask;
+      while(ix->keys[j].count)j=(j+1)&ix->mask;
+      ix->keys[j]=old[i];
     }
-    return !result;
+  if(old)_ogg_free(old);
+  return 0;
 }
 
-  _ogg_free(fulltag);
-  return count;
+static void _vc_index_drop(vorbis_comment_index *ix){
+  if(ix->keys)_ogg_free(ix->keys);
+  if(ix->next)_ogg_free(ix->next);
+  ix->keys=NULL;
+  ix->next=NULL;
+  ix->nextsize=0;
+  ix->mask=0;
+  ix->used=0;
+  ix->indexed=0;
+}
+
+/* bring the table up to date; nonzero if it couldn't be */
+static int _vc_index_update(vorbis_comment_index *ix){
+  vorbis_comment *vc=ix->vc;
+  int i;
+
+  if(vc->comments<ix->indexed)_vc_index_drop(ix);
+  if(vc->comments==ix->indexed && ix->keys)return 0;
+
+  if(ix->nextsize<vc->comments){
+    int size=ix->nextsize?ix->nextsize:16;
+    int *next;
+    while(size<vc->comments)size<<=1;
+    next=_ogg_realloc(ix->next,size*sizeof(*ix->next));
+    if(!next)return OV_EFAULT;
+    ix->next=next;
+    ix->nextsize=size;
+  }
+  {
+    int size=ix->keys?ix->mask+1:16;
+    while(size<2*vc->comments)size<<=1;
+    if(!ix->keys || size>ix->mask+1)
+      if(_vc_rehash(ix,size))return OV_EFAULT;
+  }
+
+  for(i=ix->indexed;i<vc->comments;i++){
+    const char *c=vc->user_comments[i];
+    const char *eq=c?strchr(c,'='):NULL;
+    vorbis_comment_key *k;
+    unsigned int hash;
+    int taglen;
+
+    ix->next[i]=-1;
+    if(!eq)continue;
+    taglen=eq-c;
+    hash=_vc_hash(c,taglen);
+    k=_vc_find(ix,c,taglen,hash);
+    if(k->count){
+      ix->next[k->last]=i;
+      k->last=i;
+      k->count++;
+    }else{
+      k->hash=hash;
+      k->taglen=taglen;
+      k->first=k->last=i;
+      k->count=1;
+      ix->used++;
+    }
+  }
+  ix->indexed=vc->comments;
+  return 0;
+}
+
+/* finds tag's key, NULL if absent; nonzero if the table can't answer
+   (a tag containing '=', or no memory for the table) */
+static int _vc_lookup(vorbis_comment_index *ix, const char *tag, int taglen,
+                      vorbis_comment_key **key){
+  vorbis_comment_key *k;
+  if(memchr(tag,'=',taglen) || _vc_index_update(ix))return -1;
+  k=_vc_find(ix,tag,taglen,_vc_hash(tag,taglen));
+  *key=k->count?k:NULL;
+  return 0;
+}
+
+vorbis_comment_index *vorbis_comment_index_create(vorbis_comment *vc){
+  vorbis_comment_index *ix=_ogg_calloc(1,sizeof(*ix));
+  if(ix)ix->vc=vc;
+  return ix;
+}
+
+void vorbis_comment_index_destroy(vorbis_comment_index *ix){
+  if(ix){
+    _vc_index_drop(ix);
+    _ogg_free(ix);
+  }
+}
+
+char *vorbis_comment_index_query(vorbis_comment_index *ix, const char *tag,
+                                 int count){
+  int taglen=strlen(tag);
+  vorbis_comment_key *k;
+  int i;
+
+  if(_vc_lookup(ix,tag,taglen,&k))
+    return vorbis_comment_query(ix->vc,tag,count);
+  if(!k || count<0 || count>=k->count)return NULL;
+  for(i=k->first;count--;)i=ix->next[i];
+  return ix->vc->user_comments[i]+taglen+1;
+}
+
+int vorbis_comment_index_query_count(vorbis_comment_index *ix,
+                                     const char *tag){
+  vorbis_comment_key *k;
+
+  if(_vc_lookup(ix,tag,strlen(tag),&k))
+    return vorbis_comment_query_count(ix->vc,tag);
+  return k?k->count:0;
+}
+
+/* Looks up ntags tags at once; values[i] receives the first value of
+   tags[i] (or NULL) and counts[i] the number of values.  Either output
+   array may be NULL. */
+void vorbis_comment_index_query_batch(vorbis_comment_index *ix,
+                                      const char *const *tags, int ntags,
+                                      char **values, int *counts){
+  int i;
+  for(i=0;i<ntags;i++){
+    int taglen=strlen(tags[i]);
+    vorbis_comment_key *k;
+    if(_vc_lookup(ix,tags[i],taglen,&k)){
+      if(values)values[i]=vorbis_comment_query(ix->vc,tags[i],0);
+      if(counts)counts[i]=vorbis_comment_query_count(ix->vc,tags[i]);
+    }else{
+      if(values)values[i]=k?ix->vc->user_comments[k->first]+taglen+1:NULL;
+      if(counts)counts[i]=k?k->count:0;
+    }
+  }
 }
 
 if (overrun_behavior != TextServer::OVERRUN_NO_TRIMMING) {
@@ -239,32 +456,62 @@ static int _vorbis_unpack_comment(vorbis_comment *vc,oggpack_buffer *opb){
    with bitstream comments and a third packet that holds the
 
 
-static int _vorbis_pack_comment(oggpack_buffer *opb,vorbis_comment *vc){
-  int bytes = strlen(ENCODE_VENDOR_STRING);
+/* The comment packet is byte aligned up to the framing bit, so it is
+   written straight from the comment strings into a buffer of exactly
+   the right size rather than grown through an oggpack_buffer and copied
+   out again. */
+
+static unsigned char *_v_write32(unsigned char *p,unsigned long v){
+  p[0]=v&0xff;
+  p[1]=(v>>8)&0xff;
+  p[2]=(v>>16)&0xff;
+  p[3]=(v>>24)&0xff;
+  return p+4;
+}
+
+static int _vorbis_pack_comment(vorbis_comment *vc,
+                                unsigned char **packet,long *bytes){
+  long vendorlen=strlen(ENCODE_VENDOR_STRING);
+  long size=1+6+4+vendorlen+4+1; /* framing bit rounds up to a byte */
+  unsigned char *p;
+  int i;
+
+  for(i=0;i<vc->comments;i++){
+    if(vc->user_comments[i]){
+      if(vc->comment_lengths[i]<0 ||
+         vc->comment_lengths[i]>0x7fffffffL-size-4)return(OV_EIMPL);
+      size+=vc->comment_lengths[i];
+    }
+    size+=4;
+  }
+
+  p=*packet=_ogg_malloc(size);
+  if(!p)return(OV_EFAULT);
 
   /* preamble */
-  oggpack_write(opb,0x03,8);
-  _v_writestring(opb,"vorbis", 6);
+  *p++=0x03;
+  memcpy(p,"vorbis",6);
+  p+=6;
 
   /* vendor */
-  oggpack_write(opb,bytes,32);
-  _v_writestring(opb,ENCODE_VENDOR_STRING, bytes);
+  p=_v_write32(p,vendorlen);
+  memcpy(p,ENCODE_VENDOR_STRING,vendorlen);
+  p+=vendorlen;
 
   /* comments */
+  p=_v_write32(p,vc->comments);
+  for(i=0;i<vc->comments;i++){
+    if(vc->user_comments[i]){
+      p=_v_write32(p,vc->comment_lengths[i]);
+      memcpy(p,vc->user_comments[i],vc->comment_lengths[i]);
+      p+=vc->comment_lengths[i];
+    }else{
+      p=_v_write32(p,0);
+    }
+  }
+  *p=1;
 
-const SDL_RenderCommandType nextCmdType = getNextCmd->type;
-                        if (nextCmdType != SDL_RENDERCMD_FILL_RECTS) {
-                            break; // can't go any further on this fill call, different render command up next.
-                        } else if (getNextCmd->data.fill.count != 3) {
-                            break; // can't go any further on this fill call, those are joined rects
-                        } else if (getNextCmd->data.fill.color != thisColor) {
-                            break; // can't go any further on this fill call, different fill color copy up next.
-                        } else {
-                            finalCmd = getNextCmd; // we can combine fill operations here. Mark this one as the furthest okay command.
-                            count += getNextCmd->data.fill.count;
-                        }
-  oggpack_write(opb,1,1);
-
+  *bytes=size;
   return(0);
 }
 
@@ -350,24 +597,14 @@ err_out:
 int vorbis_commentheader_out(vorbis_comment *vc,
                                           ogg_packet *op){
 
-  oggpack_buffer opb;
-
-  oggpack_writeinit(&opb);
-  if(_vorbis_pack_comment(&opb,vc)){
-    oggpack_writeclear(&opb);
+  if(_vorbis_pack_comment(vc,&op->packet,&op->bytes))
     return OV_EIMPL;
-  }
 
-  op->packet = _ogg_malloc(oggpack_bytes(&opb));
-  memcpy(op->packet, opb.buffer, oggpack_bytes(&opb));
-
-  op->bytes=oggpack_bytes(&opb);
   op->b_o_s=0;
   op->e_o_s=0;
   op->granulepos=0;
   op->packetno=1;
 
-  oggpack_writeclear(&opb);
   return 0;
 }
 
@@ -438,14 +675,10 @@ error = sfnt->load_svg_doc2( (FT_GlyphSlot)glyph, glyph_index );
 
   /* second header packet (comments) **********************************/
 
-  oggpack_reset(&opb);
-  if(_vorbis_pack_comment(&opb,vc))goto err_out;
-
   if(b->header1)_ogg_free(b->header1);
-  b->header1=_ogg_malloc(oggpack_bytes(&opb));
-  memcpy(b->header1,opb.buffer,oggpack_bytes(&opb));
+  b->header1=NULL;
+  if(_vorbis_pack_comment(vc,&b->header1,&op_comm->bytes))goto err_out;
   op_comm->packet=b->header1;
-  op_comm->bytes=oggpack_bytes(&opb);
   op_comm->b_o_s=0;
   op_comm->e_o_s=0;
   op_comm->granulepos=0;
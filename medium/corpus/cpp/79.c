@@ -55,6 +55,14 @@
 
 #include <string.h>
 
+/* SSE2 lanes for the multi-buffer hashing functions */
+#if defined(MBEDTLS_MD_C) && \
+    (defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define MD_MULTI_SSE2
+#include <emmintrin.h>
+#endif
+
 #if defined(MBEDTLS_FS_IO)
 #include <stdio.h>
 #endif
@@ -541,6 +549,583 @@ cleanup:
     return ret;
 }
 
+/*
+ * Multi-buffer hashing
+ *
+ * With the built-in software SHA-256 (no MBEDTLS_SHA256_ALT, no
+ * accelerated path), SHA-224 and SHA-256 messages are hashed
+ * MD_MULTI_LANES at a time, one message per lane of a vector of 32-bit
+ * words. Each lane is fed the 64-byte blocks of its own message; when a
+ * message is done, its digest is written out and the lane moves on to the
+ * next message, so messages of different lengths share the lanes
+ * efficiently. Hashes done by PSA, the other hashes and the other SHA-256
+ * builds go through mbedtls_md_starts(), mbedtls_md_update() and
+ * mbedtls_md_finish() one message at a time, with a single context for the
+ * whole batch. For HMAC, a batch hashes the ipad and opad blocks only once
+ * per key.
+ */
+#if defined(MBEDTLS_MD_C) && \
+    (defined(MBEDTLS_SHA224_C) || defined(MBEDTLS_SHA256_C)) && \
+    !defined(MBEDTLS_SHA256_ALT) && \
+    !defined(MBEDTLS_SHA256_USE_ARMV8_A_CRYPTO_IF_PRESENT) && \
+    !defined(MBEDTLS_SHA256_USE_ARMV8_A_CRYPTO_ONLY) && \
+    !defined(MBEDTLS_SHA256_USE_A64_CRYPTO_IF_PRESENT) && \
+    !defined(MBEDTLS_SHA256_USE_A64_CRYPTO_ONLY)
+#define MD_MULTI_HAVE_LANES
+#endif
+
+#if defined(MD_MULTI_HAVE_LANES)
+
+#define MD_MULTI_LANES      4
+#define MD_MULTI_BLOCK_SIZE 64
+
+#if defined(MD_MULTI_SSE2)
+
+typedef __m128i md_lanes_t;
+
+static inline md_lanes_t lanes_add(md_lanes_t a, md_lanes_t b)
+{
+    return _mm_add_epi32(a, b);
+}
+
+static inline md_lanes_t lanes_xor(md_lanes_t a, md_lanes_t b)
+{
+    return _mm_xor_si128(a, b);
+}
+
+static inline md_lanes_t lanes_and(md_lanes_t a, md_lanes_t b)
+{
+    return _mm_and_si128(a, b);
+}
+
+static inline md_lanes_t lanes_or(md_lanes_t a, md_lanes_t b)
+{
+    return _mm_or_si128(a, b);
+}
+
+/* ~a & b */
+static inline md_lanes_t lanes_andnot(md_lanes_t a, md_lanes_t b)
+{
+    return _mm_andnot_si128(a, b);
+}
+
+#define LANES_SHR(a, n)     _mm_srli_epi32(a, n)
+#define LANES_ROTL(a, n)    _mm_or_si128(_mm_slli_epi32(a, n), _mm_srli_epi32(a, 32 - (n)))
+
+static inline md_lanes_t lanes_set1(uint32_t x)
+{
+    return _mm_set1_epi32((int) x);
+}
+
+static inline md_lanes_t lanes_load_be(const unsigned char *p[MD_MULTI_LANES],
+                                       size_t offset)
+{
+    return _mm_setr_epi32((int) MBEDTLS_GET_UINT32_BE(p[0], offset),
+                          (int) MBEDTLS_GET_UINT32_BE(p[1], offset),
+                          (int) MBEDTLS_GET_UINT32_BE(p[2], offset),
+                          (int) MBEDTLS_GET_UINT32_BE(p[3], offset));
+}
+
+static inline uint32_t lanes_get(md_lanes_t a, int lane)
+{
+    uint32_t v[MD_MULTI_LANES];
+
+    _mm_storeu_si128((__m128i *) v, a);
+    return v[lane];
+}
+
+static inline md_lanes_t lanes_put(md_lanes_t a, int lane, uint32_t x)
+{
+    uint32_t v[MD_MULTI_LANES];
+
+    _mm_storeu_si128((__m128i *) v, a);
+    v[lane] = x;
+    return _mm_loadu_si128((const __m128i *) v);
+}
+
+#else /* MD_MULTI_SSE2 */
+
+/*
+ * Portable lanes. The loops are simple enough for compilers to vectorise.
+ */
+typedef struct {
+    uint32_t v[MD_MULTI_LANES];
+} md_lanes_t;
+
+#define LANES_OP(name, expr)                                \
+    static inline md_lanes_t name(md_lanes_t a, md_lanes_t b) \
+    {                                                       \
+        md_lanes_t r;                                       \
+        int l;                                              \
+        for (l = 0; l < MD_MULTI_LANES; l++) {              \
+            r.v[l] = (expr);                                \
+        }                                                   \
+        return r;                                           \
+    }
+
+LANES_OP(lanes_add, a.v[l] + b.v[l])
+LANES_OP(lanes_xor, a.v[l] ^ b.v[l])
+LANES_OP(lanes_and, a.v[l] & b.v[l])
+LANES_OP(lanes_or, a.v[l] | b.v[l])
+LANES_OP(lanes_andnot, ~a.v[l] & b.v[l])
+
+#undef LANES_OP
+
+static inline md_lanes_t lanes_shr(md_lanes_t a, int n)
+{
+    int l;
+
+    for (l = 0; l < MD_MULTI_LANES; l++) {
+        a.v[l] >>= n;
+    }
+    return a;
+}
+
+static inline md_lanes_t lanes_rotl(md_lanes_t a, int n)
+{
+    int l;
+
+    for (l = 0; l < MD_MULTI_LANES; l++) {
+        a.v[l] = (a.v[l] << n) | (a.v[l] >> (32 - n));
+    }
+    return a;
+}
+
+#define LANES_SHR(a, n)     lanes_shr(a, n)
+#define LANES_ROTL(a, n)    lanes_rotl(a, n)
+
+static inline md_lanes_t lanes_set1(uint32_t x)
+{
+    md_lanes_t r;
+    int l;
+
+    for (l = 0; l < MD_MULTI_LANES; l++) {
+        r.v[l] = x;
+    }
+    return r;
+}
+
+static inline md_lanes_t lanes_load_be(const unsigned char *p[MD_MULTI_LANES],
+                                       size_t offset)
+{
+    md_lanes_t r;
+    int l;
+
+    for (l = 0; l < MD_MULTI_LANES; l++) {
+        r.v[l] = MBEDTLS_GET_UINT32_BE(p[l], offset);
+    }
+    return r;
+}
+
+static inline uint32_t lanes_get(md_lanes_t a, int lane)
+{
+    return a.v[lane];
+}
+
+static inline md_lanes_t lanes_put(md_lanes_t a, int lane, uint32_t x)
+{
+    a.v[lane] = x;
+    return a;
+}
+
+#endif /* MD_MULTI_SSE2 */
+
+#if defined(MBEDTLS_SHA224_C)
+static const uint32_t md_multi_sha224_iv[8] = {
+    0xC1059ED8, 0x367CD507, 0x3070DD17, 0xF70E5939,
+    0xFFC00B31, 0x68581511, 0x64F98FA7, 0xBEFA4FA4
+};
+#endif
+
+#if defined(MBEDTLS_SHA256_C)
+static const uint32_t md_multi_sha256_iv[8] = {
+    0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A,
+    0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19
+};
+#endif
+
+static const uint32_t md_multi_k256[64] = {
+    0x428A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5,
+    0x3956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5,
+    0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3,
+    0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF174,
+    0xE49B69C1, 0xEFBE4786, 0x0FC19DC6, 0x240CA1CC,
+    0x2DE92C6F, 0x4A7484AA, 0x5CB0A9DC, 0x76F988DA,
+    0x983E5152, 0xA831C66D, 0xB00327C8, 0xBF597FC7,
+    0xC6E00BF3, 0xD5A79147, 0x06CA6351, 0x14292967,
+    0x27B70A85, 0x2E1B2138, 0x4D2C6DFC, 0x53380D13,
+    0x650A7354, 0x766A0ABB, 0x81C2C92E, 0x92722C85,
+    0xA2BFE8A1, 0xA81A664B, 0xC24B8B70, 0xC76C51A3,
+    0xD192E819, 0xD6990624, 0xF40E3585, 0x106AA070,
+    0x19A4C116, 0x1E376C08, 0x2748774C, 0x34B0BCB5,
+    0x391C0CB3, 0x4ED8AA4A, 0x5B9CCA4F, 0x682E6FF3,
+    0x748F82EE, 0x78A5636F, 0x84C87814, 0x8CC70208,
+    0x90BEFFFA, 0xA4506CEB, 0xBEF9A3F7, 0xC67178F2,
+};
+
+static void md_multi_sha256_block(md_lanes_t state[],
+                                  const unsigned char *blocks[MD_MULTI_LANES])
+{
+    md_lanes_t W[16], A[8], s0, s1, t1, t2;
+    int i;
+
+    for (i = 0; i < 8; i++) {
+        A[i] = state[i];
+    }
+
+    for (i = 0; i < 64; i++) {
+        if (i < 16) {
+            W[i] = lanes_load_be(blocks, 4 * i);
+        } else {
+            s0 = W[(i - 15) & 15];
+            s0 = lanes_xor(lanes_xor(LANES_ROTL(s0, 25), LANES_ROTL(s0, 14)),
+                           LANES_SHR(s0, 3));
+            s1 = W[(i - 2) & 15];
+            s1 = lanes_xor(lanes_xor(LANES_ROTL(s1, 15), LANES_ROTL(s1, 13)),
+                           LANES_SHR(s1, 10));
+            W[i & 15] = lanes_add(lanes_add(W[i & 15], s0),
+                                  lanes_add(W[(i - 7) & 15], s1));
+        }
+
+        /* t1 = h + S1(e) + Ch(e, f, g) + K[i] + W[i] */
+        s1 = lanes_xor(lanes_xor(LANES_ROTL(A[4], 26), LANES_ROTL(A[4], 21)),
+                       LANES_ROTL(A[4], 7));
+        t1 = lanes_xor(lanes_and(A[4], A[5]), lanes_andnot(A[4], A[6]));
+        t1 = lanes_add(lanes_add(A[7], s1),
+                       lanes_add(t1, lanes_add(lanes_set1(md_multi_k256[i]),
+                                               W[i & 15])));
+
+        /* t2 = S0(a) + Maj(a, b, c) */
+        s0 = lanes_xor(lanes_xor(LANES_ROTL(A[0], 30), LANES_ROTL(A[0], 19)),
+                       LANES_ROTL(A[0], 10));
+        t2 = lanes_or(lanes_and(A[0], A[1]),
+                      lanes_and(A[2], lanes_or(A[0], A[1])));
+        t2 = lanes_add(s0, t2);
+
+        A[7] = A[6];
+        A[6] = A[5];
+        A[5] = A[4];
+        A[4] = lanes_add(A[3], t1);
+        A[3] = A[2];
+        A[2] = A[1];
+        A[1] = A[0];
+        A[0] = lanes_add(t1, t2);
+    }
+
+    for (i = 0; i < 8; i++) {
+        state[i] = lanes_add(state[i], A[i]);
+    }
+}
+
+typedef struct {
+    mbedtls_md_type_t type;
+    unsigned char words;        /* number of state words */
+    const uint32_t *iv;
+    void (*block)(md_lanes_t state[], const unsigned char *blocks[MD_MULTI_LANES]);
+} md_multi_kernel_t;
+
+static const md_multi_kernel_t md_multi_kernels[] = {
+#if defined(MBEDTLS_SHA224_C)
+    { MBEDTLS_MD_SHA224, 8, md_multi_sha224_iv, md_multi_sha256_block },
+#endif
+#if defined(MBEDTLS_SHA256_C)
+    { MBEDTLS_MD_SHA256, 8, md_multi_sha256_iv, md_multi_sha256_block },
+#endif
+};
+
+static const md_multi_kernel_t *md_multi_kernel_from_type(mbedtls_md_type_t md_type)
+{
+    size_t i;
+
+    for (i = 0; i < sizeof(md_multi_kernels) / sizeof(md_multi_kernels[0]); i++) {
+        if (md_multi_kernels[i].type == md_type) {
+            return &md_multi_kernels[i];
+        }
+    }
+    return NULL;
+}
+
+/*
+ * The progress of one lane through its current message. The full blocks
+ * are read in place; the rest of the message and the padding are copied
+ * into tail.
+ */
+typedef struct {
+    size_t job;                 /* index of the message */
+    const unsigned char *p;     /* next full block */
+    size_t left;                /* bytes of full blocks left */
+    unsigned char tail[2 * MD_MULTI_BLOCK_SIZE];
+    size_t tail_len;
+    size_t tail_pos;
+} md_multi_lane_t;
+
+static void md_multi_lane_start(md_multi_lane_t *lane, size_t job,
+                                const unsigned char *input, size_t ilen)
+{
+    size_t rem = ilen % MD_MULTI_BLOCK_SIZE;
+    uint64_t bits = (uint64_t) ilen << 3;
+
+    lane->job = job;
+    lane->p = input;
+    lane->left = ilen - rem;
+    lane->tail_len = rem < MD_MULTI_BLOCK_SIZE - 8 ?
+                     MD_MULTI_BLOCK_SIZE : 2 * MD_MULTI_BLOCK_SIZE;
+    lane->tail_pos = 0;
+
+    memset(lane->tail, 0, lane->tail_len);
+    if (rem > 0) {
+        memcpy(lane->tail, input + lane->left, rem);
+    }
+    lane->tail[rem] = 0x80;
+    MBEDTLS_PUT_UINT32_BE((uint32_t) (bits >> 32), lane->tail, lane->tail_len - 8);
+    MBEDTLS_PUT_UINT32_BE((uint32_t) bits, lane->tail, lane->tail_len - 4);
+}
+
+static const unsigned char *md_multi_lane_next(md_multi_lane_t *lane)
+{
+    const unsigned char *block;
+
+    if (lane->left > 0) {
+        block = lane->p;
+        lane->p += MD_MULTI_BLOCK_SIZE;
+        lane->left -= MD_MULTI_BLOCK_SIZE;
+    } else {
+        block = lane->tail + lane->tail_pos;
+        lane->tail_pos += MD_MULTI_BLOCK_SIZE;
+    }
+    return block;
+}
+
+static int md_multi_lane_done(const md_multi_lane_t *lane)
+{
+    return lane->left == 0 && lane->tail_pos == lane->tail_len;
+}
+
+/*
+ * Hash count messages. An output buffer may be the same as its input.
+ */
+static void md_multi_run(const md_multi_kernel_t *kernel, size_t count,
+                         const unsigned char * const input[],
+                         const size_t ilen[],
+                         unsigned char * const output[],
+                         size_t output_size)
+{
+    static const unsigned char idle_block[MD_MULTI_BLOCK_SIZE] = { 0 };
+    md_multi_lane_t lanes[MD_MULTI_LANES];
+    int active[MD_MULTI_LANES];
+    const unsigned char *blocks[MD_MULTI_LANES];
+    md_lanes_t state[8];
+    size_t next = 0, i;
+    int l, busy;
+
+    for (i = 0; i < kernel->words; i++) {
+        state[i] = lanes_set1(0);
+    }
+    for (l = 0; l < MD_MULTI_LANES; l++) {
+        active[l] = 0;
+    }
+
+    for (;;) {
+        busy = 0;
+        for (l = 0; l < MD_MULTI_LANES; l++) {
+            if (!active[l] && next < count) {
+                md_multi_lane_start(&lanes[l], next, input[next], ilen[next]);
+                for (i = 0; i < kernel->words; i++) {
+                    state[i] = lanes_put(state[i], l, kernel->iv[i]);
+                }
+                active[l] = 1;
+                next++;
+            }
+
+            blocks[l] = active[l] ? md_multi_lane_next(&lanes[l]) : idle_block;
+            busy |= active[l];
+        }
+
+        if (!busy) {
+            break;
+        }
+
+        kernel->block(state, blocks);
+
+        for (l = 0; l < MD_MULTI_LANES; l++) {
+            if (active[l] && md_multi_lane_done(&lanes[l])) {
+                for (i = 0; i < output_size / 4; i++) {
+                    MBEDTLS_PUT_UINT32_BE(lanes_get(state[i], l),
+                                          output[lanes[l].job], 4 * i);
+                }
+                active[l] = 0;
+            }
+        }
+    }
+
+    mbedtls_platform_zeroize(lanes, sizeof(lanes));
+    mbedtls_platform_zeroize(state, sizeof(state));
+}
+
+#endif /* MD_MULTI_HAVE_LANES */
+
+/*
+ * An HMAC key with its ipad and opad blocks already hashed.
+ * This belongs in md.h with the other public types.
+ */
+typedef struct mbedtls_md_hmac_key_t {
+    const mbedtls_md_info_t *md_info;
+    mbedtls_md_context_t inner_ctx;     /* state after the ipad block */
+    mbedtls_md_context_t outer_ctx;     /* state after the opad block */
+} mbedtls_md_hmac_key_t;
+
+int mbedtls_md_multi(const mbedtls_md_info_t *md_info, size_t count,
+                     const unsigned char * const input[], const size_t ilen[],
+                     unsigned char * const output[])
+{
+    int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
+    mbedtls_md_context_t ctx;
+    size_t i;
+
+    if (md_info == NULL) {
+        return MBEDTLS_ERR_MD_BAD_INPUT_DATA;
+    }
+
+#if defined(MD_MULTI_HAVE_LANES)
+    {
+        const md_multi_kernel_t *kernel = md_multi_kernel_from_type(md_info->type);
+#if defined(MBEDTLS_MD_SOME_PSA)
+        if (md_can_use_psa(md_info)) {
+            kernel = NULL;
+        }
+#endif
+        if (kernel != NULL) {
+            md_multi_run(kernel, count, input, ilen, output, md_info->size);
+            return 0;
+        }
+    }
+#endif /* MD_MULTI_HAVE_LANES */
+
+    mbedtls_md_init(&ctx);
+
+    if ((ret = mbedtls_md_setup(&ctx, md_info, 0)) != 0) {
+        goto cleanup;
+    }
+
+    for (i = 0; i < count; i++) {
+        if ((ret = mbedtls_md_starts(&ctx)) != 0) {
+            goto cleanup;
+        }
+        if ((ret = mbedtls_md_update(&ctx, input[i], ilen[i])) != 0) {
+            goto cleanup;
+        }
+        if ((ret = mbedtls_md_finish(&ctx, output[i])) != 0) {
+            goto cleanup;
+        }
+    }
+
+cleanup:
+    mbedtls_md_free(&ctx);
+
+    return ret;
+}
+
+void mbedtls_md_hmac_key_init(mbedtls_md_hmac_key_t *hkey)
+{
+    memset(hkey, 0, sizeof(mbedtls_md_hmac_key_t));
+    mbedtls_md_init(&hkey->inner_ctx);
+    mbedtls_md_init(&hkey->outer_ctx);
+}
+
+void mbedtls_md_hmac_key_free(mbedtls_md_hmac_key_t *hkey)
+{
+    if (hkey == NULL) {
+        return;
+    }
+
+    mbedtls_md_free(&hkey->inner_ctx);
+    mbedtls_md_free(&hkey->outer_ctx);
+    mbedtls_platform_zeroize(hkey, sizeof(mbedtls_md_hmac_key_t));
+}
+
+int mbedtls_md_hmac_key_setup(mbedtls_md_hmac_key_t *hkey,
+                              const mbedtls_md_info_t *md_info,
+                              const unsigned char *key, size_t keylen)
+{
+    int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
+
+    if (hkey == NULL || md_info == NULL) {
+        return MBEDTLS_ERR_MD_BAD_INPUT_DATA;
+    }
+
+    mbedtls_md_hmac_key_free(hkey);
+    mbedtls_md_hmac_key_init(hkey);
+    hkey->md_info = md_info;
+
+    /*
+     * Keep the contexts after the ipad and opad blocks, and clone them for
+     * each message.
+     */
+    if ((ret = mbedtls_md_setup(&hkey->inner_ctx, md_info, 1)) != 0) {
+        return ret;
+    }
+    if ((ret = mbedtls_md_hmac_starts(&hkey->inner_ctx, key, keylen)) != 0) {
+        return ret;
+    }
+    if ((ret = mbedtls_md_setup(&hkey->outer_ctx, md_info, 0)) != 0) {
+        return ret;
+    }
+    if ((ret = mbedtls_md_starts(&hkey->outer_ctx)) != 0) {
+        return ret;
+    }
+    return mbedtls_md_update(&hkey->outer_ctx,
+                             (unsigned char *) hkey->inner_ctx.hmac_ctx +
+                             md_info->block_size,
+                             md_info->block_size);
+}
+
+int mbedtls_md_hmac_multi(const mbedtls_md_hmac_key_t *hkey, size_t count,
+                          const unsigned char * const input[], const size_t ilen[],
+                          unsigned char * const output[])
+{
+    int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
+    unsigned char tmp[MBEDTLS_MD_MAX_SIZE];
+    mbedtls_md_context_t ctx;
+    size_t i;
+
+    if (hkey == NULL || hkey->md_info == NULL) {
+        return MBEDTLS_ERR_MD_BAD_INPUT_DATA;
+    }
+
+    mbedtls_md_init(&ctx);
+
+    if ((ret = mbedtls_md_setup(&ctx, hkey->md_info, 0)) != 0) {
+        goto cleanup;
+    }
+
+    for (i = 0; i < count; i++) {
+        if ((ret = mbedtls_md_clone(&ctx, &hkey->inner_ctx)) != 0) {
+            goto cleanup;
+        }
+        if ((ret = mbedtls_md_update(&ctx, input[i], ilen[i])) != 0) {
+            goto cleanup;
+        }
+        if ((ret = mbedtls_md_finish(&ctx, tmp)) != 0) {
+            goto cleanup;
+        }
+        if ((ret = mbedtls_md_clone(&ctx, &hkey->outer_ctx)) != 0) {
+            goto cleanup;
+        }
+        if ((ret = mbedtls_md_update(&ctx, tmp, hkey->md_info->size)) != 0) {
+            goto cleanup;
+        }
+        if ((ret = mbedtls_md_finish(&ctx, output[i])) != 0) {
+            goto cleanup;
+        }
+    }
+
+cleanup:
+    mbedtls_platform_zeroize(tmp, sizeof(tmp));
+    mbedtls_md_free(&ctx);
+
+    return ret;
+}
+
 #endif /* MBEDTLS_MD_C */
 
 #endif /* MBEDTLS_MD_LIGHT */
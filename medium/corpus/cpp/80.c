@@ -31,11 +31,49 @@ typedef struct {
   /* Private state for RGB->YCC conversion */
   JLONG *rgb_ycc_tab;           /* => table for RGB to YCbCr conversion */
 #endif
+
+  /* Vector kernels chosen by select_color_kernels, or NULL */
+  const struct color_kernel_table *kernels;
+  int layout[4];                /* pixel size, R, G and B offsets of input */
 } my_color_converter;
 
 typedef my_color_converter *my_cconvert_ptr;
 
 
+/* Vector row kernels.
+ *
+ * Each kernel converts as many whole 8-pixel groups of one row as it can and
+ * returns the number of columns done; the caller finishes the row with the
+ * scalar code.  layout[] describes the input pixels as set up by
+ * select_color_kernels.  The arithmetic reproduces the table-driven scalar
+ * code exactly, so the choice of path never changes the output.
+ */
+
+typedef JDIMENSION (*color_kernel_ptr) (_JSAMPROW inptr, _JSAMPROW outptr[4],
+                                        JDIMENSION num_cols,
+                                        const int *layout);
+
+struct color_kernel_table {
+  color_kernel_ptr rgb_gray;    /* extended RGB -> Y */
+  color_kernel_ptr rgb_rgb;     /* extended RGB -> R, G, B planes */
+  color_kernel_ptr cmyk_ycck;   /* CMYK -> Y, Cb, Cr, K planes */
+  color_kernel_ptr gray;        /* component 0 of interleaved input -> Y */
+};
+
+#if BITS_IN_JSAMPLE == 8
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CCONVERT_SIMD_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define CCONVERT_SIMD_NEON
+#endif
+#endif
+
+LOCAL(void) select_color_kernels(j_compress_ptr cinfo);
+
+
 /**************** RGB -> YCbCr conversion: most common case **************/
 
 /*
@@ -240,6 +278,8 @@ rgb_ycc_start(j_compress_ptr cinfo)
     rgb_ycc_tab[i + G_CR_OFF] = (-FIX(0.41869)) * i;
     rgb_ycc_tab[i + B_CR_OFF] = (-FIX(0.08131)) * i;
   }
+
+  select_color_kernels(cinfo);
 #else
   ERREXIT(cinfo, JERR_CONVERSION_NOTIMPL);
 #endif
@@ -388,14 +428,532 @@ null_convert(j_compress_ptr cinfo, _JSAMPARRAY input_buf,
 }
 
 
+/**************** Vector kernels **************/
+
+#ifdef CCONVERT_SIMD_SSE2
+
+/* FIX(0.58700) does not fit in 16 bits, so G => Y is split into 0.337 and
+ * 0.250 parts whose fixed-point values add up to exactly FIX(0.58700), and
+ * the 0.5 factors of Cb and Cr are done as shifts.
+ */
+#define F_0_081  ((short)FIX(0.08131))
+#define F_0_114  ((short)FIX(0.11400))
+#define F_0_168  ((short)FIX(0.16874))
+#define F_0_250  ((short)FIX(0.25000))
+#define F_0_299  ((short)FIX(0.29900))
+#define F_0_331  ((short)FIX(0.33126))
+#define F_0_337  ((short)(FIX(0.58700) - FIX(0.25000)))
+#define F_0_418  ((short)FIX(0.41869))
+
+#define PAIR16(a, b)  _mm_setr_epi16(a, b, a, b, a, b, a, b)
+
+/* Spread 4 packed 3-byte pixels in the low 12 bytes of x to 4-byte slots. */
+
+LOCAL(__m128i)
+expand_rgb_sse2(__m128i x)
+{
+  const __m128i m0 = _mm_setr_epi32(0xFFFFFF, 0, 0, 0);
+  const __m128i m1 = _mm_setr_epi32(0, 0xFFFFFF, 0, 0);
+  const __m128i m2 = _mm_setr_epi32(0, 0, 0xFFFFFF, 0);
+  const __m128i m3 = _mm_setr_epi32(0, 0, 0, 0xFFFFFF);
+
+  return _mm_or_si128(_mm_or_si128(_mm_and_si128(x, m0),
+                                   _mm_and_si128(_mm_slli_si128(x, 1), m1)),
+                      _mm_or_si128(_mm_and_si128(_mm_slli_si128(x, 2), m2),
+                                   _mm_and_si128(_mm_slli_si128(x, 3), m3)));
+}
+
+/* Load 8 pixels of pixelsize bytes as up to 4 planes of 16-bit values. */
+
+LOCAL(void)
+load_planes_sse2(_JSAMPROW p, int pixelsize, __m128i planes[4])
+{
+  const __m128i zero = _mm_setzero_si128();
+  __m128i a, b, t0, t1;
+  int i;
+
+  if (pixelsize == 1) {
+    planes[0] = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i *)p), zero);
+    return;
+  }
+  if (pixelsize == 4) {
+    a = _mm_loadu_si128((__m128i *)p);
+    b = _mm_loadu_si128((__m128i *)(p + 16));
+  } else if (pixelsize == 3) {
+    /* 24 bytes, read without going past the group */
+    a = _mm_loadu_si128((__m128i *)p);
+    b = _mm_or_si128(_mm_srli_si128(a, 12),
+                     _mm_slli_si128(_mm_loadl_epi64((__m128i *)(p + 16)), 4));
+    a = expand_rgb_sse2(a);
+    b = expand_rgb_sse2(b);
+  } else {
+    for (i = 0; i < pixelsize && i < 4; i++, p++)
+      planes[i] = _mm_setr_epi16(p[0], p[pixelsize], p[2 * pixelsize],
+                                 p[3 * pixelsize], p[4 * pixelsize],
+                                 p[5 * pixelsize], p[6 * pixelsize],
+                                 p[7 * pixelsize]);
+    return;
+  }
+
+  /* 8x4 byte transpose */
+  t0 = _mm_unpacklo_epi8(a, b);
+  t1 = _mm_unpackhi_epi8(a, b);
+  a = _mm_unpacklo_epi8(t0, t1);
+  b = _mm_unpackhi_epi8(t0, t1);
+  t0 = _mm_unpacklo_epi8(a, b);
+  t1 = _mm_unpackhi_epi8(a, b);
+  planes[0] = _mm_unpacklo_epi8(t0, zero);
+  planes[1] = _mm_unpackhi_epi8(t0, zero);
+  planes[2] = _mm_unpacklo_epi8(t1, zero);
+  planes[3] = _mm_unpackhi_epi8(t1, zero);
+}
+
+LOCAL(void)
+store_plane_sse2(_JSAMPROW outptr, __m128i v)
+{
+  _mm_storel_epi64((__m128i *)outptr, _mm_packus_epi16(v, v));
+}
+
+/* (sum of madd terms + bias) >> SCALEBITS for the two halves of a group */
+#define DESCALE_PAIR(lo, hi) \
+  _mm_packs_epi32(_mm_srai_epi32(lo, SCALEBITS), _mm_srai_epi32(hi, SCALEBITS))
+
+LOCAL(__m128i)
+rgb_y_sse2(__m128i r, __m128i g, __m128i b)
+{
+  const __m128i c_rg = PAIR16(F_0_299, F_0_337);
+  const __m128i c_bg = PAIR16(F_0_114, F_0_250);
+  const __m128i half = _mm_set1_epi32(ONE_HALF);
+  __m128i lo = _mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(r, g), c_rg),
+                             _mm_madd_epi16(_mm_unpacklo_epi16(b, g), c_bg));
+  __m128i hi = _mm_add_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(r, g), c_rg),
+                             _mm_madd_epi16(_mm_unpackhi_epi16(b, g), c_bg));
+
+  return DESCALE_PAIR(_mm_add_epi32(lo, half), _mm_add_epi32(hi, half));
+}
+
+/* x * FIX(0.5) + m * c1 + n * c2 + the Cb/Cr bias */
+
+LOCAL(__m128i)
+rgb_c_sse2(__m128i x, __m128i m, __m128i n, __m128i c)
+{
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i bias = _mm_set1_epi32(CBCR_OFFSET + ONE_HALF - 1);
+  __m128i lo = _mm_add_epi32(_mm_slli_epi32(_mm_unpacklo_epi16(x, zero), 15),
+                             _mm_madd_epi16(_mm_unpacklo_epi16(m, n), c));
+  __m128i hi = _mm_add_epi32(_mm_slli_epi32(_mm_unpackhi_epi16(x, zero), 15),
+                             _mm_madd_epi16(_mm_unpackhi_epi16(m, n), c));
+
+  return DESCALE_PAIR(_mm_add_epi32(lo, bias), _mm_add_epi32(hi, bias));
+}
+
+METHODDEF(JDIMENSION)
+rgb_gray_sse2(_JSAMPROW inptr, _JSAMPROW outptr[4], JDIMENSION num_cols,
+              const int *layout)
+{
+  __m128i planes[4];
+  JDIMENSION col;
+
+  for (col = 0; col + 8 <= num_cols; col += 8) {
+    load_planes_sse2(inptr + col * layout[0], layout[0], planes);
+    store_plane_sse2(outptr[0] + col, rgb_y_sse2(planes[layout[1]],
+                                                 planes[layout[2]],
+                                                 planes[layout[3]]));
+  }
+  return col;
+}
+
+METHODDEF(JDIMENSION)
+rgb_rgb_sse2(_JSAMPROW inptr, _JSAMPROW outptr[4], JDIMENSION num_cols,
+             const int *layout)
+{
+  __m128i planes[4];
+  JDIMENSION col;
+
+  for (col = 0; col + 8 <= num_cols; col += 8) {
+    load_planes_sse2(inptr + col * layout[0], layout[0], planes);
+    store_plane_sse2(outptr[0] + col, planes[layout[1]]);
+    store_plane_sse2(outptr[1] + col, planes[layout[2]]);
+    store_plane_sse2(outptr[2] + col, planes[layout[3]]);
+  }
+  return col;
+}
+
+METHODDEF(JDIMENSION)
+cmyk_ycck_sse2(_JSAMPROW inptr, _JSAMPROW outptr[4], JDIMENSION num_cols,
+               const int *layout)
+{
+  const __m128i maxj = _mm_set1_epi16(_MAXJSAMPLE);
+  const __m128i c_cb = PAIR16(-F_0_168, -F_0_331);
+  const __m128i c_cr = PAIR16(-F_0_418, -F_0_081);
+  __m128i planes[4], r, g, b;
+  JDIMENSION col;
+
+  for (col = 0; col + 8 <= num_cols; col += 8) {
+    load_planes_sse2(inptr + col * 4, 4, planes);
+    r = _mm_sub_epi16(maxj, planes[0]);
+    g = _mm_sub_epi16(maxj, planes[1]);
+    b = _mm_sub_epi16(maxj, planes[2]);
+    store_plane_sse2(outptr[0] + col, rgb_y_sse2(r, g, b));
+    store_plane_sse2(outptr[1] + col, rgb_c_sse2(b, r, g, c_cb));
+    store_plane_sse2(outptr[2] + col, rgb_c_sse2(r, g, b, c_cr));
+    store_plane_sse2(outptr[3] + col, planes[3]);
+  }
+  return col;
+}
+
+METHODDEF(JDIMENSION)
+gray_sse2(_JSAMPROW inptr, _JSAMPROW outptr[4], JDIMENSION num_cols,
+          const int *layout)
+{
+  __m128i planes[4];
+  JDIMENSION col;
+
+  if (layout[0] == 1) {
+    memcpy(outptr[0], inptr, num_cols);
+    return num_cols;
+  }
+  for (col = 0; col + 8 <= num_cols; col += 8) {
+    load_planes_sse2(inptr + col * layout[0], layout[0], planes);
+    store_plane_sse2(outptr[0] + col, planes[0]);
+  }
+  return col;
+}
+
+static const struct color_kernel_table sse2_kernels = {
+  rgb_gray_sse2, rgb_rgb_sse2, cmyk_ycck_sse2, gray_sse2
+};
+#define SIMD_KERNELS  (&sse2_kernels)
+
+#endif /* CCONVERT_SIMD_SSE2 */
+
+
+#ifdef CCONVERT_SIMD_NEON
+
+/* Load 8 pixels of pixelsize (1 to 4) bytes as planes of 16-bit values. */
+
+LOCAL(void)
+load_planes_neon(_JSAMPROW p, int pixelsize, uint16x8_t planes[4])
+{
+  switch (pixelsize) {
+  case 1:
+    planes[0] = vmovl_u8(vld1_u8(p));
+    break;
+  case 2: {
+    uint8x8x2_t x = vld2_u8(p);
+    planes[0] = vmovl_u8(x.val[0]);
+    planes[1] = vmovl_u8(x.val[1]);
+    break;
+  }
+  case 3: {
+    uint8x8x3_t x = vld3_u8(p);
+    planes[0] = vmovl_u8(x.val[0]);
+    planes[1] = vmovl_u8(x.val[1]);
+    planes[2] = vmovl_u8(x.val[2]);
+    break;
+  }
+  default: {
+    uint8x8x4_t x = vld4_u8(p);
+    planes[0] = vmovl_u8(x.val[0]);
+    planes[1] = vmovl_u8(x.val[1]);
+    planes[2] = vmovl_u8(x.val[2]);
+    planes[3] = vmovl_u8(x.val[3]);
+    break;
+  }
+  }
+}
+
+/* The sums are done modulo 2^32 in unsigned lanes; the final values are
+ * in range, so they are exact.
+ */
+#define DESCALE_NEON(lo, hi) \
+  vmovn_u16(vcombine_u16(vshrn_n_u32(lo, SCALEBITS), \
+                         vshrn_n_u32(hi, SCALEBITS)))
+
+LOCAL(uint8x8_t)
+rgb_y_neon(uint16x8_t r, uint16x8_t g, uint16x8_t b)
+{
+  uint32x4_t lo = vdupq_n_u32(ONE_HALF), hi = lo;
+
+  lo = vmlal_n_u16(lo, vget_low_u16(r), (uint16_t)FIX(0.29900));
+  hi = vmlal_n_u16(hi, vget_high_u16(r), (uint16_t)FIX(0.29900));
+  lo = vmlal_n_u16(lo, vget_low_u16(g), (uint16_t)FIX(0.58700));
+  hi = vmlal_n_u16(hi, vget_high_u16(g), (uint16_t)FIX(0.58700));
+  lo = vmlal_n_u16(lo, vget_low_u16(b), (uint16_t)FIX(0.11400));
+  hi = vmlal_n_u16(hi, vget_high_u16(b), (uint16_t)FIX(0.11400));
+  return DESCALE_NEON(lo, hi);
+}
+
+/* x * FIX(0.5) - m * c1 - n * c2 + the Cb/Cr bias */
+
+LOCAL(uint8x8_t)
+rgb_c_neon(uint16x8_t x, uint16x8_t m, uint16x8_t n, uint16_t c1,
+           uint16_t c2)
+{
+  const uint32x4_t bias = vdupq_n_u32(CBCR_OFFSET + ONE_HALF - 1);
+  uint32x4_t lo = vaddq_u32(vshll_n_u16(vget_low_u16(x), 15), bias);
+  uint32x4_t hi = vaddq_u32(vshll_n_u16(vget_high_u16(x), 15), bias);
+
+  lo = vmlsl_n_u16(lo, vget_low_u16(m), c1);
+  hi = vmlsl_n_u16(hi, vget_high_u16(m), c1);
+  lo = vmlsl_n_u16(lo, vget_low_u16(n), c2);
+  hi = vmlsl_n_u16(hi, vget_high_u16(n), c2);
+  return DESCALE_NEON(lo, hi);
+}
+
+METHODDEF(JDIMENSION)
+rgb_gray_neon(_JSAMPROW inptr, _JSAMPROW outptr[4], JDIMENSION num_cols,
+              const int *layout)
+{
+  uint16x8_t planes[4];
+  JDIMENSION col;
+
+  for (col = 0; col + 8 <= num_cols; col += 8) {
+    load_planes_neon(inptr + col * layout[0], layout[0], planes);
+    vst1_u8(outptr[0] + col, rgb_y_neon(planes[layout[1]], planes[layout[2]],
+                                        planes[layout[3]]));
+  }
+  return col;
+}
+
+METHODDEF(JDIMENSION)
+rgb_rgb_neon(_JSAMPROW inptr, _JSAMPROW outptr[4], JDIMENSION num_cols,
+             const int *layout)
+{
+  uint16x8_t planes[4];
+  JDIMENSION col;
+
+  for (col = 0; col + 8 <= num_cols; col += 8) {
+    load_planes_neon(inptr + col * layout[0], layout[0], planes);
+    vst1_u8(outptr[0] + col, vmovn_u16(planes[layout[1]]));
+    vst1_u8(outptr[1] + col, vmovn_u16(planes[layout[2]]));
+    vst1_u8(outptr[2] + col, vmovn_u16(planes[layout[3]]));
+  }
+  return col;
+}
+
+METHODDEF(JDIMENSION)
+cmyk_ycck_neon(_JSAMPROW inptr, _JSAMPROW outptr[4], JDIMENSION num_cols,
+               const int *layout)
+{
+  const uint16x8_t maxj = vdupq_n_u16(_MAXJSAMPLE);
+  uint16x8_t planes[4], r, g, b;
+  JDIMENSION col;
+
+  for (col = 0; col + 8 <= num_cols; col += 8) {
+    load_planes_neon(inptr + col * 4, 4, planes);
+    r = vsubq_u16(maxj, planes[0]);
+    g = vsubq_u16(maxj, planes[1]);
+    b = vsubq_u16(maxj, planes[2]);
+    vst1_u8(outptr[0] + col, rgb_y_neon(r, g, b));
+    vst1_u8(outptr[1] + col, rgb_c_neon(b, r, g, (uint16_t)FIX(0.16874),
+                                        (uint16_t)FIX(0.33126)));
+    vst1_u8(outptr[2] + col, rgb_c_neon(r, g, b, (uint16_t)FIX(0.41869),
+                                        (uint16_t)FIX(0.08131)));
+    vst1_u8(outptr[3] + col, vmovn_u16(planes[3]));
+  }
+  return col;
+}
+
+METHODDEF(JDIMENSION)
+gray_neon(_JSAMPROW inptr, _JSAMPROW outptr[4], JDIMENSION num_cols,
+          const int *layout)
+{
+  uint16x8_t planes[4];
+  JDIMENSION col;
+
+  if (layout[0] == 1) {
+    memcpy(outptr[0], inptr, num_cols);
+    return num_cols;
+  }
+  if (layout[0] > 4)
+    return 0;
+  for (col = 0; col + 8 <= num_cols; col += 8) {
+    load_planes_neon(inptr + col * layout[0], layout[0], planes);
+    vst1_u8(outptr[0] + col, vmovn_u16(planes[0]));
+  }
+  return col;
+}
+
+static const struct color_kernel_table neon_kernels = {
+  rgb_gray_neon, rgb_rgb_neon, cmyk_ycck_neon, gray_neon
+};
+#define SIMD_KERNELS  (&neon_kernels)
+
+#endif /* CCONVERT_SIMD_NEON */
+
+
+#ifdef SIMD_KERNELS
+
+/*
+ * Converters that run the row kernels and finish each row with the scalar
+ * arithmetic of the methods they replace.
+ */
+
+METHODDEF(void)
+rgb_gray_convert_simd(j_compress_ptr cinfo, _JSAMPARRAY input_buf,
+                      _JSAMPIMAGE output_buf, JDIMENSION output_row,
+                      int num_rows)
+{
+  my_cconvert_ptr cconvert = (my_cconvert_ptr)cinfo->cconvert;
+  register JLONG *ctab = cconvert->rgb_ycc_tab;
+  const int *layout = cconvert->layout;
+  _JSAMPROW inptr, outptr[4];
+  JDIMENSION col, num_cols = cinfo->image_width;
+
+  while (--num_rows >= 0) {
+    inptr = *input_buf++;
+    outptr[0] = output_buf[0][output_row++];
+    col = (*cconvert->kernels->rgb_gray) (inptr, outptr, num_cols, layout);
+    for (inptr += col * layout[0]; col < num_cols; col++, inptr += layout[0])
+      outptr[0][col] = (_JSAMPLE)((ctab[inptr[layout[1]] + R_Y_OFF] +
+                                   ctab[inptr[layout[2]] + G_Y_OFF] +
+                                   ctab[inptr[layout[3]] + B_Y_OFF]) >>
+                                  SCALEBITS);
+  }
+}
+
+
+METHODDEF(void)
+rgb_rgb_convert_simd(j_compress_ptr cinfo, _JSAMPARRAY input_buf,
+                     _JSAMPIMAGE output_buf, JDIMENSION output_row,
+                     int num_rows)
+{
+  my_cconvert_ptr cconvert = (my_cconvert_ptr)cinfo->cconvert;
+  const int *layout = cconvert->layout;
+  _JSAMPROW inptr, outptr[4];
+  JDIMENSION col, num_cols = cinfo->image_width;
+
+  while (--num_rows >= 0) {
+    inptr = *input_buf++;
+    outptr[0] = output_buf[0][output_row];
+    outptr[1] = output_buf[1][output_row];
+    outptr[2] = output_buf[2][output_row];
+    output_row++;
+    col = (*cconvert->kernels->rgb_rgb) (inptr, outptr, num_cols, layout);
+    for (inptr += col * layout[0]; col < num_cols; col++, inptr += layout[0]) {
+      outptr[0][col] = inptr[layout[1]];
+      outptr[1][col] = inptr[layout[2]];
+      outptr[2][col] = inptr[layout[3]];
+    }
+  }
+}
+
+
+METHODDEF(void)
+cmyk_ycck_convert_simd(j_compress_ptr cinfo, _JSAMPARRAY input_buf,
+                       _JSAMPIMAGE output_buf, JDIMENSION output_row,
+                       int num_rows)
+{
+  my_cconvert_ptr cconvert = (my_cconvert_ptr)cinfo->cconvert;
+  register int r, g, b;
+  register JLONG *ctab = cconvert->rgb_ycc_tab;
+  _JSAMPROW inptr, outptr[4];
+  JDIMENSION col, num_cols = cinfo->image_width;
+
+  while (--num_rows >= 0) {
+    inptr = *input_buf++;
+    outptr[0] = output_buf[0][output_row];
+    outptr[1] = output_buf[1][output_row];
+    outptr[2] = output_buf[2][output_row];
+    outptr[3] = output_buf[3][output_row];
+    output_row++;
+    col = (*cconvert->kernels->cmyk_ycck) (inptr, outptr, num_cols,
+                                           cconvert->layout);
+    for (inptr += col * 4; col < num_cols; col++, inptr += 4) {
+      r = _MAXJSAMPLE - inptr[0];
+      g = _MAXJSAMPLE - inptr[1];
+      b = _MAXJSAMPLE - inptr[2];
+      /* K passes through as-is */
+      outptr[3][col] = inptr[3];
+      outptr[0][col] = (_JSAMPLE)((ctab[r + R_Y_OFF] + ctab[g + G_Y_OFF] +
+                                   ctab[b + B_Y_OFF]) >> SCALEBITS);
+      outptr[1][col] = (_JSAMPLE)((ctab[r + R_CB_OFF] + ctab[g + G_CB_OFF] +
+                                   ctab[b + B_CB_OFF]) >> SCALEBITS);
+      outptr[2][col] = (_JSAMPLE)((ctab[r + R_CR_OFF] + ctab[g + G_CR_OFF] +
+                                   ctab[b + B_CR_OFF]) >> SCALEBITS);
+    }
+  }
+}
+
+
+METHODDEF(void)
+grayscale_convert_simd(j_compress_ptr cinfo, _JSAMPARRAY input_buf,
+                       _JSAMPIMAGE output_buf, JDIMENSION output_row,
+                       int num_rows)
+{
+  my_cconvert_ptr cconvert = (my_cconvert_ptr)cinfo->cconvert;
+  int instride = cconvert->layout[0];
+  _JSAMPROW inptr, outptr[4];
+  JDIMENSION col, num_cols = cinfo->image_width;
+
+  while (--num_rows >= 0) {
+    inptr = *input_buf++;
+    outptr[0] = output_buf[0][output_row++];
+    col = (*cconvert->kernels->gray) (inptr, outptr, num_cols,
+                                      cconvert->layout);
+    for (inptr += col * instride; col < num_cols; col++, inptr += instride)
+      outptr[0][col] = inptr[0];
+  }
+}
+
+#endif /* SIMD_KERNELS */
+
+
+/*
+ * Switch the scalar converter chosen by _jinit_color_converter to its vector
+ * version, if there is one for this CPU.  Called from the start method, so
+ * that the dispatch is done once per pass rather than once per row.
+ */
+
+LOCAL(void)
+select_color_kernels(j_compress_ptr cinfo)
+{
+#ifdef SIMD_KERNELS
+  my_cconvert_ptr cconvert = (my_cconvert_ptr)cinfo->cconvert;
+  const struct color_kernel_table *kernels = SIMD_KERNELS;
+
+  if (cconvert->pub._color_convert == grayscale_convert) {
+    cconvert->layout[0] = cinfo->input_components;
+    cconvert->kernels = kernels;
+    cconvert->pub._color_convert = grayscale_convert_simd;
+    return;
+  }
+
+  if (cconvert->pub._color_convert == cmyk_ycck_convert) {
+    cconvert->kernels = kernels;
+    cconvert->pub._color_convert = cmyk_ycck_convert_simd;
+    return;
+  }
+
+  if (cinfo->in_color_space != JCS_RGB &&
+      (cinfo->in_color_space < JCS_EXT_RGB ||
+       cinfo->in_color_space > JCS_EXT_ARGB))
+    return;
+  cconvert->layout[0] = rgb_pixelsize[cinfo->in_color_space];
+  cconvert->layout[1] = rgb_red[cinfo->in_color_space];
+  cconvert->layout[2] = rgb_green[cinfo->in_color_space];
+  cconvert->layout[3] = rgb_blue[cinfo->in_color_space];
+
+  if (cconvert->pub._color_convert == rgb_gray_convert) {
+    cconvert->kernels = kernels;
+    cconvert->pub._color_convert = rgb_gray_convert_simd;
+  } else if (cconvert->pub._color_convert == rgb_rgb_convert) {
+    cconvert->kernels = kernels;
+    cconvert->pub._color_convert = rgb_rgb_convert_simd;
+  }
+#endif
+}
+
+
 /*
- * Empty method for start_pass.
+ * Start method for the converters that need no tables.
  */
 
 METHODDEF(void)
-null_method(j_compress_ptr cinfo)
+color_kernels_start(j_compress_ptr cinfo)
 {
-  /* no work needed */
+  select_color_kernels(cinfo);
 }
 
 
@@ -415,8 +973,9 @@ _jinit_color_converter(j_compress_ptr cinfo)
     (*cinfo->mem->alloc_small) ((j_common_ptr)cinfo, JPOOL_IMAGE,
                                 sizeof(my_color_converter));
   cinfo->cconvert = (struct jpeg_color_converter *)cconvert;
-  /* set start_pass to null method until we find out differently */
-  cconvert->pub.start_pass = null_method;
+  /* set start_pass to the kernel selection until we find out differently */
+  cconvert->pub.start_pass = color_kernels_start;
+  cconvert->kernels = NULL;
 
 #else
 static UBool checkCanonSegmentStarter(const Normalizer2Impl &impl, const UChar32 c) {
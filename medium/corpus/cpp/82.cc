@@ -264,6 +264,8 @@ namespace OT {
 struct cff1_subset_plan
 } // namespace OT
 
+/* plan.subset_charstrings arrive here already flattened or subroutinized
+ * by cff1_subset_plan; this only lays them out as an INDEX. */
 static bool _serialize_cff1_charstrings (hb_serialize_context_t *c,
                                          struct OT::cff1_subset_plan &plan,
                                          const OT::cff1::accelerator_subset_t  &acc)
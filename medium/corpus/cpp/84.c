@@ -87,6 +87,27 @@ typedef enum {			/* JPEG marker codes */
 } JPEG_MARKER;
 
 
+/* Marker index of a memory-resident datastream (see jpeg_index_markers).
+ * Offsets are from the SOI marker.  Each marker entry records where its
+ * parameters start (just after the marker code) and end; each scan also
+ * records the entropy-coded data of its restart intervals.
+ */
+
+typedef struct {
+  size_t start;			/* first byte of entropy-coded data */
+  size_t end;			/* byte after it (the next marker's FF) */
+} restart_interval;
+
+typedef struct {
+  int code;			/* marker code */
+  int scan_number;		/* SOS: value of input_scan_number, else 0 */
+  size_t offset;		/* byte after the marker code */
+  size_t end;			/* byte after the marker parameters */
+  JDIMENSION first_interval;	/* SOS: index into intervals[] */
+  JDIMENSION num_intervals;	/* SOS: restart intervals in the scan */
+} marker_entry;
+
+
 /* Private state */
 
 typedef struct {
@@ -104,6 +125,15 @@ typedef struct {
   jpeg_saved_marker_ptr cur_marker;	/* NULL if not processing a marker */
   unsigned int bytes_read;		/* data bytes read so far in marker */
   /* Note: cur_marker is not linked into marker_list until it's all read. */
+
+  /* Marker index, or NULL if the datastream has not been indexed */
+  const JOCTET FAR * index_base;	/* SOI of the indexed datastream */
+  size_t index_avail;		/* bytes in the source buffer from there */
+  marker_entry FAR * entries;
+  int num_entries;
+  int next_entry;		/* first entry not yet processed */
+  restart_interval FAR * intervals;
+  boolean index_fresh;		/* built since the last reset */
 } my_marker_reader;
 
 typedef my_marker_reader * my_marker_ptr;
@@ -970,6 +1000,554 @@ isl_bool isl_space_range_can_curry(__isl_keep isl_space *sp)
 }
 
 
+/*
+ * Fast path for memory-resident datastreams.
+ *
+ * When the source buffer holds the whole datastream, jpeg_index_markers
+ * scans it once and records the position of every marker and of every
+ * restart interval.  read_markers_indexed then goes straight from marker to
+ * marker, and the table markers are parsed directly from the buffer since
+ * they can never run out of input.  The other markers still go through the
+ * normal routines, which cannot suspend either because all of their data is
+ * present.  The interval index lets an application (or a parallel entropy
+ * decoder) go straight to the data of any restart interval.
+ */
+
+
+/*
+ * Scan the datastream in data[0..size-1].  With entries == NULL, only count
+ * the markers and restart intervals; otherwise also fill in the tables,
+ * which must be large enough.  Returns FALSE if the buffer does not hold a
+ * complete, well-formed datastream, in which case the normal marker reader
+ * (with its recovery logic) is used instead.
+ */
+
+LOCAL(boolean)
+scan_datastream (const JOCTET FAR * data, size_t size,
+		 marker_entry FAR * entries, int * num_entries,
+		 restart_interval FAR * intervals, size_t * num_intervals)
+{
+  size_t pos, end, q;
+  int n = 0, scan_number = 0, c;
+  size_t ni = 0;
+  const JOCTET FAR * ff;
+
+  if (size < 2 || GETJOCTET(data[0]) != 0xFF ||
+      GETJOCTET(data[1]) != (int) M_SOI)
+    return FALSE;
+
+  pos = 0;
+  for (;;) {
+    /* Expect a marker, possibly preceded by fill bytes; other garbage
+     * is left to the normal reader to warn about.
+     */
+    if (pos >= size || GETJOCTET(data[pos]) != 0xFF)
+      return FALSE;
+    while (pos < size && GETJOCTET(data[pos]) == 0xFF)
+      pos++;
+    if (pos >= size || (c = GETJOCTET(data[pos])) == 0)
+      return FALSE;
+    pos++;
+
+    if (c == (int) M_SOI || c == (int) M_EOI || c == (int) M_TEM ||
+	(c >= (int) M_RST0 && c <= (int) M_RST7))
+      end = pos;
+    else {
+      if (size - pos < 2)
+	return FALSE;
+      end = ((size_t) GETJOCTET(data[pos]) << 8) + GETJOCTET(data[pos + 1]);
+      if (end < 2 || end > size - pos)
+	return FALSE;
+      end += pos;
+    }
+
+    if (entries != NULL) {
+      entries[n].code = c;
+      entries[n].scan_number = 0;
+      entries[n].offset = pos;
+      entries[n].end = end;
+      entries[n].first_interval = 0;
+      entries[n].num_intervals = 0;
+    }
+    n++;
+
+    if (c == (int) M_EOI)
+      break;
+    pos = end;
+    if (c != (int) M_SOS)
+      continue;
+
+    /* Entropy-coded data follows; split it at the restart markers. */
+    if (entries != NULL) {
+      if (end - entries[n-1].offset > 2 && GETJOCTET(data[entries[n-1].offset + 2]))
+	scan_number++;
+      entries[n-1].scan_number = scan_number;
+      entries[n-1].first_interval = (JDIMENSION) ni;
+      intervals[ni].start = pos;
+    }
+    for (;;) {
+      ff = (const JOCTET FAR *) memchr(data + pos, 0xFF, size - pos);
+      if (ff == NULL)
+	return FALSE;
+      q = (size_t) (ff - data);
+      for (pos = q + 1; pos < size && GETJOCTET(data[pos]) == 0xFF; pos++)
+	;
+      if (pos >= size)
+	return FALSE;
+      c = GETJOCTET(data[pos]);
+      if (c == 0) {		/* stuffed zero byte */
+	pos++;
+	continue;
+      }
+      if (entries != NULL)
+	intervals[ni].end = q;
+      ni++;
+      if (c < (int) M_RST0 || c > (int) M_RST7)
+	break;
+      pos++;
+      if (entries != NULL)
+	intervals[ni].start = pos;
+    }
+    if (entries != NULL)
+      entries[n-1].num_intervals =
+	(JDIMENSION) (ni - entries[n-1].first_interval);
+    pos = q;			/* at the marker that ends the scan */
+  }
+
+  *num_entries = n;
+  *num_intervals = ni;
+  return TRUE;
+}
+
+
+/*
+ * Table markers, parsed straight from the buffer.
+ * p points at the marker parameters after the length, length is their size.
+ */
+
+LOCAL(void)
+get_dqt_direct (j_decompress_ptr cinfo, const JOCTET FAR * p, INT32 length)
+{
+  INT32 count, i;
+  int n, prec;
+  JQUANT_TBL *quant_ptr;
+  const int *natural_order;
+
+  while (length > 0) {
+    length--;
+    n = GETJOCTET(*p++);
+    prec = n >> 4;
+    n &= 0x0F;
+
+    TRACEMS2(cinfo, 1, JTRC_DQT, n, prec);
+
+    if (n >= NUM_QUANT_TBLS)
+      ERREXIT1(cinfo, JERR_DQT_INDEX, n);
+
+    if (cinfo->quant_tbl_ptrs[n] == NULL)
+      cinfo->quant_tbl_ptrs[n] = jpeg_alloc_quant_table((j_common_ptr) cinfo);
+    quant_ptr = cinfo->quant_tbl_ptrs[n];
+
+    count = prec ? length >> 1 : length;
+    if (count < DCTSIZE2) {
+      /* Initialize full table for safety. */
+      for (i = 0; i < DCTSIZE2; i++)
+	quant_ptr->quantval[i] = 1;
+    } else
+      count = DCTSIZE2;
+
+    switch (count) {
+    case (2*2): natural_order = jpeg_natural_order2; break;
+    case (3*3): natural_order = jpeg_natural_order3; break;
+    case (4*4): natural_order = jpeg_natural_order4; break;
+    case (5*5): natural_order = jpeg_natural_order5; break;
+    case (6*6): natural_order = jpeg_natural_order6; break;
+    case (7*7): natural_order = jpeg_natural_order7; break;
+    default:    natural_order = jpeg_natural_order;
+    }
+
+    /* We convert the zigzag-order table to natural array order. */
+    if (prec) {
+      for (i = 0; i < count; i++, p += 2)
+	quant_ptr->quantval[natural_order[i]] =
+	  (UINT16) ((GETJOCTET(p[0]) << 8) + GETJOCTET(p[1]));
+    } else {
+      for (i = 0; i < count; i++)
+	quant_ptr->quantval[natural_order[i]] = (UINT16) GETJOCTET(*p++);
+    }
+
+    if (cinfo->err->trace_level >= 2) {
+      for (i = 0; i < DCTSIZE2; i += 8) {
+	TRACEMS8(cinfo, 2, JTRC_QUANTVALS,
+		 quant_ptr->quantval[i],   quant_ptr->quantval[i+1],
+		 quant_ptr->quantval[i+2], quant_ptr->quantval[i+3],
+		 quant_ptr->quantval[i+4], quant_ptr->quantval[i+5],
+		 quant_ptr->quantval[i+6], quant_ptr->quantval[i+7]);
+      }
+    }
+
+    length -= count;
+    if (prec) length -= count;
+  }
+
+  if (length != 0)
+    ERREXIT(cinfo, JERR_BAD_LENGTH);
+}
+
+
+LOCAL(void)
+get_dht_direct (j_decompress_ptr cinfo, const JOCTET FAR * p, INT32 length)
+{
+  UINT8 bits[17];
+  int i, index, count;
+  JHUFF_TBL **htblptr;
+
+  while (length > 16) {
+    index = GETJOCTET(*p++);
+
+    TRACEMS1(cinfo, 1, JTRC_DHT, index);
+
+    bits[0] = 0;
+    count = 0;
+    for (i = 1; i <= 16; i++) {
+      bits[i] = (UINT8) GETJOCTET(*p++);
+      count += bits[i];
+    }
+
+    length -= 1 + 16;
+
+    TRACEMS8(cinfo, 2, JTRC_HUFFBITS,
+	     bits[1], bits[2], bits[3], bits[4],
+	     bits[5], bits[6], bits[7], bits[8]);
+    TRACEMS8(cinfo, 2, JTRC_HUFFBITS,
+	     bits[9], bits[10], bits[11], bits[12],
+	     bits[13], bits[14], bits[15], bits[16]);
+
+    /* Here we just do minimal validation of the counts to avoid walking
+     * off the end of our table space.  jdhuff.c will check more carefully.
+     */
+    if (count > 256 || ((INT32) count) > length)
+      ERREXIT(cinfo, JERR_BAD_HUFF_TABLE);
+
+    if (index & 0x10) {		/* AC table definition */
+      index -= 0x10;
+      htblptr = &cinfo->ac_huff_tbl_ptrs[index];
+    } else {			/* DC table definition */
+      htblptr = &cinfo->dc_huff_tbl_ptrs[index];
+    }
+
+    if (index < 0 || index >= NUM_HUFF_TBLS)
+      ERREXIT1(cinfo, JERR_DHT_INDEX, index);
+
+    if (*htblptr == NULL)
+      *htblptr = jpeg_alloc_huff_table((j_common_ptr) cinfo);
+
+    MEMCOPY((*htblptr)->bits, bits, SIZEOF((*htblptr)->bits));
+    MEMZERO((*htblptr)->huffval, SIZEOF((*htblptr)->huffval));
+    MEMCOPY((*htblptr)->huffval, p, count * SIZEOF(UINT8));
+    p += count;
+    length -= count;
+  }
+
+  if (length != 0)
+    ERREXIT(cinfo, JERR_BAD_LENGTH);
+}
+
+
+LOCAL(void)
+get_dri_direct (j_decompress_ptr cinfo, const JOCTET FAR * p, INT32 length)
+{
+  unsigned int tmp;
+
+  if (length != 2)
+    ERREXIT(cinfo, JERR_BAD_LENGTH);
+
+  tmp = ((unsigned int) GETJOCTET(p[0]) << 8) + GETJOCTET(p[1]);
+
+  TRACEMS1(cinfo, 1, JTRC_DRI, tmp);
+
+  cinfo->restart_interval = tmp;
+}
+
+
+/*
+ * Read markers until SOS or EOI, using the index.
+ * Same interface as read_markers, which is used instead whenever the
+ * source is no longer in the indexed buffer or a marker is not found
+ * where the index says it should be.
+ */
+
+METHODDEF(int)
+read_markers_indexed (j_decompress_ptr cinfo)
+{
+  my_marker_ptr marker = (my_marker_ptr) cinfo->marker;
+  struct jpeg_source_mgr * datasrc = cinfo->src;
+  marker_entry FAR * entry;
+  const JOCTET FAR * p;
+  size_t cur;
+
+  for (;;) {
+    if (datasrc->next_input_byte < marker->index_base ||
+	datasrc->next_input_byte > marker->index_base + marker->index_avail)
+      return read_markers(cinfo);
+    cur = (size_t) (datasrc->next_input_byte - marker->index_base);
+
+    if (cinfo->unread_marker == 0) {
+      /* Next marker at or after the current position */
+      while (marker->next_entry < marker->num_entries &&
+	     marker->entries[marker->next_entry].offset < cur + 2)
+	marker->next_entry++;
+    } else {
+      /* The entropy decoder stopped at a marker and consumed its code */
+      while (marker->next_entry < marker->num_entries &&
+	     marker->entries[marker->next_entry].offset < cur)
+	marker->next_entry++;
+      if (marker->next_entry < marker->num_entries &&
+	  (marker->entries[marker->next_entry].offset != cur ||
+	   marker->entries[marker->next_entry].code != cinfo->unread_marker))
+	return read_markers(cinfo);
+    }
+    if (marker->next_entry >= marker->num_entries)
+      return read_markers(cinfo);
+
+    entry = &marker->entries[marker->next_entry++];
+    p = marker->index_base + entry->offset;
+    datasrc->next_input_byte = p;
+    datasrc->bytes_in_buffer = marker->index_avail - entry->offset;
+    cinfo->unread_marker = entry->code;
+
+    switch (entry->code) {
+    case M_SOI:
+      if (! get_soi(cinfo))
+	return JPEG_SUSPENDED;
+      break;
+
+    case M_SOF0:		/* Baseline */
+      if (! get_sof(cinfo, TRUE, FALSE, FALSE))
+	return JPEG_SUSPENDED;
+      break;
+
+    case M_SOF1:		/* Extended sequential, Huffman */
+      if (! get_sof(cinfo, FALSE, FALSE, FALSE))
+	return JPEG_SUSPENDED;
+      break;
+
+    case M_SOF2:		/* Progressive, Huffman */
+      if (! get_sof(cinfo, FALSE, TRUE, FALSE))
+	return JPEG_SUSPENDED;
+      break;
+
+    case M_SOF9:		/* Extended sequential, arithmetic */
+      if (! get_sof(cinfo, FALSE, FALSE, TRUE))
+	return JPEG_SUSPENDED;
+      break;
+
+    case M_SOF10:		/* Progressive, arithmetic */
+      if (! get_sof(cinfo, FALSE, TRUE, TRUE))
+	return JPEG_SUSPENDED;
+      break;
+
+    /* Currently unsupported SOFn types */
+    case M_SOF3:		/* Lossless, Huffman */
+    case M_SOF5:		/* Differential sequential, Huffman */
+    case M_SOF6:		/* Differential progressive, Huffman */
+    case M_SOF7:		/* Differential lossless, Huffman */
+    case M_JPG:			/* Reserved for JPEG extensions */
+    case M_SOF11:		/* Lossless, arithmetic */
+    case M_SOF13:		/* Differential sequential, arithmetic */
+    case M_SOF14:		/* Differential progressive, arithmetic */
+    case M_SOF15:		/* Differential lossless, arithmetic */
+      ERREXIT1(cinfo, JERR_SOF_UNSUPPORTED, cinfo->unread_marker);
+      break;
+
+    case M_SOS:
+      if (! get_sos(cinfo))
+	return JPEG_SUSPENDED;
+      cinfo->unread_marker = 0;	/* processed the marker */
+      return JPEG_REACHED_SOS;
+
+    case M_EOI:
+      TRACEMS(cinfo, 1, JTRC_EOI);
+      cinfo->unread_marker = 0;	/* processed the marker */
+      return JPEG_REACHED_EOI;
+
+    case M_DAC:
+      if (! get_dac(cinfo))
+	return JPEG_SUSPENDED;
+      break;
+
+    case M_DHT:
+      get_dht_direct(cinfo, p + 2, (INT32) (entry->end - entry->offset - 2));
+      break;
+
+    case M_DQT:
+      get_dqt_direct(cinfo, p + 2, (INT32) (entry->end - entry->offset - 2));
+      break;
+
+    case M_DRI:
+      get_dri_direct(cinfo, p + 2, (INT32) (entry->end - entry->offset - 2));
+      break;
+
+    case M_JPG8:
+      if (! get_lse(cinfo))
+	return JPEG_SUSPENDED;
+      break;
+
+    case M_APP0:
+    case M_APP1:
+    case M_APP2:
+    case M_APP3:
+    case M_APP4:
+    case M_APP5:
+    case M_APP6:
+    case M_APP7:
+    case M_APP8:
+    case M_APP9:
+    case M_APP10:
+    case M_APP11:
+    case M_APP12:
+    case M_APP13:
+    case M_APP14:
+    case M_APP15:
+      if (! (*marker->process_APPn[cinfo->unread_marker - (int) M_APP0])
+	      (cinfo))
+	return JPEG_SUSPENDED;
+      break;
+
+    case M_COM:
+      if (! (*marker->process_COM) (cinfo))
+	return JPEG_SUSPENDED;
+      break;
+
+    case M_RST0:		/* these are all parameterless */
+    case M_RST1:
+    case M_RST2:
+    case M_RST3:
+    case M_RST4:
+    case M_RST5:
+    case M_RST6:
+    case M_RST7:
+    case M_TEM:
+      TRACEMS1(cinfo, 1, JTRC_PARMLESS_MARKER, cinfo->unread_marker);
+      break;
+
+    case M_DNL:			/* Ignore DNL ... perhaps the wrong thing */
+      if (! skip_variable(cinfo))
+	return JPEG_SUSPENDED;
+      break;
+
+    default:			/* must be DHP, EXP, JPGn, or RESn */
+      ERREXIT1(cinfo, JERR_UNKNOWN_MARKER, cinfo->unread_marker);
+      break;
+    }
+
+    /* Continue after the marker's parameters, wherever the processing
+     * routine left the source.
+     */
+    datasrc->next_input_byte = marker->index_base + entry->end;
+    datasrc->bytes_in_buffer = marker->index_avail - entry->end;
+    cinfo->unread_marker = 0;
+  }
+}
+
+
+/*
+ * Index the markers and restart intervals of a datastream that is entirely
+ * in the source buffer, e.g. one set up with jpeg_mem_src.  Call before
+ * jpeg_read_header.  Returns FALSE, with the normal marker reader left in
+ * place, if the buffer does not start with a complete datastream.
+ */
+
+GLOBAL(boolean)
+jpeg_index_markers (j_decompress_ptr cinfo)
+{
+  my_marker_ptr marker = (my_marker_ptr) cinfo->marker;
+  struct jpeg_source_mgr * datasrc = cinfo->src;
+  int num_entries;
+  size_t num_intervals;
+
+  if (cinfo->global_state != DSTATE_START)
+    ERREXIT1(cinfo, JERR_BAD_STATE, cinfo->global_state);
+  if (datasrc == NULL || datasrc->next_input_byte == NULL)
+    return FALSE;
+
+  if (! scan_datastream(datasrc->next_input_byte, datasrc->bytes_in_buffer,
+			NULL, &num_entries, NULL, &num_intervals))
+    return FALSE;
+
+  marker->entries = (marker_entry FAR *) (*cinfo->mem->alloc_large)
+    ((j_common_ptr) cinfo, JPOOL_IMAGE, num_entries * SIZEOF(marker_entry));
+  marker->intervals = (restart_interval FAR *) (*cinfo->mem->alloc_large)
+    ((j_common_ptr) cinfo, JPOOL_IMAGE,
+     (num_intervals + 1) * SIZEOF(restart_interval));
+  (void) scan_datastream(datasrc->next_input_byte, datasrc->bytes_in_buffer,
+			 marker->entries, &num_entries,
+			 marker->intervals, &num_intervals);
+
+  marker->index_base = datasrc->next_input_byte;
+  marker->index_avail = datasrc->bytes_in_buffer;
+  marker->num_entries = num_entries;
+  marker->next_entry = 0;
+  marker->index_fresh = TRUE;
+  marker->pub.read_markers = read_markers_indexed;
+  return TRUE;
+}
+
+
+/*
+ * Return the number of restart intervals in scan scan_number (as counted by
+ * cinfo->input_scan_number), or 0 if the datastream is not indexed or has
+ * no such scan.  A scan without restart markers is one interval.
+ */
+
+GLOBAL(JDIMENSION)
+jpeg_count_restart_intervals (j_decompress_ptr cinfo, int scan_number)
+{
+  my_marker_ptr marker = (my_marker_ptr) cinfo->marker;
+  int i;
+
+  if (marker->entries == NULL)
+    return 0;
+  for (i = 0; i < marker->num_entries; i++)
+    if (marker->entries[i].code == (int) M_SOS &&
+	marker->entries[i].scan_number == scan_number)
+      return marker->entries[i].num_intervals;
+  return 0;
+}
+
+
+/*
+ * Locate the entropy-coded data of restart interval n (from 0) of scan
+ * scan_number, without the restart marker that ends it.
+ * Returns FALSE if there is no such interval.
+ */
+
+GLOBAL(boolean)
+jpeg_get_restart_interval (j_decompress_ptr cinfo, int scan_number,
+			   JDIMENSION n, const JOCTET FAR ** data,
+			   size_t * length)
+{
+  my_marker_ptr marker = (my_marker_ptr) cinfo->marker;
+  restart_interval FAR * interval;
+  int i;
+
+  if (marker->entries == NULL)
+    return FALSE;
+  for (i = 0; i < marker->num_entries; i++) {
+    if (marker->entries[i].code != (int) M_SOS ||
+	marker->entries[i].scan_number != scan_number)
+      continue;
+    if (n >= marker->entries[i].num_intervals)
+      return FALSE;
+    interval = &marker->intervals[marker->entries[i].first_interval + n];
+    *data = marker->index_base + interval->start;
+    *length = interval->end - interval->start;
+    return TRUE;
+  }
+  return FALSE;
+}
+
+
 /*
  * Read a restart marker, which is expected to appear next in the datastream;
  * if the marker is not there, take appropriate recovery action.
@@ -1099,6 +1677,22 @@ reset_marker_reader (j_decompress_ptr cinfo)
   marker->pub.saw_SOF = FALSE;
   marker->pub.discarded_bytes = 0;
   marker->cur_marker = NULL;
+
+  /* An index survives the reset done when reading of the datastream it was
+   * built for starts; any later reset means a new datastream, and the index
+   * memory has been released with the image pool anyway.
+   */
+  if (marker->index_fresh)
+    marker->index_fresh = FALSE;
+  else {
+    marker->index_base = NULL;
+    marker->index_avail = 0;
+    marker->entries = NULL;
+    marker->num_entries = 0;
+    marker->intervals = NULL;
+    marker->pub.read_markers = read_markers;
+  }
+  marker->next_entry = 0;
 }
 
 
@@ -1121,6 +1715,14 @@ jinit_marker_reader (j_decompress_ptr cinfo)
   marker->pub.reset_marker_reader = reset_marker_reader;
   marker->pub.read_markers = read_markers;
   marker->pub.read_restart_marker = read_restart_marker;
+  /* No marker index yet; alloc_small does not zero the object. */
+  marker->index_base = NULL;
+  marker->index_avail = 0;
+  marker->entries = NULL;
+  marker->num_entries = 0;
+  marker->next_entry = 0;
+  marker->intervals = NULL;
+  marker->index_fresh = FALSE;
   /* Initialize COM/APPn processing.
    * By default, we examine and then discard APP0 and APP14,
    * but simply discard COM and all other APPn.
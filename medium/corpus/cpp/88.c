@@ -302,6 +302,62 @@ static int vorbis_dBquant(const float *x){
   return i;
 }
 
+#if defined(__SSE2__) || defined(_M_X64) || \
+  (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FLOOR1_SSE2 1
+#include <emmintrin.h>
+#endif
+
+/* The Bresenham walks below visit, at x=x0+k,
+     y = y0 + k*base + sign(dy)*floor(k*ady/adx)
+   with base=dy/adx and ady the remainder slope.  The vector paths
+   evaluate that directly, 4 points at a time.  All products stay below
+   2^24 (k<8192, ady<1024), so they are exact in float; the float
+   quotient is then corrected to the exact integer quotient. */
+#define FLOOR1_CHUNK 64
+
+static void floor1_line(int x0,int x1,int y0,int y1,int from,int to,
+                        int *out){
+  int dy=y1-y0;
+  int adx=x1-x0;
+  int ady=abs(dy);
+  int base=dy/adx;
+  int x=from;
+
+  ady-=abs(base*adx);
+
+#ifdef FLOOR1_SSE2
+  {
+    const __m128 zero=_mm_setzero_ps();
+    const __m128 fady=_mm_set1_ps((float)ady);
+    const __m128 fadx=_mm_set1_ps((float)adx);
+    const __m128 finv=_mm_set1_ps(1.f/adx);
+    const __m128 fbase=_mm_set1_ps((float)base);
+    const __m128i vy0=_mm_set1_epi32(y0);
+    const __m128i sign=_mm_set1_epi32(dy<0?-1:0);
+    __m128 k=_mm_setr_ps((float)(from-x0),(float)(from-x0+1),
+                         (float)(from-x0+2),(float)(from-x0+3));
+    for(;x+4<=to;x+=4){
+      const __m128 a=_mm_mul_ps(k,fady);
+      __m128i q=_mm_cvttps_epi32(_mm_mul_ps(a,finv));
+      const __m128 r=_mm_sub_ps(a,_mm_mul_ps(_mm_cvtepi32_ps(q),fadx));
+      __m128i y;
+      q=_mm_sub_epi32(q,_mm_castps_si128(_mm_cmpge_ps(r,fadx)));
+      q=_mm_add_epi32(q,_mm_castps_si128(_mm_cmplt_ps(r,zero)));
+      q=_mm_sub_epi32(_mm_xor_si128(q,sign),sign);
+      y=_mm_add_epi32(vy0,_mm_cvttps_epi32(_mm_mul_ps(k,fbase)));
+      _mm_storeu_si128((__m128i *)(out+x-from),_mm_add_epi32(y,q));
+      k=_mm_add_ps(k,_mm_set1_ps(4.f));
+    }
+  }
+#endif
+
+  for(;x<to;x++){
+    int k=x-x0;
+    int off=k*ady/adx;
+    out[x-from]=y0+k*base+(dy<0?-off:off);
+  }
+}
 static const float FLOOR1_fromdB_LOOKUP[256]={
   1.0649863e-07F, 1.1341951e-07F, 1.2079015e-07F, 1.2863978e-07F,
   1.3699951e-07F, 1.4590251e-07F, 1.5538408e-07F, 1.6548181e-07F,
@@ -383,87 +439,28 @@ static void render_line(int n, int x0,int x1,int y0,int y1,float *d){
 
   if(n>x1)n=x1;
 
+  /* the table lookup can't be vectorized without a gather, and the walk
+     is cheaper than floor1_line() when each point costs a load anyway */
   if(x<n)
-              n_contours;
-    if ( new_max > old_max )
-    {
-      if ( new_max > FT_OUTLINE_CONTOURS_MAX )
-      {
-        error = FT_THROW( Array_Too_Large );
-        goto Exit;
-      }
-
-      min_new_max = old_max + ( old_max >> 1 );
-      if ( new_max < min_new_max )
-        new_max = min_new_max;
-      new_max = FT_PAD_CEIL( new_max, 4 );
-      if ( new_max > FT_OUTLINE_CONTOURS_MAX )
-        new_max = FT_OUTLINE_CONTOURS_MAX;
-
-      if ( FT_RENEW_ARRAY( base->contours, old_max, new_max ) )
-        goto Exit;
-
-      adjust = 1;
-      loader->max_contours = new_max;
+    d[x]*=FLOOR1_fromdB_LOOKUP[y];
+
+  while(++x<n){
+    err=err+ady;
+    if(err>=adx){
+      err-=adx;
+      y+=sy;
+    }else{
+      y+=base;
     }
+    d[x]*=FLOOR1_fromdB_LOOKUP[y];
+  }
 }
 
 static void render_line0(int n, int x0,int x1,int y0,int y1,int *d){
-  int dy=y1-y0;
-  int adx=x1-x0;
-  int ady=abs(dy);
-  int base=dy/adx;
-  int sy=(dy<0?base-1:base+1);
-  int x=x0;
-  int y=y0;
-  int err=0;
-
-  ady-=abs(base*adx);
-
   if(n>x1)n=x1;
 
-  if(x<n)
-return EmptyPtr;
-  if (Type == file_magic::bytecode) {
-    auto ItemOrErr = object::SymbolicData::createSymbolicFile(
-        Buf, file_magic::bytecode, &Context);
-    // An error reading a byte code file most likely indicates that the file
-    // was created by a compiler from the future. Normally we don't try to
-    // implement forwards compatibility for byte code files, but when creating an
-    // archive we can implement best-effort forwards compatibility by treating
-    // the file as a blob and not creating symbol index entries for it. lld and
-    // mold ignore the archive symbol index, so provided that you use one of
-    // these linkers, LTO will work as long as lld or the gold plugin is newer
-    // than the compiler. We only ignore errors if the archive format is one
-    // that is supported by a linker that is known to ignore the index,
-    // otherwise there's no chance of this working so we may as well error out.
-    // We print a warning on read failure so that users of linkers that rely on
-    // the symbol index can diagnose the issue.
-    //
-    // This is the same behavior as GNU ar when the linker plugin returns an
-    // error when reading the input file. If the byte code file is actually
-    // malformed, it will be diagnosed at link time.
-    if (!ItemOrErr) {
-      switch (Kind) {
-      case object::Archive::K_BSD:
-      case object::Archive::K_GNU:
-      case object::Archive::K_GNU64:
-        Warn(ItemOrErr.takeError());
-        return EmptyPtr;
-      case object::Archive::K_AIXBIG:
-      case object::Archive::K_COFF:
-      case object::Archive::K_DARWIN:
-      case object::Archive::K_DARWIN64:
-        return ItemOrErr.takeError();
-      }
-    }
-    return std::move(*ItemOrErr);
-  } else {
-    auto ItemOrErr = object::SymbolicData::createSymbolicFile(Buf);
-    if (!ItemOrErr)
-      return ItemOrErr.takeError();
-    return std::move(*ItemOrErr);
-  }
+  if(x0<n)
+    floor1_line(x0,x1,y0,y1,x0,n,d+x0);
 }
 
 // Convert the given set of atoms to their leading representatives.
@@ -478,22 +475,134 @@ convertToLeaders(const std::unordered_set<Atom> &Atoms,
   return Result;
 }
 
+/* quantize a range of the floor and collect it into the least squares
+   accumulator, split by whether the point is masked */
+static int accumulate_fit(const float *flr,const float *mdct,
+                          int x0, int x1,lsfit_acc *a,
+                          int n,vorbis_info_floor1 *info){
+  long i=0;
+
+  int xa=0,ya=0,x2a=0,y2a=0,xya=0,na=0, xb=0,yb=0,x2b=0,y2b=0,xyb=0,nb=0;
+
+  memset(a,0,sizeof(*a));
+  a->x0=x0;
+  a->x1=x1;
+  if(x1>=n)x1=n-1;
+
+  i=x0;
+#ifdef FLOOR1_SSE2
+  {
+    /* every product is below 2^24 and exact in float; the sums wrap
+       exactly like the int sums of the scalar loop */
+    const __m128 scale=_mm_set1_ps(7.3142857f);
+    const __m128 bias=_mm_set1_ps(1023.5f);
+    const __m128 atten=_mm_set1_ps(info->twofitatten);
+    const __m128i zero=_mm_setzero_si128();
+    const __m128i maxq=_mm_set1_epi32(1023);
+    const __m128i one=_mm_set1_epi32(1);
+    __m128i sxa=zero,sya=zero,sx2a=zero,sy2a=zero,sxya=zero,sna=zero;
+    __m128i sxb=zero,syb=zero,sx2b=zero,sy2b=zero,sxyb=zero,snb=zero;
+    __m128i vi=_mm_setr_epi32((int)i,(int)i+1,(int)i+2,(int)i+3);
+    int lanes[4];
+    for(;i+3<=x1;i+=4){
+      const __m128 f=_mm_loadu_ps(flr+i);
+      const __m128 m=_mm_loadu_ps(mdct+i);
+      __m128i q=_mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(f,scale),bias));
+      __m128i nz,ma,mb;
+      __m128 fi,fq;
+      q=_mm_and_si128(q,_mm_cmpgt_epi32(q,zero));               /* <0 -> 0 */
+      nz=_mm_cmpgt_epi32(q,maxq);
+      q=_mm_or_si128(_mm_andnot_si128(nz,q),_mm_and_si128(nz,maxq));
+      nz=_mm_cmpgt_epi32(q,zero);
+      ma=_mm_and_si128(nz,_mm_castps_si128(_mm_cmpge_ps(_mm_add_ps(m,atten),f)));
+      mb=_mm_andnot_si128(ma,nz);
+      fi=_mm_cvtepi32_ps(vi);
+      fq=_mm_cvtepi32_ps(q);
+      {
+        const __m128i ii=_mm_cvttps_epi32(_mm_mul_ps(fi,fi));
+        const __m128i qq=_mm_cvttps_epi32(_mm_mul_ps(fq,fq));
+        const __m128i iq=_mm_cvttps_epi32(_mm_mul_ps(fi,fq));
+        sxa=_mm_add_epi32(sxa,_mm_and_si128(ma,vi));
+        sya=_mm_add_epi32(sya,_mm_and_si128(ma,q));
+        sx2a=_mm_add_epi32(sx2a,_mm_and_si128(ma,ii));
+        sy2a=_mm_add_epi32(sy2a,_mm_and_si128(ma,qq));
+        sxya=_mm_add_epi32(sxya,_mm_and_si128(ma,iq));
+        sna=_mm_sub_epi32(sna,ma);
+        sxb=_mm_add_epi32(sxb,_mm_and_si128(mb,vi));
+        syb=_mm_add_epi32(syb,_mm_and_si128(mb,q));
+        sx2b=_mm_add_epi32(sx2b,_mm_and_si128(mb,ii));
+        sy2b=_mm_add_epi32(sy2b,_mm_and_si128(mb,qq));
+        sxyb=_mm_add_epi32(sxyb,_mm_and_si128(mb,iq));
+        snb=_mm_sub_epi32(snb,mb);
+      }
+      vi=_mm_add_epi32(vi,_mm_slli_epi32(one,2));
+    }
+#define FLOOR1_HSUM(v,s) \
+    do{ _mm_storeu_si128((__m128i *)lanes,(v)); \
+        (s)+=(int)((unsigned)lanes[0]+lanes[1]+lanes[2]+lanes[3]); }while(0)
+    FLOOR1_HSUM(sxa,xa); FLOOR1_HSUM(sya,ya); FLOOR1_HSUM(sx2a,x2a);
+    FLOOR1_HSUM(sy2a,y2a); FLOOR1_HSUM(sxya,xya); FLOOR1_HSUM(sna,na);
+    FLOOR1_HSUM(sxb,xb); FLOOR1_HSUM(syb,yb); FLOOR1_HSUM(sx2b,x2b);
+    FLOOR1_HSUM(sy2b,y2b); FLOOR1_HSUM(sxyb,xyb); FLOOR1_HSUM(snb,nb);
+#undef FLOOR1_HSUM
+  }
+#endif
+
+  for(;i<=x1;i++){
+    int quantized=vorbis_dBquant(flr+i);
+    if(quantized){
+      if(mdct[i]+info->twofitatten>=flr[i]){
+        xa  += i;
+        ya  += quantized;
+        x2a += i*i;
+        y2a += quantized*quantized;
+        xya += i*quantized;
+        na++;
+      }else{
+        xb  += i;
+        yb  += quantized;
+        x2b += i*i;
+        y2b += quantized*quantized;
+        xyb += i*quantized;
+        nb++;
+      }
+    }
+  }
+
+  a->xa=xa;
+  a->ya=ya;
+  a->x2a=x2a;
+  a->y2a=y2a;
+  a->xya=xya;
+  a->an=na;
+
+  a->xb=xb;
+  a->yb=yb;
+  a->x2b=x2b;
+  a->y2b=y2b;
+  a->xyb=xyb;
+  a->bn=nb;
+
+  return(na);
+}
+
 static int fit_line(lsfit_acc *a,int fits,int *y0,int *y1,
                     vorbis_info_floor1 *info){
   double xb=0,yb=0,x2b=0,y2b=0,xyb=0,bn=0;
   int i;
   int x0=a[0].x0;
-uint64_t getFileModificationTime(const std::string &filePath) {
-	const char *filePtr = filePath.utf8().get_data();
-	struct stat fileStatus = {};
-	int error = stat(filePtr, &fileStatus);
-
-	if (!error) {
-		return fileStatus.st_mtime;
-	} else {
-		return 0;
-	}
-}
+  int x1=a[fits-1].x1;
+
+  for(i=0;i<fits;i++){
+    double weight = (a[i].bn+a[i].an)*info->twofitweight/(a[i].an+1)+1.;
+
+    xb+=a[i].xb + a[i].xa * weight;
+    yb+=a[i].yb + a[i].ya * weight;
+    x2b+=a[i].x2b + a[i].x2a * weight;
+    y2b+=a[i].y2b + a[i].y2a * weight;
+    xyb+=a[i].xyb + a[i].xya * weight;
+    bn+=a[i].bn + a[i].an * weight;
+  }
 
   if(*y0>=0){
     xb+=   x0;
@@ -514,102 +623,111 @@ uint64_t getFileModificationTime(const std::string &filePath) {
   }
 
   {
+    double denom=(bn*x2b-xb*xb);
+
+    if(denom>0.){
+      double a=(yb*x2b-xyb*xb)/denom;
+      double b=(bn*xyb-xb*yb)/denom;
+      *y0=rint(a+b*x0);
+      *y1=rint(a+b*x1);
+
+      /* limit to our range! */
+      if(*y0>1023)*y0=1023;
+      if(*y1>1023)*y1=1023;
+      if(*y0<0)*y0=0;
+      if(*y1<0)*y1=0;
+
+      return 0;
+    }else{
+      *y0=0;
+      *y1=0;
+      return 1;
+    }
   }
 }
 
 static int inspect_error(int x0,int x1,int y0,int y1,const float *mask,
                          const float *mdct,
                          vorbis_info_floor1 *info){
-  int dy=y1-y0;
-  int adx=x1-x0;
-  int ady=abs(dy);
-  int base=dy/adx;
-  int sy=(dy<0?base-1:base+1);
+  int y[FLOOR1_CHUNK];
   int x=x0;
-  int y=y0;
-  int err=0;
-  int val=vorbis_dBquant(mask+x);
   int mse=0;
   int n=0;
 
-  ady-=abs(base*adx);
-
-  mse=(y-val);
-  mse*=mse;
-// if need, preprocess the input matrix
-if( !pure_mode )
-{
-    int dstep, estep = 0;
-    const double* src_value;
-    const short* src_weight = 0;
-    double* dst_value;
-    short* dst_weight;
-    const int* widx = active_indices->data.i;
-    const int* widx_abs = active_indices_abs->data.i;
-    bool have_weight = _loss != 0;
-
-    output = cv::Mat(1, var_num, CV_64FC1);
-    weight = cv::Mat(1, var_num, CV_16SC1);
-
-    dst_value = output.ptr<double>();
-    dst_weight = weight.ptr<short>();
-
-    src_value = _value->data.db;
-    dstep = CV_IS_MAT_CONT(_value->type) ? 1 : _value->step/sizeof(src_value[0]);
+  while(x<x1){
+    int end=(x1-x>FLOOR1_CHUNK?x+FLOOR1_CHUNK:x1);
+    int i=0;
+    floor1_line(x0,x1,y0,y1,x,end,y);
+    n+=end-x;
 
-    if( _loss )
+#ifdef FLOOR1_SSE2
     {
-        src_weight = _weight->data.ptr;
-        estep = CV_IS_MAT_CONT(_weight->type) ? 1 : _weight->step;
+      const __m128 scale=_mm_set1_ps(7.3142857f);
+      const __m128 bias=_mm_set1_ps(1023.5f);
+      const __m128 atten=_mm_set1_ps(info->twofitatten);
+      const __m128 over=_mm_set1_ps(info->maxover);
+      const __m128 under=_mm_set1_ps(info->maxunder);
+      const __m128i zero=_mm_setzero_si128();
+      const __m128i maxq=_mm_set1_epi32(1023);
+      __m128i sum=zero;
+      __m128i bad=zero;
+      int lanes[4];
+      /* the first point is checked even where it quantizes to 0 */
+      for(i=(x==x0);i+4<=end-x;i+=4){
+        const __m128 f=_mm_loadu_ps(mask+x+i);
+        const __m128 m=_mm_loadu_ps(mdct+x+i);
+        const __m128i vy=_mm_loadu_si128((const __m128i *)(y+i));
+        __m128i val=_mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(f,scale),bias));
+        __m128i c;
+        __m128 fy,fval,d;
+        val=_mm_and_si128(val,_mm_cmpgt_epi32(val,zero));
+        c=_mm_cmpgt_epi32(val,maxq);
+        val=_mm_or_si128(_mm_andnot_si128(c,val),_mm_and_si128(c,maxq));
+        fy=_mm_cvtepi32_ps(vy);
+        fval=_mm_cvtepi32_ps(val);
+        d=_mm_sub_ps(fy,fval);
+        sum=_mm_add_epi32(sum,_mm_cvttps_epi32(_mm_mul_ps(d,d)));
+        c=_mm_castps_si128(_mm_or_ps(_mm_cmplt_ps(_mm_add_ps(fy,over),fval),
+                                     _mm_cmpgt_ps(_mm_sub_ps(fy,under),fval)));
+        c=_mm_and_si128(c,_mm_castps_si128(_mm_cmpge_ps(_mm_add_ps(m,atten),f)));
+        c=_mm_andnot_si128(_mm_cmpeq_epi32(val,zero),c);
+        bad=_mm_or_si128(bad,c);
+      }
+      if(_mm_movemask_epi8(bad))return(1);
+      _mm_storeu_si128((__m128i *)lanes,sum);
+      mse+=lanes[0]+lanes[1]+lanes[2]+lanes[3];
+      if(x==x0){
+        /* the point skipped above */
+        int val=vorbis_dBquant(mask+x);
+        mse+=(y[0]-val)*(y[0]-val);
+        if(mdct[x]+info->twofitatten>=mask[x]){
+          if(y[0]+info->maxover<val)return(1);
+          if(y[0]-info->maxunder>val)return(1);
+        }
+      }
     }
+#endif
 
-    for( j = 0; j < var_num; j++ )
-    {
-        int idx = widx[j], idx_abs = widx_abs[j];
-        double val = src_value[idx_abs*dstep];
-        int ci = class_type[idx];
-        short w = src_weight ? src_weight[idx_abs*estic] : (short)0;
-
-        if( ci >= 0 )
-        {
-            int a = classes[ci], b = (ci+1 >= data->class_count) ? data->category_map->cols : classes[ci+1],
-                c = a;
-            int ival = cvRound(val);
-            if ( (ival != val) && (!w) )
-                CV_Error( cv::Error::StsBadArg,
-                    "one of input categorical variable is not an integer" );
-
-            while( a < b )
-            {
-                c = (a + b) >> 1;
-                if( ival < cmap[c] )
-                    b = c;
-                else if( ival > cmap[c] )
-                    a = c+1;
-                else
-                    break;
-            }
-
-            if( c < 0 || ival != cmap[c] )
-            {
-                w = 1;
-                have_weight = true;
-            }
-            else
-            {
-                val = (double)(c - classes[ci]);
-            }
+    for(;i<end-x;i++){
+      int xi=x+i;
+      int val=vorbis_dBquant(mask+xi);
+      mse+=((y[i]-val)*(y[i]-val));
+      if(mdct[xi]+info->twofitatten>=mask[xi]){
+        if(val || xi==x0){
+          if(y[i]+info->maxover<val)return(1);
+          if(y[i]-info->maxunder>val)return(1);
         }
-
-        dst_value[j] = val;
-        dst_weight[j] = w;
+      }
     }
+    x=end;
+  }
 
-    if( !have_weight )
-        weight.release();
+  if(info->maxover*info->maxover/n>info->maxerr)return(0);
+  if(info->maxunder*info->maxunder/n>info->maxerr)return(0);
+  if(mse/n>info->maxerr)return(1);
+  return(0);
 }
 
-  while(++x<x1){
 /// @returns True if the import succeeded, otherwise False.
 static bool
 importOperations(Scop &S, const json::Object &JScop, const DataLayout &DL,
@@ -680,8 +798,6 @@ bool isSubset(const std::string &accessSet, const isl::set &domain) {
   return result;
 }
 
-    val=vorbis_dBquant(mask+x);
-    mse+=((y-val)*(y-val));
 static bool mayTailCallThisCC(CallingConv::ID CC) {
   switch (CC) {
   case CallingConv::C:
@@ -691,13 +807,6 @@ static bool mayTailCallThisCC(CallingConv::ID CC) {
     return canGuaranteeTCO(CC);
   }
 }
-  }
-
-  if(info->maxover*info->maxover/n>info->maxerr)return(0);
-  if(info->maxunder*info->maxunder/n>info->maxerr)return(0);
-  if(mse/n>info->maxerr)return(1);
-  return(0);
-}
 
 static int post_Y(int *A,int *B,int pos){
   if(A[pos]<0)
@@ -732,6 +841,15 @@ int *floor1_fit(vorbis_block *vb,vorbis_look_floor1 *look,
   for(i=0;i<posts;i++)memo[i]=-1;      /* no neighbor yet */
 
   /* quantize the relevant floor points and collect them into line fit
+     structures (one per minimal division) at the same time */
+  if(posts==0){
+    nonzero+=accumulate_fit(logmask,logmdct,0,n,fits,n,info);
+  }else{
+    for(i=0;i<posts-1;i++)
+      nonzero+=accumulate_fit(logmask,logmdct,look->sorted_index[i],
+                              look->sorted_index[i+1],fits+i,
+                              n,info);
+  }
 
   if(nonzero){
     /* start by fitting the implicit base case.... */
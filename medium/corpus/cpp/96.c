@@ -1658,3 +1658,401 @@ unsigned long ZEXPORT inflateCodesUsed(z_streamp strm) {
     state = (struct inflate_state FAR *)strm->state;
     return (unsigned long)(state->next - state->codes);
 }
+
+/*
+   Indexed inflate: random access into a zlib, gzip, or raw deflate stream.
+
+   inflateIndexBuild() decompresses the whole stream once, with windowBits
+   interpreted as for inflateInit2(): 15 for zlib, 31 for gzip, 47 to detect
+   either, or -15 for raw deflate.  About every span bytes of output it
+   records an access point at the next deflate block boundary: the bit
+   position in the input, the offset in the output, and the 32K of output
+   that precede it.  inflateIndexExtract() restarts
+   decompression at the last access point at or before a requested offset
+   with inflatePrime() and inflateSetDictionary(), so that a range can be
+   decompressed without decoding the data that precedes it.  The index is
+   not modified after it is built, and each extraction uses the caller's own
+   z_stream, so different ranges can be extracted concurrently from several
+   threads over the same index and input.  inflateIndexSave() and
+   inflateIndexLoad() persist an index to and from a memory buffer.
+
+   The whole compressed input is passed as one buffer, which for large
+   archives is normally a memory mapping of the file.  Only the first member
+   of a concatenated gzip stream is indexed.
+ */
+
+#define IDXWIN 32768U           /* deflate window size, and snapshot size */
+#define IDXCHUNK 1073741824UL   /* largest input given to inflate() at once */
+#define IDXHEAD 16              /* serialized header: magic, count, length */
+#define IDXPOINT (17 + IDXWIN)  /* serialized access point */
+
+typedef struct {
+    z_off64_t out;              /* offset in uncompressed data */
+    z_off64_t in;               /* offset in input of first full byte */
+    int bits;                   /* number of bits (1-7) from byte at in-1, or 0 */
+    unsigned char FAR *window;  /* preceding 32K of uncompressed data */
+} inflate_point;
+
+struct inflate_index_s {
+    alloc_func zalloc;          /* allocator the index was built with */
+    free_func zfree;
+    voidpf opaque;
+    unsigned have;              /* number of access points in list */
+    unsigned size;              /* number of access points allocated */
+    inflate_point FAR *list;    /* access points, in increasing out order */
+    z_off64_t length;           /* total length of uncompressed data */
+};
+
+local void index_free(struct inflate_index_s FAR *index) {
+    unsigned n;
+
+    if (index == Z_NULL)
+        return;
+    for (n = 0; n < index->have; n++)
+        index->zfree(index->opaque, index->list[n].window);
+    if (index->list != Z_NULL)
+        index->zfree(index->opaque, index->list);
+    index->zfree(index->opaque, index);
+}
+
+/*
+   Allocate an empty index using the allocation functions of strm, defaulting
+   them as inflateInit2_() does.
+ */
+local struct inflate_index_s FAR *index_new(z_streamp strm) {
+    struct inflate_index_s FAR *index;
+
+    if (strm->zalloc == (alloc_func)0) {
+#ifdef Z_SOLO
+        return Z_NULL;
+#else
+        strm->zalloc = zcalloc;
+        strm->opaque = (voidpf)0;
+#endif
+    }
+    if (strm->zfree == (free_func)0)
+#ifdef Z_SOLO
+        return Z_NULL;
+#else
+        strm->zfree = zcfree;
+#endif
+    index = (struct inflate_index_s FAR *)
+            ZALLOC(strm, 1, sizeof(struct inflate_index_s));
+    if (index == Z_NULL)
+        return Z_NULL;
+    index->zalloc = strm->zalloc;
+    index->zfree = strm->zfree;
+    index->opaque = strm->opaque;
+    index->have = index->size = 0;
+    index->list = Z_NULL;
+    index->length = 0;
+    return index;
+}
+
+/*
+   Append an access point to index and return a pointer to it, or Z_NULL if
+   out of memory.  The window of the new point is allocated but not filled.
+ */
+local inflate_point FAR *index_grow(struct inflate_index_s FAR *index) {
+    inflate_point FAR *next;
+
+    if (index->have == index->size) {
+        unsigned size = index->size ? index->size << 1 : 8;
+        inflate_point FAR *list = (inflate_point FAR *)
+            index->zalloc(index->opaque, size, sizeof(inflate_point));
+        if (list == Z_NULL)
+            return Z_NULL;
+        if (index->have)
+            zmemcpy(list, index->list, index->have * sizeof(inflate_point));
+        if (index->list != Z_NULL)
+            index->zfree(index->opaque, index->list);
+        index->list = list;
+        index->size = size;
+    }
+    next = index->list + index->have;
+    next->window = (unsigned char FAR *)index->zalloc(index->opaque, IDXWIN, 1);
+    if (next->window == Z_NULL)
+        return Z_NULL;
+    index->have++;
+    return next;
+}
+
+int ZEXPORT inflateIndexBuild(z_streamp strm, int windowBits,
+                              const unsigned char FAR *input,
+                              z_size_t len, z_off64_t span,
+                              struct inflate_index_s FAR * FAR *built) {
+    int ret;
+    z_size_t pos = 0;           /* bytes of input given to inflate() */
+    z_off64_t totin = 0;        /* bytes of input consumed */
+    z_off64_t totout = 0;       /* bytes of output produced */
+    z_off64_t last = 0;         /* totout at the last access point */
+    unsigned char FAR *window;  /* circular buffer of the last 32K of output */
+    struct inflate_index_s FAR *index;
+
+    if (strm == Z_NULL || input == Z_NULL || span <= 0 || built == Z_NULL)
+        return Z_STREAM_ERROR;
+    *built = Z_NULL;
+    index = index_new(strm);
+    if (index == Z_NULL)
+        return Z_MEM_ERROR;
+    window = (unsigned char FAR *)ZALLOC(strm, IDXWIN, 1);
+    if (window == Z_NULL) {
+        index_free(index);
+        return Z_MEM_ERROR;
+    }
+    zmemzero(window, IDXWIN);
+    ret = inflateInit2(strm, windowBits);
+    if (ret != Z_OK) {
+        index->zfree(index->opaque, window);
+        index_free(index);
+        return ret;
+    }
+
+    /* a raw stream has no header to stop after, so the first access point
+       is the start of the input, with nothing preceding it */
+    if (windowBits < 0) {
+        inflate_point FAR *point = index_grow(index);
+        if (point == Z_NULL) {
+            inflateEnd(strm);
+            index->zfree(index->opaque, window);
+            index_free(index);
+            return Z_MEM_ERROR;
+        }
+        point->out = 0;
+        point->in = 0;
+        point->bits = 0;
+        zmemzero(point->window, IDXWIN);
+    }
+
+    strm->avail_in = 0;
+    strm->avail_out = 0;
+    do {
+        uInt in, out;
+
+        if (strm->avail_in == 0 && pos < len) {
+            strm->next_in = (z_const Bytef *)input + pos;
+            strm->avail_in = (uInt)(len - pos > IDXCHUNK ? IDXCHUNK : len - pos);
+            pos += strm->avail_in;
+        }
+        if (strm->avail_out == 0) {
+            strm->next_out = window;
+            strm->avail_out = IDXWIN;
+        }
+
+        /* stop at the end of each header and deflate block */
+        in = strm->avail_in;
+        out = strm->avail_out;
+        ret = inflate(strm, Z_BLOCK);
+        totin += in - strm->avail_in;
+        totout += out - strm->avail_out;
+        if (ret == Z_NEED_DICT || ret == Z_BUF_ERROR)
+            ret = Z_DATA_ERROR;         /* or input ended before the stream */
+        if (ret != Z_OK && ret != Z_STREAM_END)
+            break;
+
+        /* at a boundary that is not the end of the last block, add an access
+           point if span bytes were produced since the last one */
+        if ((strm->data_type & 192) == 128 &&
+            (index->have == 0 || totout - last >= span)) {
+            unsigned left = strm->avail_out;
+            inflate_point FAR *point = index_grow(index);
+            if (point == Z_NULL) {
+                ret = Z_MEM_ERROR;
+                break;
+            }
+            point->out = totout;
+            point->in = totin;
+            point->bits = strm->data_type & 7;
+            if (left)
+                zmemcpy(point->window, window + IDXWIN - left, left);
+            if (left < IDXWIN)
+                zmemcpy(point->window + left, window, IDXWIN - left);
+            last = totout;
+        }
+    } while (ret != Z_STREAM_END);
+
+    inflateEnd(strm);
+    index->zfree(index->opaque, window);
+    if (ret != Z_STREAM_END) {
+        index_free(index);
+        return ret;
+    }
+    index->length = totout;
+    *built = index;
+    Tracev((stderr, "inflate: index of %u points\n", index->have));
+    return Z_OK;
+}
+
+int ZEXPORT inflateIndexExtract(z_streamp strm,
+                                const struct inflate_index_s FAR *index,
+                                const unsigned char FAR *input, z_size_t len,
+                                z_off64_t offset, unsigned char FAR *buf,
+                                z_size_t size, z_size_t *got) {
+    int ret;
+    unsigned lo, hi;
+    z_size_t pos;
+    const inflate_point FAR *point;
+    unsigned char FAR *discard = Z_NULL;
+
+    if (strm == Z_NULL || index == Z_NULL || index->have == 0 ||
+        input == Z_NULL || offset < 0 || buf == Z_NULL || got == Z_NULL)
+        return Z_STREAM_ERROR;
+    *got = 0;
+    if (size == 0 || offset >= index->length)
+        return Z_OK;
+
+    /* find the last access point at or before offset */
+    lo = 0;
+    hi = index->have;
+    while (hi - lo > 1) {
+        unsigned mid = lo + ((hi - lo) >> 1);
+        if (index->list[mid].out <= offset)
+            lo = mid;
+        else
+            hi = mid;
+    }
+    point = index->list + lo;
+    if (offset < point->out || point->in > (z_off64_t)len ||
+        (point->bits && point->in == 0))
+        return Z_DATA_ERROR;
+
+    /* resume raw inflation at the access point */
+    ret = inflateInit2(strm, -15);
+    if (ret != Z_OK)
+        return ret;
+    pos = (z_size_t)point->in;
+    if (point->bits)
+        inflatePrime(strm, point->bits, input[pos - 1] >> (8 - point->bits));
+    inflateSetDictionary(strm, point->window, IDXWIN);
+    offset -= point->out;
+    if (offset) {
+        discard = (unsigned char FAR *)ZALLOC(strm, IDXWIN, 1);
+        if (discard == Z_NULL) {
+            inflateEnd(strm);
+            return Z_MEM_ERROR;
+        }
+    }
+
+    /* skip to offset, then fill buf */
+    strm->avail_in = 0;
+    do {
+        uInt out;
+
+        if (offset) {
+            strm->next_out = discard;
+            strm->avail_out = offset < IDXWIN ? (uInt)offset : IDXWIN;
+        }
+        else {
+            strm->next_out = buf + *got;
+            strm->avail_out = (uInt)(size - *got > IDXCHUNK ? IDXCHUNK :
+                                     size - *got);
+        }
+        if (strm->avail_in == 0 && pos < len) {
+            strm->next_in = (z_const Bytef *)input + pos;
+            strm->avail_in = (uInt)(len - pos > IDXCHUNK ? IDXCHUNK : len - pos);
+            pos += strm->avail_in;
+        }
+        out = strm->avail_out;
+        ret = inflate(strm, Z_NO_FLUSH);
+        out -= strm->avail_out;
+        if (offset)
+            offset -= out;
+        else
+            *got += out;
+        if (ret == Z_NEED_DICT || ret == Z_BUF_ERROR)
+            ret = Z_DATA_ERROR;         /* or input ended before the stream */
+    } while (ret == Z_OK && *got < size);
+
+    if (discard != Z_NULL)
+        ZFREE(strm, discard);
+    inflateEnd(strm);
+    return ret == Z_STREAM_END ? Z_OK : ret;
+}
+
+local void index_put(unsigned char FAR *buf, z_off64_t val, int n) {
+    while (n--) {
+        *buf++ = (unsigned char)(val & 0xff);
+        val >>= 8;
+    }
+}
+
+local z_off64_t index_get(const unsigned char FAR *buf, int n) {
+    z_off64_t val = 0;
+
+    while (n--)
+        val = (val << 8) + buf[n];
+    return val;
+}
+
+z_size_t ZEXPORT inflateIndexSave(const struct inflate_index_s FAR *index,
+                                  unsigned char FAR *buf, z_size_t size) {
+    z_size_t need;
+    unsigned n;
+
+    if (index == Z_NULL)
+        return 0;
+    need = IDXHEAD + (z_size_t)index->have * IDXPOINT;
+    if (buf == Z_NULL || size < need)
+        return need;
+    zmemcpy(buf, "zidx", 4);
+    index_put(buf + 4, index->have, 4);
+    index_put(buf + 8, index->length, 8);
+    buf += IDXHEAD;
+    for (n = 0; n < index->have; n++) {
+        const inflate_point FAR *point = index->list + n;
+        index_put(buf, point->out, 8);
+        index_put(buf + 8, point->in, 8);
+        buf[16] = (unsigned char)point->bits;
+        zmemcpy(buf + 17, point->window, IDXWIN);
+        buf += IDXPOINT;
+    }
+    return need;
+}
+
+int ZEXPORT inflateIndexLoad(z_streamp strm, const unsigned char FAR *buf,
+                             z_size_t size,
+                             struct inflate_index_s FAR * FAR *loaded) {
+    unsigned have, n;
+    struct inflate_index_s FAR *index;
+
+    if (strm == Z_NULL || buf == Z_NULL || loaded == Z_NULL)
+        return Z_STREAM_ERROR;
+    *loaded = Z_NULL;
+    if (size < IDXHEAD || zmemcmp(buf, "zidx", 4) != 0)
+        return Z_DATA_ERROR;
+    have = (unsigned)index_get(buf + 4, 4);
+    if (have == 0 || (size - IDXHEAD) / IDXPOINT < have)
+        return Z_DATA_ERROR;
+    index = index_new(strm);
+    if (index == Z_NULL)
+        return Z_MEM_ERROR;
+    index->length = index_get(buf + 8, 8);
+    buf += IDXHEAD;
+    for (n = 0; n < have; n++) {
+        inflate_point FAR *point = index_grow(index);
+        if (point == Z_NULL) {
+            index_free(index);
+            return Z_MEM_ERROR;
+        }
+        point->out = index_get(buf, 8);
+        point->in = index_get(buf + 8, 8);
+        point->bits = buf[16];
+        zmemcpy(point->window, buf + 17, IDXWIN);
+        if (point->bits > 7 || point->out < 0 || point->in < 0 ||
+            point->out > index->length ||
+            (n == 0 && point->out != 0) ||
+            (n && (point->out <= index->list[n - 1].out ||
+                   point->in <= index->list[n - 1].in))) {
+            index_free(index);
+            return Z_DATA_ERROR;
+        }
+        buf += IDXPOINT;
+    }
+    *loaded = index;
+    return Z_OK;
+}
+
+int ZEXPORT inflateIndexFree(struct inflate_index_s FAR *index) {
+    index_free(index);
+    return Z_OK;
+}
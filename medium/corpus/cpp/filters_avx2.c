@@ -0,0 +1,128 @@
+// Copyright 2026 Google Inc. All Rights Reserved.
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the COPYING file in the root of the source
+// tree. An additional intellectual property rights grant can be found
+// in the file PATENTS. All contributing project authors may
+// be found in the AUTHORS file in the root of the source tree.
+// -----------------------------------------------------------------------------
+//
+// AVX2 variant of alpha filters
+
+#include "src/dsp/dsp.h"
+
+#if defined(WEBP_USE_AVX2)
+
+#include <immintrin.h>
+
+//------------------------------------------------------------------------------
+// Inverse transforms. The gradient filter is serial in the left sample and
+// keeps the SSE2 version.
+
+static void HorizontalUnfilter_AVX2(const uint8_t* prev, const uint8_t* in,
+                                    uint8_t* out, int width) {
+  int i;
+  __m256i last;
+  out[0] = (uint8_t)(in[0] + (prev == NULL ? 0 : prev[0]));
+  if (width <= 1) return;
+  last = _mm256_set1_epi8((char)out[0]);
+  for (i = 1; i + 32 <= width; i += 32) {
+    // running sum in each 128-bit lane, then carry the low lane into the high
+    const __m256i A0 = _mm256_loadu_si256((const __m256i*)(in + i));
+    const __m256i A1 = _mm256_add_epi8(A0, _mm256_slli_si256(A0, 1));
+    const __m256i A2 = _mm256_add_epi8(A1, _mm256_slli_si256(A1, 2));
+    const __m256i A3 = _mm256_add_epi8(A2, _mm256_slli_si256(A2, 4));
+    const __m256i A4 = _mm256_add_epi8(A3, _mm256_slli_si256(A3, 8));
+    const __m256i lo_sum =
+        _mm256_shuffle_epi8(A4, _mm256_set1_epi8(15));  // byte 15, per lane
+    const __m256i carry = _mm256_permute2x128_si256(lo_sum, lo_sum, 0x08);
+    const __m256i A5 = _mm256_add_epi8(_mm256_add_epi8(A4, carry), last);
+    _mm256_storeu_si256((__m256i*)(out + i), A5);
+    last = _mm256_permute4x64_epi64(_mm256_shuffle_epi8(A5,
+                                                        _mm256_set1_epi8(15)),
+                                    0xff);
+  }
+  for (; i < width; ++i) out[i] = (uint8_t)(in[i] + out[i - 1]);
+}
+
+static void VerticalUnfilter_AVX2(const uint8_t* prev, const uint8_t* in,
+                                  uint8_t* out, int width) {
+  if (prev == NULL) {
+    HorizontalUnfilter_AVX2(NULL, in, out, width);
+  } else {
+    int i;
+    for (i = 0; i + 32 <= width; i += 32) {
+      const __m256i A = _mm256_loadu_si256((const __m256i*)(in + i));
+      const __m256i B = _mm256_loadu_si256((const __m256i*)(prev + i));
+      _mm256_storeu_si256((__m256i*)(out + i), _mm256_add_epi8(A, B));
+    }
+    for (; i < width; ++i) out[i] = (uint8_t)(in[i] + prev[i]);
+  }
+}
+
+static int ApplyAlphaRow_AVX2(const uint8_t* alpha, int width, uint8_t* rgba,
+                              int alpha_first, int premultiply) {
+  const int shift = alpha_first ? 0 : 24;
+  const __m256i amask = _mm256_set1_epi32((int)(0xffu << shift));
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i kMult = _mm256_set1_epi16((short)0x8081);
+  // alpha of pixels 0-1 (resp. 2-3) of each lane in all four 16-bit channels
+  const __m256i kSpreadLo =
+      _mm256_setr_epi8(0, -1, 0, -1, 0, -1, 0, -1, 4, -1, 4, -1, 4, -1, 4, -1,
+                       0, -1, 0, -1, 0, -1, 0, -1, 4, -1, 4, -1, 4, -1, 4, -1);
+  const __m256i kSpreadHi =
+      _mm256_setr_epi8(8, -1, 8, -1, 8, -1, 8, -1, 12, -1, 12, -1, 12, -1, 12,
+                       -1, 8, -1, 8, -1, 8, -1, 8, -1, 12, -1, 12, -1, 12, -1,
+                       12, -1);
+  uint32_t all_alphas = 0xff;
+  int i;
+  for (i = 0; i + 8 <= width; i += 8) {
+    const __m128i a8 = _mm_loadl_epi64((const __m128i*)&alpha[i]);
+    const __m256i a32 = _mm256_cvtepu8_epi32(a8);
+    __m256i* const dst = (__m256i*)&rgba[4 * i];
+    const __m256i argb = _mm256_loadu_si256(dst);
+    __m256i out;
+    if (premultiply) {
+      const __m256i rgb = _mm256_or_si256(argb, amask);
+      const __m256i A0_lo =
+          _mm256_mullo_epi16(_mm256_unpacklo_epi8(rgb, zero),
+                             _mm256_shuffle_epi8(a32, kSpreadLo));
+      const __m256i A0_hi =
+          _mm256_mullo_epi16(_mm256_unpackhi_epi8(rgb, zero),
+                             _mm256_shuffle_epi8(a32, kSpreadHi));
+      const __m256i A1_lo =
+          _mm256_srli_epi16(_mm256_mulhi_epu16(A0_lo, kMult), 7);
+      const __m256i A1_hi =
+          _mm256_srli_epi16(_mm256_mulhi_epu16(A0_hi, kMult), 7);
+      out = _mm256_packus_epi16(A1_lo, A1_hi);
+    } else {
+      out = _mm256_or_si256(_mm256_andnot_si256(amask, argb),
+                            _mm256_slli_epi32(a32, shift));
+    }
+    _mm256_storeu_si256(dst, out);
+    {
+      const __m128i m = _mm_and_si128(a8, _mm_srli_epi64(a8, 32));
+      const uint32_t v = (uint32_t)_mm_cvtsi128_si32(m);
+      all_alphas &= v & (v >> 8) & (v >> 16) & (v >> 24);
+    }
+  }
+  return WebPApplyAlphaRow_C(alpha + i, width - i, rgba + 4 * i,
+                         alpha_first, premultiply) | (all_alphas != 0xff);
+}
+
+//------------------------------------------------------------------------------
+// Entry point
+
+extern void VP8FiltersInitAVX2(void);
+
+WEBP_TSAN_IGNORE_FUNCTION void VP8FiltersInitAVX2(void) {
+  WebPUnfilters[WEBP_FILTER_HORIZONTAL] = HorizontalUnfilter_AVX2;
+  WebPUnfilters[WEBP_FILTER_VERTICAL] = VerticalUnfilter_AVX2;
+  WebPApplyAlphaRow = ApplyAlphaRow_AVX2;
+}
+
+#else  // !WEBP_USE_AVX2
+
+WEBP_DSP_INIT_STUB(VP8FiltersInitAVX2)
+
+#endif  // WEBP_USE_AVX2
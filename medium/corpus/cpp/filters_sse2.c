@@ -0,0 +1,186 @@
+// Copyright 2026 Google Inc. All Rights Reserved.
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the COPYING file in the root of the source
+// tree. An additional intellectual property rights grant can be found
+// in the file PATENTS. All contributing project authors may
+// be found in the AUTHORS file in the root of the source tree.
+// -----------------------------------------------------------------------------
+//
+// SSE2 variant of alpha filters
+
+#include "src/dsp/dsp.h"
+
+#if defined(WEBP_USE_SSE2)
+
+#include <emmintrin.h>
+
+//------------------------------------------------------------------------------
+// Inverse transforms
+
+static void HorizontalUnfilter_SSE2(const uint8_t* prev, const uint8_t* in,
+                                    uint8_t* out, int width) {
+  int i;
+  __m128i last;
+  out[0] = (uint8_t)(in[0] + (prev == NULL ? 0 : prev[0]));
+  if (width <= 1) return;
+  last = _mm_set_epi32(0, 0, 0, out[0]);
+  for (i = 1; i + 16 <= width; i += 16) {
+    // running sum over the 16 bytes, in log2(16) steps
+    const __m128i A0 = _mm_loadu_si128((const __m128i*)(in + i));
+    const __m128i A1 = _mm_add_epi8(A0, last);
+    const __m128i A2 = _mm_add_epi8(A1, _mm_slli_si128(A1, 1));
+    const __m128i A3 = _mm_add_epi8(A2, _mm_slli_si128(A2, 2));
+    const __m128i A4 = _mm_add_epi8(A3, _mm_slli_si128(A3, 4));
+    const __m128i A5 = _mm_add_epi8(A4, _mm_slli_si128(A4, 8));
+    _mm_storeu_si128((__m128i*)(out + i), A5);
+    last = _mm_srli_si128(A5, 15);
+  }
+  for (; i < width; ++i) out[i] = (uint8_t)(in[i] + out[i - 1]);
+}
+
+static void VerticalUnfilter_SSE2(const uint8_t* prev, const uint8_t* in,
+                                  uint8_t* out, int width) {
+  if (prev == NULL) {
+    HorizontalUnfilter_SSE2(NULL, in, out, width);
+  } else {
+    int i;
+    for (i = 0; i + 16 <= width; i += 16) {
+      const __m128i A = _mm_loadu_si128((const __m128i*)(in + i));
+      const __m128i B = _mm_loadu_si128((const __m128i*)(prev + i));
+      _mm_storeu_si128((__m128i*)(out + i), _mm_add_epi8(A, B));
+    }
+    for (; i < width; ++i) out[i] = (uint8_t)(in[i] + prev[i]);
+  }
+}
+
+static WEBP_INLINE int GradientPredictor_SSE2(uint8_t a, uint8_t b,
+                                              uint8_t c) {
+  const int g = a + b - c;
+  return ((g & ~0xff) == 0) ? g : (g < 0) ? 0 : 255;  // clip to 8bit
+}
+
+// The left sample makes the gradient serial: each step of the inner loop
+// resolves one more pixel of the 8 in flight.
+static void GradientPredictInverse_SSE2(const uint8_t* const in,
+                                        const uint8_t* const top,
+                                        uint8_t* const row, int length) {
+  if (length > 0) {
+    int i;
+    const int max_pos = length & ~7;
+    const __m128i zero = _mm_setzero_si128();
+    __m128i A = _mm_set_epi32(0, 0, 0, row[-1]);   // left sample
+    for (i = 0; i < max_pos; i += 8) {
+      const __m128i tmp0 = _mm_loadl_epi64((const __m128i*)&top[i]);
+      const __m128i tmp1 = _mm_loadl_epi64((const __m128i*)&top[i - 1]);
+      const __m128i B = _mm_unpacklo_epi8(tmp0, zero);
+      const __m128i C = _mm_unpacklo_epi8(tmp1, zero);
+      const __m128i D = _mm_loadl_epi64((const __m128i*)&in[i]);  // base input
+      const __m128i E = _mm_sub_epi16(B, C);  // unclipped gradient basis b - c
+      __m128i out = zero;                     // accumulator for output
+      __m128i mask_hi = _mm_set_epi32(0, 0, 0, 0xff);
+      int k = 8;
+      while (1) {
+        const __m128i tmp3 = _mm_add_epi16(A, E);           // delta = a + b - c
+        const __m128i tmp4 = _mm_packus_epi16(tmp3, zero);  // saturate delta
+        const __m128i tmp5 = _mm_add_epi8(tmp4, D);         // add to in[]
+        A = _mm_and_si128(tmp5, mask_hi);                   // 1-complement clip
+        out = _mm_or_si128(out, A);                         // accumulate output
+        if (--k == 0) break;
+        A = _mm_slli_si128(A, 1);                           // rotate left sample
+        mask_hi = _mm_slli_si128(mask_hi, 1);               // rotate mask
+        A = _mm_unpacklo_epi8(A, zero);                     // convert 8b->16b
+      }
+      A = _mm_srli_si128(A, 7);       // prepare left sample for next iteration
+      _mm_storel_epi64((__m128i*)&row[i], out);
+    }
+    for (; i < length; ++i) {
+      const int delta = GradientPredictor_SSE2(row[i - 1], top[i], top[i - 1]);
+      row[i] = (uint8_t)(in[i] + delta);
+    }
+  }
+}
+
+static void GradientUnfilter_SSE2(const uint8_t* prev, const uint8_t* in,
+                                  uint8_t* out, int width) {
+  if (prev == NULL) {
+    HorizontalUnfilter_SSE2(NULL, in, out, width);
+  } else {
+    out[0] = (uint8_t)(in[0] + prev[0]);  // predict from above
+    GradientPredictInverse_SSE2(in + 1, prev + 1, out + 1, width - 1);
+  }
+}
+
+// Stores 4 alpha values (in the low bytes of the 32-bit lanes of 'a32') in
+// 4 RGBA pixels, premultiplying the color channels if requested.
+static WEBP_INLINE __m128i ApplyAlpha4_SSE2(const __m128i argb,
+                                            const __m128i a32,
+                                            int alpha_first,
+                                            int premultiply) {
+  const int shift = alpha_first ? 0 : 24;
+  const __m128i amask = _mm_set1_epi32((int)(0xffu << shift));
+  if (premultiply) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i kMult = _mm_set1_epi16((short)0x8081);
+    // Setting the alpha channel to 0xff makes it come out as 'a' below.
+    const __m128i rgb = _mm_or_si128(argb, amask);
+    const __m128i a16 = _mm_or_si128(a32, _mm_slli_epi32(a32, 16));  // 0a0a
+    const __m128i a_lo = _mm_unpacklo_epi32(a16, a16);
+    const __m128i a_hi = _mm_unpackhi_epi32(a16, a16);
+    const __m128i A0_lo = _mm_mullo_epi16(_mm_unpacklo_epi8(rgb, zero), a_lo);
+    const __m128i A0_hi = _mm_mullo_epi16(_mm_unpackhi_epi8(rgb, zero), a_hi);
+    const __m128i A1_lo = _mm_srli_epi16(_mm_mulhi_epu16(A0_lo, kMult), 7);
+    const __m128i A1_hi = _mm_srli_epi16(_mm_mulhi_epu16(A0_hi, kMult), 7);
+    return _mm_packus_epi16(A1_lo, A1_hi);
+  }
+  return _mm_or_si128(_mm_andnot_si128(amask, argb),
+                      _mm_slli_epi32(a32, shift));
+}
+
+static int ApplyAlphaRow_SSE2(const uint8_t* alpha, int width, uint8_t* rgba,
+                              int alpha_first, int premultiply) {
+  const __m128i zero = _mm_setzero_si128();
+  __m128i all_alphas = _mm_set1_epi8((char)0xff);
+  int i;
+  for (i = 0; i + 16 <= width; i += 16) {
+    const __m128i a8 = _mm_loadu_si128((const __m128i*)&alpha[i]);
+    const __m128i a16_lo = _mm_unpacklo_epi8(a8, zero);
+    const __m128i a16_hi = _mm_unpackhi_epi8(a8, zero);
+    const __m128i a32[4] = {
+      _mm_unpacklo_epi16(a16_lo, zero), _mm_unpackhi_epi16(a16_lo, zero),
+      _mm_unpacklo_epi16(a16_hi, zero), _mm_unpackhi_epi16(a16_hi, zero)
+    };
+    int k;
+    for (k = 0; k < 4; ++k) {
+      __m128i* const dst = (__m128i*)&rgba[4 * (i + 4 * k)];
+      _mm_storeu_si128(dst, ApplyAlpha4_SSE2(_mm_loadu_si128(dst), a32[k],
+                                             alpha_first, premultiply));
+    }
+    all_alphas = _mm_and_si128(all_alphas, a8);
+  }
+  {
+    const int has_alpha =
+        (_mm_movemask_epi8(_mm_cmpeq_epi8(all_alphas,
+                                          _mm_set1_epi8((char)0xff))) != 0xffff);
+    return WebPApplyAlphaRow_C(alpha + i, width - i, rgba + 4 * i,
+                           alpha_first, premultiply) | has_alpha;
+  }
+}
+
+//------------------------------------------------------------------------------
+// Entry point
+
+extern void VP8FiltersInitSSE2(void);
+
+WEBP_TSAN_IGNORE_FUNCTION void VP8FiltersInitSSE2(void) {
+  WebPUnfilters[WEBP_FILTER_HORIZONTAL] = HorizontalUnfilter_SSE2;
+  WebPUnfilters[WEBP_FILTER_VERTICAL] = VerticalUnfilter_SSE2;
+  WebPUnfilters[WEBP_FILTER_GRADIENT] = GradientUnfilter_SSE2;
+  WebPApplyAlphaRow = ApplyAlphaRow_SSE2;
+}
+
+#else  // !WEBP_USE_SSE2
+
+WEBP_DSP_INIT_STUB(VP8FiltersInitSSE2)
+
+#endif  // WEBP_USE_SSE2
@@ -0,0 +1,274 @@
+// Copyright 2026 Google Inc. All Rights Reserved.
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the COPYING file in the root of the source
+// tree. An additional intellectual property rights grant can be found
+// in the file PATENTS. All contributing project authors may
+// be found in the AUTHORS file in the root of the source tree.
+// -----------------------------------------------------------------------------
+//
+// AVX2 variant of methods for lossless decoder
+
+#include "src/dsp/dsp.h"
+
+#if defined(WEBP_USE_AVX2)
+
+#include <immintrin.h>
+
+#include "src/dsp/cpu.h"
+#include "src/dsp/lossless.h"
+#include "src/dsp/lossless_common.h"
+
+//------------------------------------------------------------------------------
+// Predictor Transform
+
+// Per-byte floor((a + b) / 2), as Average2().
+static WEBP_INLINE __m256i Average2_u8_AVX2(const __m256i a, const __m256i b) {
+  const __m256i avg = _mm256_avg_epu8(a, b);
+  const __m256i one = _mm256_and_si256(_mm256_xor_si256(a, b),
+                                       _mm256_set1_epi8(1));
+  return _mm256_sub_epi8(avg, one);
+}
+
+static WEBP_INLINE __m128i Average2_u8_SSE(const __m128i a, const __m128i b) {
+  const __m128i avg = _mm_avg_epu8(a, b);
+  const __m128i one = _mm_and_si128(_mm_xor_si128(a, b), _mm_set1_epi8(1));
+  return _mm_sub_epi8(avg, one);
+}
+
+// Predictors 0, 1, 2, 3, 4, 8 and 9 don't depend on the left pixel and are
+// done 8 pixels at a time.
+#define LOAD_UPPER(OFF) _mm256_loadu_si256((const __m256i*)&upper[i + (OFF)])
+
+#define GENERATE_PREDICTOR_ADD_AVX2(X, PRED)                                  \
+static void PredictorAdd##X##_AVX2(const uint32_t* in, const uint32_t* upper, \
+                                   int num_pixels, uint32_t* out) {           \
+  int i;                                                                      \
+  (void)upper;                                                                \
+  for (i = 0; i + 8 <= num_pixels; i += 8) {                                  \
+    const __m256i src = _mm256_loadu_si256((const __m256i*)&in[i]);           \
+    _mm256_storeu_si256((__m256i*)&out[i], _mm256_add_epi8(src, (PRED)));     \
+  }                                                                           \
+  if (i != num_pixels) {                                                      \
+    VP8LPredictorsAdd_C[(X)](in + i, upper + i, num_pixels - i, out + i);     \
+  }                                                                           \
+}
+
+GENERATE_PREDICTOR_ADD_AVX2(0, _mm256_set1_epi32((int)ARGB_BLACK))
+GENERATE_PREDICTOR_ADD_AVX2(2, LOAD_UPPER(0))
+GENERATE_PREDICTOR_ADD_AVX2(3, LOAD_UPPER(1))
+GENERATE_PREDICTOR_ADD_AVX2(4, LOAD_UPPER(-1))
+GENERATE_PREDICTOR_ADD_AVX2(8, Average2_u8_AVX2(LOAD_UPPER(-1), LOAD_UPPER(0)))
+GENERATE_PREDICTOR_ADD_AVX2(9, Average2_u8_AVX2(LOAD_UPPER(0), LOAD_UPPER(1)))
+
+#undef GENERATE_PREDICTOR_ADD_AVX2
+#undef LOAD_UPPER
+
+// Predictor1: left, i.e. a running sum over the row.
+static void PredictorAdd1_AVX2(const uint32_t* in, const uint32_t* upper,
+                               int num_pixels, uint32_t* out) {
+  int i;
+  __m256i prev = _mm256_set1_epi32((int)out[-1]);
+  const __m256i last = _mm256_set1_epi32(7);
+  (void)upper;
+  for (i = 0; i + 8 <= num_pixels; i += 8) {
+    // a | b | c | d  ->  a | a+b | a+b+c | a+b+c+d, in each 128-bit lane
+    const __m256i src = _mm256_loadu_si256((const __m256i*)&in[i]);
+    const __m256i sum0 = _mm256_add_epi8(src, _mm256_slli_si256(src, 4));
+    const __m256i sum1 = _mm256_add_epi8(sum0, _mm256_slli_si256(sum0, 8));
+    // carry the low lane's total into the high lane
+    const __m256i carry =
+        _mm256_permute2x128_si256(_mm256_shuffle_epi32(sum1, 0xff),
+                                  _mm256_shuffle_epi32(sum1, 0xff), 0x08);
+    const __m256i res = _mm256_add_epi8(_mm256_add_epi8(sum1, carry), prev);
+    _mm256_storeu_si256((__m256i*)&out[i], res);
+    prev = _mm256_permutevar8x32_epi32(res, last);
+  }
+  if (i != num_pixels) {
+    VP8LPredictorsAdd_C[1](in + i, upper + i, num_pixels - i, out + i);
+  }
+}
+
+// The other predictors depend on the pixel just decoded on the left: the top
+// pixels are loaded 4 at a time, and the prediction itself is serial, with
+// the current pixel in the low 32 bits of the vectors.
+static WEBP_INLINE __m128i Select_SSE(const __m128i a, const __m128i b,
+                                      const __m128i c) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i pa = _mm_sad_epu8(_mm_unpacklo_epi32(a, zero),
+                                  _mm_unpacklo_epi32(c, zero));
+  const __m128i pb = _mm_sad_epu8(_mm_unpacklo_epi32(b, zero),
+                                  _mm_unpacklo_epi32(c, zero));
+  // Select() picks 'a' when sum|b - c| <= sum|a - c|.
+  return _mm_blendv_epi8(a, b, _mm_cmpgt_epi32(pb, pa));
+}
+
+static WEBP_INLINE __m128i ClampedAddSubtractFull_SSE(const __m128i c0,
+                                                      const __m128i c1,
+                                                      const __m128i c2) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i sum = _mm_add_epi16(_mm_unpacklo_epi8(c0, zero),
+                                    _mm_unpacklo_epi8(c1, zero));
+  return _mm_packus_epi16(_mm_sub_epi16(sum, _mm_unpacklo_epi8(c2, zero)),
+                          zero);
+}
+
+static WEBP_INLINE __m128i ClampedAddSubtractHalf_SSE(const __m128i c0,
+                                                      const __m128i c1,
+                                                      const __m128i c2) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i ave = _mm_unpacklo_epi8(Average2_u8_SSE(c0, c1), zero);
+  const __m128i A1 = _mm_sub_epi16(ave, _mm_unpacklo_epi8(c2, zero));
+  // (a - b) / 2 rounds towards zero
+  const __m128i A2 = _mm_add_epi16(A1, _mm_srli_epi16(A1, 15));
+  return _mm_packus_epi16(_mm_add_epi16(ave, _mm_srai_epi16(A2, 1)), zero);
+}
+
+#define GENERATE_PREDICTOR_ADD_SERIAL(X, PRED)                                \
+static void PredictorAdd##X##_AVX2(const uint32_t* in, const uint32_t* upper, \
+                                   int num_pixels, uint32_t* out) {           \
+  int i, k;                                                                   \
+  __m128i L = _mm_cvtsi32_si128((int)out[-1]);                                \
+  for (i = 0; i + 4 <= num_pixels; i += 4) {                                  \
+    __m128i TL = _mm_loadu_si128((const __m128i*)&upper[i - 1]);              \
+    __m128i T = _mm_loadu_si128((const __m128i*)&upper[i]);                   \
+    __m128i TR = _mm_loadu_si128((const __m128i*)&upper[i + 1]);              \
+    __m128i src = _mm_loadu_si128((const __m128i*)&in[i]);                    \
+    for (k = 0; k < 4; ++k) {                                                 \
+      L = _mm_add_epi8((PRED), src);                                          \
+      out[i + k] = (uint32_t)_mm_cvtsi128_si32(L);                            \
+      TL = _mm_srli_si128(TL, 4);                                             \
+      T = _mm_srli_si128(T, 4);                                               \
+      TR = _mm_srli_si128(TR, 4);                                             \
+      src = _mm_srli_si128(src, 4);                                           \
+    }                                                                         \
+  }                                                                           \
+  if (i != num_pixels) {                                                      \
+    VP8LPredictorsAdd_C[(X)](in + i, upper + i, num_pixels - i, out + i);     \
+  }                                                                           \
+}
+
+GENERATE_PREDICTOR_ADD_SERIAL(5, Average2_u8_SSE(Average2_u8_SSE(L, TR), T))
+GENERATE_PREDICTOR_ADD_SERIAL(6, Average2_u8_SSE(L, TL))
+GENERATE_PREDICTOR_ADD_SERIAL(7, Average2_u8_SSE(L, T))
+GENERATE_PREDICTOR_ADD_SERIAL(10, Average2_u8_SSE(Average2_u8_SSE(L, TL),
+                                                  Average2_u8_SSE(T, TR)))
+GENERATE_PREDICTOR_ADD_SERIAL(11, Select_SSE(T, L, TL))
+GENERATE_PREDICTOR_ADD_SERIAL(12, ClampedAddSubtractFull_SSE(L, T, TL))
+GENERATE_PREDICTOR_ADD_SERIAL(13, ClampedAddSubtractHalf_SSE(L, T, TL))
+
+#undef GENERATE_PREDICTOR_ADD_SERIAL
+
+//------------------------------------------------------------------------------
+// Subtract-Green and Color Transforms
+
+// Green broadcast to the blue and red bytes of each pixel.
+static WEBP_INLINE __m256i GreenToBlueAndRed_AVX2(const __m256i argb) {
+  const __m256i kShuffle =
+      _mm256_setr_epi8(1, -1, 1, -1, 5, -1, 5, -1, 9, -1, 9, -1, 13, -1, 13, -1,
+                       1, -1, 1, -1, 5, -1, 5, -1, 9, -1, 9, -1, 13, -1, 13, -1);
+  return _mm256_shuffle_epi8(argb, kShuffle);
+}
+
+static void AddGreenToBlueAndRed_AVX2(const uint32_t* src, int num_pixels,
+                                      uint32_t* dst) {
+  int i;
+  for (i = 0; i + 8 <= num_pixels; i += 8) {
+    const __m256i in = _mm256_loadu_si256((const __m256i*)&src[i]);
+    const __m256i out = _mm256_add_epi8(in, GreenToBlueAndRed_AVX2(in));
+    _mm256_storeu_si256((__m256i*)&dst[i], out);
+  }
+  if (i != num_pixels) {
+    VP8LAddGreenToBlueAndRed_C(src + i, num_pixels - i, dst + i);
+  }
+}
+
+// The multipliers are pre-shifted so that _mm256_mulhi_epi16() of a color in
+// the upper byte of a 16-bit lane yields ColorTransformDelta().
+#define CST(X)  (((int16_t)(m->X << 8)) >> 5)   // sign-extend
+#define MK_CST_16(HI, LO) \
+  _mm256_set1_epi32((int)(((uint32_t)(HI) << 16) | ((LO) & 0xffff)))
+
+static WEBP_INLINE __m256i TransformColorInverse8_AVX2(
+    const __m256i in, const __m256i mults_rb, const __m256i mults_b2) {
+  const __m256i mask_ag = _mm256_set1_epi32((int)0xff00ff00);
+  const __m256i A = _mm256_and_si256(in, mask_ag);      // a 0 g 0
+  const __m256i B = _mm256_shufflelo_epi16(A, _MM_SHUFFLE(2, 2, 0, 0));
+  const __m256i C = _mm256_shufflehi_epi16(B, _MM_SHUFFLE(2, 2, 0, 0));  // g0g0
+  const __m256i D = _mm256_mulhi_epi16(C, mults_rb);    // x dr  x db1
+  const __m256i E = _mm256_add_epi8(in, D);             // x r'  x   b'
+  const __m256i F = _mm256_slli_epi16(E, 8);            // r' 0   b' 0
+  const __m256i G = _mm256_mulhi_epi16(F, mults_b2);    // x db2  0  0
+  const __m256i H = _mm256_srli_epi32(G, 8);            // 0  x db2  0
+  const __m256i I = _mm256_add_epi8(H, F);              // r' x  b'' 0
+  const __m256i J = _mm256_srli_epi16(I, 8);            // 0  r'  0  b''
+  return _mm256_or_si256(J, A);
+}
+
+static void TransformColorInverse_AVX2(const VP8LMultipliers* const m,
+                                       const uint32_t* const src,
+                                       int num_pixels, uint32_t* dst) {
+  const __m256i mults_rb = MK_CST_16(CST(green_to_red_), CST(green_to_blue_));
+  const __m256i mults_b2 = MK_CST_16(CST(red_to_blue_), 0);
+  int i;
+  for (i = 0; i + 8 <= num_pixels; i += 8) {
+    const __m256i in = _mm256_loadu_si256((const __m256i*)&src[i]);
+    _mm256_storeu_si256((__m256i*)&dst[i],
+                        TransformColorInverse8_AVX2(in, mults_rb, mults_b2));
+  }
+  if (i != num_pixels) {
+    VP8LTransformColorInverse_C(m, src + i, num_pixels - i, dst + i);
+  }
+}
+
+static void TransformColorInverseAddGreen_AVX2(const VP8LMultipliers* const m,
+                                               const uint32_t* const src,
+                                               int num_pixels, uint32_t* dst) {
+  const __m256i mults_rb = MK_CST_16(CST(green_to_red_), CST(green_to_blue_));
+  const __m256i mults_b2 = MK_CST_16(CST(red_to_blue_), 0);
+  int i;
+  for (i = 0; i + 8 <= num_pixels; i += 8) {
+    const __m256i in = _mm256_loadu_si256((const __m256i*)&src[i]);
+    const __m256i out = TransformColorInverse8_AVX2(in, mults_rb, mults_b2);
+    _mm256_storeu_si256((__m256i*)&dst[i],
+                        _mm256_add_epi8(out, GreenToBlueAndRed_AVX2(in)));
+  }
+  if (i != num_pixels) {
+    VP8LTransformColorInverseAddGreen_C(m, src + i, num_pixels - i, dst + i);
+  }
+}
+
+#undef MK_CST_16
+#undef CST
+
+//------------------------------------------------------------------------------
+// Entry point
+
+extern void VP8LDspInitAVX2(void);
+
+WEBP_TSAN_IGNORE_FUNCTION void VP8LDspInitAVX2(void) {
+  VP8LPredictorsAdd[0] = PredictorAdd0_AVX2;
+  VP8LPredictorsAdd[1] = PredictorAdd1_AVX2;
+  VP8LPredictorsAdd[2] = PredictorAdd2_AVX2;
+  VP8LPredictorsAdd[3] = PredictorAdd3_AVX2;
+  VP8LPredictorsAdd[4] = PredictorAdd4_AVX2;
+  VP8LPredictorsAdd[5] = PredictorAdd5_AVX2;
+  VP8LPredictorsAdd[6] = PredictorAdd6_AVX2;
+  VP8LPredictorsAdd[7] = PredictorAdd7_AVX2;
+  VP8LPredictorsAdd[8] = PredictorAdd8_AVX2;
+  VP8LPredictorsAdd[9] = PredictorAdd9_AVX2;
+  VP8LPredictorsAdd[10] = PredictorAdd10_AVX2;
+  VP8LPredictorsAdd[11] = PredictorAdd11_AVX2;
+  VP8LPredictorsAdd[12] = PredictorAdd12_AVX2;
+  VP8LPredictorsAdd[13] = PredictorAdd13_AVX2;
+
+  VP8LAddGreenToBlueAndRed = AddGreenToBlueAndRed_AVX2;
+  VP8LTransformColorInverse = TransformColorInverse_AVX2;
+  VP8LTransformColorInverseAddGreen = TransformColorInverseAddGreen_AVX2;
+}
+
+#else  // !WEBP_USE_AVX2
+
+WEBP_DSP_INIT_STUB(VP8LDspInitAVX2)
+
+#endif  // WEBP_USE_AVX2
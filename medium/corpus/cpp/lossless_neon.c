@@ -0,0 +1,73 @@
+// Copyright 2026 Google Inc. All Rights Reserved.
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the COPYING file in the root of the source
+// tree. An additional intellectual property rights grant can be found
+// in the file PATENTS. All contributing project authors may
+// be found in the AUTHORS file in the root of the source tree.
+// -----------------------------------------------------------------------------
+//
+// NEON variant of methods for lossless decoder
+
+#include "src/dsp/dsp.h"
+
+#if defined(WEBP_USE_NEON)
+
+#include <arm_neon.h>
+
+#include "src/dsp/lossless.h"
+#include "src/dsp/neon.h"
+
+//------------------------------------------------------------------------------
+// Color Transform
+
+// ColorTransformDelta() of 8 lanes.
+static WEBP_INLINE int8x8_t ColorDelta_NEON(const int8x8_t pred,
+                                            const int8x8_t color) {
+  return vshrn_n_s16(vmull_s8(pred, color), 5);
+}
+
+static void TransformColorInverseAddGreen_NEON(const VP8LMultipliers* const m,
+                                               const uint32_t* const src,
+                                               int num_pixels, uint32_t* dst) {
+  const int8x8_t g2r = vdup_n_s8((int8_t)m->green_to_red_);
+  const int8x8_t g2b = vdup_n_s8((int8_t)m->green_to_blue_);
+  const int8x8_t r2b = vdup_n_s8((int8_t)m->red_to_blue_);
+  int i;
+  for (i = 0; i + 16 <= num_pixels; i += 16) {
+    uint8x16x4_t p = vld4q_u8((const uint8_t*)&src[i]);   // b, g, r, a
+    const int8x16_t g = vreinterpretq_s8_u8(p.val[1]);
+    const int8x16_t dr =
+        vcombine_s8(ColorDelta_NEON(g2r, vget_low_s8(g)),
+                    ColorDelta_NEON(g2r, vget_high_s8(g)));
+    const uint8x16_t r = vaddq_u8(p.val[2], vreinterpretq_u8_s8(dr));
+    const int8x16_t rs = vreinterpretq_s8_u8(r);
+    const int8x16_t db =
+        vaddq_s8(vcombine_s8(ColorDelta_NEON(g2b, vget_low_s8(g)),
+                             ColorDelta_NEON(g2b, vget_high_s8(g))),
+                 vcombine_s8(ColorDelta_NEON(r2b, vget_low_s8(rs)),
+                             ColorDelta_NEON(r2b, vget_high_s8(rs))));
+    const uint8x16_t b = vaddq_u8(p.val[0], vreinterpretq_u8_s8(db));
+    p.val[0] = vaddq_u8(b, p.val[1]);
+    p.val[2] = vaddq_u8(r, p.val[1]);
+    vst4q_u8((uint8_t*)&dst[i], p);
+  }
+  if (i != num_pixels) {
+    VP8LTransformColorInverseAddGreen_C(m, src + i, num_pixels - i, dst + i);
+  }
+}
+
+//------------------------------------------------------------------------------
+// Entry point
+
+extern void VP8LDspInitNEON(void);
+
+WEBP_TSAN_IGNORE_FUNCTION void VP8LDspInitNEON(void) {
+  VP8LTransformColorInverseAddGreen = TransformColorInverseAddGreen_NEON;
+}
+
+#else  // !WEBP_USE_NEON
+
+WEBP_DSP_INIT_STUB(VP8LDspInitNEON)
+
+#endif  // WEBP_USE_NEON
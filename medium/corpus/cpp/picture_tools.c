@@ -0,0 +1,175 @@
+// Copyright 2026 Google Inc. All Rights Reserved.
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the COPYING file in the root of the source
+// tree. An additional intellectual property rights grant can be found
+// in the file PATENTS. All contributing project authors may
+// be found in the AUTHORS file in the root of the source tree.
+// -----------------------------------------------------------------------------
+//
+// Transparent-area cleanup and alpha blending kernels for WebPPicture.
+
+#include "src/dsp/dsp.h"
+
+#include <assert.h>
+
+//------------------------------------------------------------------------------
+// Transparent-area cleanup
+
+int WebPIsTransparentARGBArea_C(const uint32_t* ptr, int stride, int size) {
+  int y, x;
+  for (y = 0; y < size; ++y) {
+    for (x = 0; x < size; ++x) {
+      if (ptr[x] & 0xff000000u) return 0;
+    }
+    ptr += stride;
+  }
+  return 1;
+}
+
+void WebPFlattenARGB_C(uint32_t* ptr, uint32_t v, int stride, int size) {
+  int x, y;
+  for (y = 0; y < size; ++y) {
+    for (x = 0; x < size; ++x) ptr[x] = v;
+    ptr += stride;
+  }
+}
+
+// Smoothen the luma components of transparent pixels. Return true if the whole
+// block is transparent.
+int WebPSmoothenBlock_C(const uint8_t* a_ptr, int a_stride, uint8_t* y_ptr,
+                        int y_stride, int width, int height) {
+  int sum = 0, count = 0;
+  int x, y;
+  const uint8_t* alpha_ptr = a_ptr;
+  uint8_t* luma_ptr = y_ptr;
+  for (y = 0; y < height; ++y) {
+    for (x = 0; x < width; ++x) {
+      if (alpha_ptr[x] != 0) {
+        ++count;
+        sum += luma_ptr[x];
+      }
+    }
+    alpha_ptr += a_stride;
+    luma_ptr += y_stride;
+  }
+  if (count > 0 && count < width * height) {
+    const uint8_t avg_u8 = (uint8_t)(sum / count);
+    alpha_ptr = a_ptr;
+    luma_ptr = y_ptr;
+    for (y = 0; y < height; ++y) {
+      for (x = 0; x < width; ++x) {
+        if (alpha_ptr[x] == 0) luma_ptr[x] = avg_u8;
+      }
+      alpha_ptr += a_stride;
+      luma_ptr += y_stride;
+    }
+  }
+  return (count == 0);
+}
+
+//------------------------------------------------------------------------------
+// Alpha blending
+
+#define BLEND(V0, V1, ALPHA) \
+    ((((V0) * (255 - (ALPHA)) + (V1) * (ALPHA)) * 0x101 + 256) >> 16)
+#define BLEND_10BIT(V0, V1, ALPHA) \
+    ((((V0) * (1020 - (ALPHA)) + (V1) * (ALPHA)) * 0x101 + 1024) >> 18)
+
+void WebPBlendARGBRow_C(uint32_t* argb, int width, uint32_t background) {
+  const int red = (background >> 16) & 0xff;
+  const int green = (background >> 8) & 0xff;
+  const int blue = (background >> 0) & 0xff;
+  int x;
+  for (x = 0; x < width; ++x) {
+    const int alpha = (argb[x] >> 24) & 0xff;
+    if (alpha != 0xff) {
+      if (alpha > 0) {
+        int r = (argb[x] >> 16) & 0xff;
+        int g = (argb[x] >>  8) & 0xff;
+        int b = (argb[x] >>  0) & 0xff;
+        r = BLEND(red, r, alpha);
+        g = BLEND(green, g, alpha);
+        b = BLEND(blue, b, alpha);
+        argb[x] = 0xff000000u | (r << 16) | (g << 8) | b;
+      } else {
+        argb[x] = background;
+      }
+    }
+  }
+}
+
+void WebPBlendLumaRow_C(uint8_t* y_ptr, const uint8_t* a_ptr, int width,
+                        int Y0) {
+  int x;
+  for (x = 0; x < width; ++x) {
+    const uint8_t alpha = a_ptr[x];
+    if (alpha < 0xff) {
+      y_ptr[x] = BLEND(Y0, y_ptr[x], alpha);
+    }
+  }
+}
+
+// Blends 'uv_width' samples of one chroma row, with the alpha of the two
+// luma rows 'a_ptr' and 'a_ptr2' averaged over each 2x2 block.
+void WebPBlendChromaRow_C(uint8_t* u_ptr, uint8_t* v_ptr,
+                          const uint8_t* a_ptr, const uint8_t* a_ptr2,
+                          int uv_width, int U0, int V0) {
+  int x;
+  for (x = 0; x < uv_width; ++x) {
+    // Average four alpha values into a single blending weight.
+    // TODO(skal): might lead to visible contouring. Can we do better?
+    const uint32_t alpha =
+        a_ptr[2 * x + 0] + a_ptr[2 * x + 1] +
+        a_ptr2[2 * x + 0] + a_ptr2[2 * x + 1];
+    u_ptr[x] = BLEND_10BIT(U0, u_ptr[x], alpha);
+    v_ptr[x] = BLEND_10BIT(V0, v_ptr[x], alpha);
+  }
+}
+
+#undef BLEND
+#undef BLEND_10BIT
+
+//------------------------------------------------------------------------------
+// Init function
+
+WebPIsTransparentARGBAreaFunc WebPIsTransparentARGBArea;
+WebPFlattenARGBFunc WebPFlattenARGB;
+WebPSmoothenBlockFunc WebPSmoothenBlock;
+WebPBlendARGBRowFunc WebPBlendARGBRow;
+WebPBlendLumaRowFunc WebPBlendLumaRow;
+WebPBlendChromaRowFunc WebPBlendChromaRow;
+
+extern VP8CPUInfo VP8GetCPUInfo;
+extern void WebPInitPictureToolsSSE2(void);
+extern void WebPInitPictureToolsAVX2(void);
+
+WEBP_DSP_INIT_FUNC(WebPInitPictureTools) {
+  WebPIsTransparentARGBArea = WebPIsTransparentARGBArea_C;
+  WebPFlattenARGB = WebPFlattenARGB_C;
+  WebPSmoothenBlock = WebPSmoothenBlock_C;
+  WebPBlendARGBRow = WebPBlendARGBRow_C;
+  WebPBlendLumaRow = WebPBlendLumaRow_C;
+  WebPBlendChromaRow = WebPBlendChromaRow_C;
+
+  // If defined, use CPUInfo() to overwrite some pointers with faster versions.
+  if (VP8GetCPUInfo != NULL) {
+#if defined(WEBP_HAVE_SSE2)
+    if (VP8GetCPUInfo(kSSE2)) {
+      WebPInitPictureToolsSSE2();
+#if defined(WEBP_HAVE_AVX2)
+      if (VP8GetCPUInfo(kAVX2)) {
+        WebPInitPictureToolsAVX2();
+      }
+#endif
+    }
+#endif
+  }
+
+  assert(WebPIsTransparentARGBArea != NULL);
+  assert(WebPFlattenARGB != NULL);
+  assert(WebPSmoothenBlock != NULL);
+  assert(WebPBlendARGBRow != NULL);
+  assert(WebPBlendLumaRow != NULL);
+  assert(WebPBlendChromaRow != NULL);
+}
@@ -0,0 +1,189 @@
+// Copyright 2026 Google Inc. All Rights Reserved.
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the COPYING file in the root of the source
+// tree. An additional intellectual property rights grant can be found
+// in the file PATENTS. All contributing project authors may
+// be found in the AUTHORS file in the root of the source tree.
+// -----------------------------------------------------------------------------
+//
+// AVX2 variant of picture tools
+
+#include "src/dsp/dsp.h"
+
+#if defined(WEBP_USE_AVX2)
+
+#include <immintrin.h>
+
+//------------------------------------------------------------------------------
+// Transparent-area cleanup. An 8x8 ARGB block row fits one register.
+// SmoothenBlock() works on 8-byte rows and keeps the SSE2 version.
+
+static int IsTransparentARGBArea_AVX2(const uint32_t* ptr, int stride,
+                                      int size) {
+  const __m256i zero = _mm256_setzero_si256();
+  __m256i acc = zero;
+  int y;
+  if (size != 8) return WebPIsTransparentARGBArea_C(ptr, stride, size);
+  for (y = 0; y < 8; ++y) {
+    acc = _mm256_or_si256(acc, _mm256_loadu_si256((const __m256i*)ptr));
+    ptr += stride;
+  }
+  acc = _mm256_srli_epi32(acc, 24);   // keep the alpha bytes
+  return (_mm256_movemask_epi8(_mm256_cmpeq_epi32(acc, zero)) == -1);
+}
+
+static void FlattenARGB_AVX2(uint32_t* ptr, uint32_t v, int stride, int size) {
+  const __m256i V = _mm256_set1_epi32((int)v);
+  int y;
+  if (size != 8) {
+    WebPFlattenARGB_C(ptr, v, stride, size);
+    return;
+  }
+  for (y = 0; y < 8; ++y) {
+    _mm256_storeu_si256((__m256i*)ptr, V);
+    ptr += stride;
+  }
+}
+
+//------------------------------------------------------------------------------
+// Alpha blending. The unpack/pack pairs stay within each 128-bit lane, so
+// the samples come back in order; see the SSE2 file for the BLEND rounding.
+
+static void BlendARGBRow_AVX2(uint32_t* argb, int width, uint32_t background) {
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i amask = _mm256_set1_epi32((int)0xff000000u);
+  const __m256i bg =
+      _mm256_unpacklo_epi8(_mm256_set1_epi32((int)background), zero);
+  const __m256i k255 = _mm256_set1_epi16(255);
+  const __m256i one = _mm256_set1_epi16(1);
+  const __m256i k0101 = _mm256_set1_epi16(0x101);
+  int x;
+  for (x = 0; x + 8 <= width; x += 8) {
+    const __m256i p = _mm256_loadu_si256((const __m256i*)&argb[x]);
+    const __m256i opaque =
+        _mm256_cmpeq_epi32(_mm256_and_si256(p, amask), amask);
+    if (_mm256_movemask_epi8(opaque) != -1) {
+      const __m256i p_lo = _mm256_unpacklo_epi8(p, zero);
+      const __m256i p_hi = _mm256_unpackhi_epi8(p, zero);
+      const __m256i a_lo = _mm256_shufflehi_epi16(
+          _mm256_shufflelo_epi16(p_lo, _MM_SHUFFLE(3, 3, 3, 3)),
+          _MM_SHUFFLE(3, 3, 3, 3));
+      const __m256i a_hi = _mm256_shufflehi_epi16(
+          _mm256_shufflelo_epi16(p_hi, _MM_SHUFFLE(3, 3, 3, 3)),
+          _MM_SHUFFLE(3, 3, 3, 3));
+      const __m256i x_lo =
+          _mm256_add_epi16(_mm256_mullo_epi16(bg, _mm256_sub_epi16(k255, a_lo)),
+                           _mm256_mullo_epi16(p_lo, a_lo));
+      const __m256i x_hi =
+          _mm256_add_epi16(_mm256_mullo_epi16(bg, _mm256_sub_epi16(k255, a_hi)),
+                           _mm256_mullo_epi16(p_hi, a_hi));
+      const __m256i r_lo =
+          _mm256_mulhi_epu16(_mm256_add_epi16(x_lo, one), k0101);
+      const __m256i r_hi =
+          _mm256_mulhi_epu16(_mm256_add_epi16(x_hi, one), k0101);
+      _mm256_storeu_si256((__m256i*)&argb[x],
+                          _mm256_or_si256(_mm256_packus_epi16(r_lo, r_hi),
+                                          amask));
+    }
+  }
+  if (x < width) WebPBlendARGBRow_C(argb + x, width - x, background);
+}
+
+static void BlendLumaRow_AVX2(uint8_t* y_ptr, const uint8_t* a_ptr, int width,
+                              int Y0) {
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i y0 = _mm256_set1_epi16(Y0);
+  const __m256i k255 = _mm256_set1_epi16(255);
+  const __m256i one = _mm256_set1_epi16(1);
+  const __m256i k0101 = _mm256_set1_epi16(0x101);
+  int x;
+  for (x = 0; x + 32 <= width; x += 32) {
+    const __m256i A = _mm256_loadu_si256((const __m256i*)&a_ptr[x]);
+    const __m256i Y = _mm256_loadu_si256((const __m256i*)&y_ptr[x]);
+    const __m256i a_lo = _mm256_unpacklo_epi8(A, zero);
+    const __m256i a_hi = _mm256_unpackhi_epi8(A, zero);
+    const __m256i x_lo =
+        _mm256_add_epi16(_mm256_mullo_epi16(y0, _mm256_sub_epi16(k255, a_lo)),
+                         _mm256_mullo_epi16(_mm256_unpacklo_epi8(Y, zero),
+                                            a_lo));
+    const __m256i x_hi =
+        _mm256_add_epi16(_mm256_mullo_epi16(y0, _mm256_sub_epi16(k255, a_hi)),
+                         _mm256_mullo_epi16(_mm256_unpackhi_epi8(Y, zero),
+                                            a_hi));
+    const __m256i r_lo = _mm256_mulhi_epu16(_mm256_add_epi16(x_lo, one), k0101);
+    const __m256i r_hi = _mm256_mulhi_epu16(_mm256_add_epi16(x_hi, one), k0101);
+    _mm256_storeu_si256((__m256i*)&y_ptr[x], _mm256_packus_epi16(r_lo, r_hi));
+  }
+  if (x < width) WebPBlendLumaRow_C(y_ptr + x, a_ptr + x, width - x, Y0);
+}
+
+static void BlendChromaRow_AVX2(uint8_t* u_ptr, uint8_t* v_ptr,
+                                const uint8_t* a_ptr, const uint8_t* a_ptr2,
+                                int uv_width, int U0, int V0) {
+  const __m256i mask_lo = _mm256_set1_epi16(0xff);
+  const __m256i k1020 = _mm256_set1_epi16(1020);
+  const __m256i round = _mm256_set1_epi32(1024);
+  const __m256i u0 = _mm256_set1_epi16(U0);
+  const __m256i v0 = _mm256_set1_epi16(V0);
+  int x;
+  for (x = 0; x + 16 <= uv_width; x += 16) {
+    const __m256i A1 = _mm256_loadu_si256((const __m256i*)&a_ptr[2 * x]);
+    const __m256i A2 = _mm256_loadu_si256((const __m256i*)&a_ptr2[2 * x]);
+    // sum of the four alpha values of each 2x2 block, in sample order
+    const __m256i alpha =
+        _mm256_add_epi16(_mm256_add_epi16(_mm256_and_si256(A1, mask_lo),
+                                          _mm256_srli_epi16(A1, 8)),
+                         _mm256_add_epi16(_mm256_and_si256(A2, mask_lo),
+                                          _mm256_srli_epi16(A2, 8)));
+    const __m256i w_lo =
+        _mm256_unpacklo_epi16(_mm256_sub_epi16(k1020, alpha), alpha);
+    const __m256i w_hi =
+        _mm256_unpackhi_epi16(_mm256_sub_epi16(k1020, alpha), alpha);
+    int k;
+    for (k = 0; k < 2; ++k) {
+      uint8_t* const dst = (k == 0) ? u_ptr + x : v_ptr + x;
+      const __m256i c0 = (k == 0) ? u0 : v0;
+      const __m256i C =
+          _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)dst));
+      const __m256i s_lo =
+          _mm256_madd_epi16(_mm256_unpacklo_epi16(c0, C), w_lo);
+      const __m256i s_hi =
+          _mm256_madd_epi16(_mm256_unpackhi_epi16(c0, C), w_hi);
+      const __m256i t_lo = _mm256_srli_epi32(
+          _mm256_add_epi32(_mm256_add_epi32(s_lo, _mm256_slli_epi32(s_lo, 8)),
+                           round), 18);
+      const __m256i t_hi = _mm256_srli_epi32(
+          _mm256_add_epi32(_mm256_add_epi32(s_hi, _mm256_slli_epi32(s_hi, 8)),
+                           round), 18);
+      const __m256i out = _mm256_packs_epi32(t_lo, t_hi);
+      // each lane holds its 8 samples twice: gather the two low quadwords
+      const __m256i out8 = _mm256_permute4x64_epi64(
+          _mm256_packus_epi16(out, out), _MM_SHUFFLE(3, 1, 2, 0));
+      _mm_storeu_si128((__m128i*)dst, _mm256_castsi256_si128(out8));
+    }
+  }
+  if (x < uv_width) {
+    WebPBlendChromaRow_C(u_ptr + x, v_ptr + x, a_ptr + 2 * x, a_ptr2 + 2 * x,
+                         uv_width - x, U0, V0);
+  }
+}
+
+//------------------------------------------------------------------------------
+// Entry point
+
+extern void WebPInitPictureToolsAVX2(void);
+
+WEBP_TSAN_IGNORE_FUNCTION void WebPInitPictureToolsAVX2(void) {
+  WebPIsTransparentARGBArea = IsTransparentARGBArea_AVX2;
+  WebPFlattenARGB = FlattenARGB_AVX2;
+  WebPBlendARGBRow = BlendARGBRow_AVX2;
+  WebPBlendLumaRow = BlendLumaRow_AVX2;
+  WebPBlendChromaRow = BlendChromaRow_AVX2;
+}
+
+#else  // !WEBP_USE_AVX2
+
+WEBP_DSP_INIT_STUB(WebPInitPictureToolsAVX2)
+
+#endif  // WEBP_USE_AVX2
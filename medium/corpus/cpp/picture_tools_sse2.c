@@ -0,0 +1,231 @@
+// Copyright 2026 Google Inc. All Rights Reserved.
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the COPYING file in the root of the source
+// tree. An additional intellectual property rights grant can be found
+// in the file PATENTS. All contributing project authors may
+// be found in the AUTHORS file in the root of the source tree.
+// -----------------------------------------------------------------------------
+//
+// SSE2 variant of picture tools
+
+#include "src/dsp/dsp.h"
+
+#if defined(WEBP_USE_SSE2)
+
+#include <emmintrin.h>
+
+//------------------------------------------------------------------------------
+// Transparent-area cleanup. Only the 8x8 blocks are vectorized.
+
+static int IsTransparentARGBArea_SSE2(const uint32_t* ptr, int stride,
+                                      int size) {
+  const __m128i zero = _mm_setzero_si128();
+  __m128i acc = zero;
+  int y;
+  if (size != 8) return WebPIsTransparentARGBArea_C(ptr, stride, size);
+  for (y = 0; y < 8; ++y) {
+    const __m128i A = _mm_loadu_si128((const __m128i*)(ptr + 0));
+    const __m128i B = _mm_loadu_si128((const __m128i*)(ptr + 4));
+    acc = _mm_or_si128(acc, _mm_or_si128(A, B));
+    ptr += stride;
+  }
+  acc = _mm_srli_epi32(acc, 24);   // keep the alpha bytes
+  return (_mm_movemask_epi8(_mm_cmpeq_epi32(acc, zero)) == 0xffff);
+}
+
+static void FlattenARGB_SSE2(uint32_t* ptr, uint32_t v, int stride, int size) {
+  const __m128i V = _mm_set1_epi32((int)v);
+  int y;
+  if (size != 8) {
+    WebPFlattenARGB_C(ptr, v, stride, size);
+    return;
+  }
+  for (y = 0; y < 8; ++y) {
+    _mm_storeu_si128((__m128i*)(ptr + 0), V);
+    _mm_storeu_si128((__m128i*)(ptr + 4), V);
+    ptr += stride;
+  }
+}
+
+static int SmoothenBlock_SSE2(const uint8_t* a_ptr, int a_stride,
+                              uint8_t* y_ptr, int y_stride,
+                              int width, int height) {
+  // Transparent pixels are masked out of the luma sum, and counted with the
+  // same SAD against zero.
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i one = _mm_set1_epi8(1);
+  __m128i sum_v = zero, transparent_v = zero;
+  const uint8_t* alpha_ptr = a_ptr;
+  uint8_t* luma_ptr = y_ptr;
+  int sum, count;
+  int y;
+  if (width != 8) {
+    return WebPSmoothenBlock_C(a_ptr, a_stride, y_ptr, y_stride,
+                               width, height);
+  }
+  for (y = 0; y < height; ++y) {
+    const __m128i A = _mm_loadl_epi64((const __m128i*)alpha_ptr);
+    const __m128i L = _mm_loadl_epi64((const __m128i*)luma_ptr);
+    const __m128i T = _mm_cmpeq_epi8(A, zero);
+    sum_v = _mm_add_epi64(sum_v, _mm_sad_epu8(_mm_andnot_si128(T, L), zero));
+    transparent_v = _mm_add_epi64(transparent_v,
+                                  _mm_sad_epu8(_mm_and_si128(T, one), zero));
+    alpha_ptr += a_stride;
+    luma_ptr += y_stride;
+  }
+  sum = _mm_cvtsi128_si32(sum_v);
+  count = width * height - _mm_cvtsi128_si32(transparent_v);
+  if (count > 0 && count < width * height) {
+    const __m128i avg = _mm_set1_epi8((char)(uint8_t)(sum / count));
+    alpha_ptr = a_ptr;
+    luma_ptr = y_ptr;
+    for (y = 0; y < height; ++y) {
+      const __m128i A = _mm_loadl_epi64((const __m128i*)alpha_ptr);
+      const __m128i L = _mm_loadl_epi64((const __m128i*)luma_ptr);
+      const __m128i T = _mm_cmpeq_epi8(A, zero);
+      const __m128i out =
+          _mm_or_si128(_mm_and_si128(T, avg), _mm_andnot_si128(T, L));
+      _mm_storel_epi64((__m128i*)luma_ptr, out);
+      alpha_ptr += a_stride;
+      luma_ptr += y_stride;
+    }
+  }
+  return (count == 0);
+}
+
+//------------------------------------------------------------------------------
+// Alpha blending
+
+// Note: BLEND(V0, V1, ALPHA) == (x * 0x101 + 256) >> 16 with x < 65026, which
+// is also ((x + 1) * 0x101) >> 16 since 0x101 * (x + 1) is never a multiple
+// of 65536: this fits the unsigned 16-bit high multiply.
+
+static void BlendARGBRow_SSE2(uint32_t* argb, int width, uint32_t background) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i amask = _mm_set1_epi32((int)0xff000000u);
+  const __m128i bg = _mm_unpacklo_epi8(_mm_set1_epi32((int)background), zero);
+  const __m128i k255 = _mm_set1_epi16(255);
+  const __m128i one = _mm_set1_epi16(1);
+  const __m128i k0101 = _mm_set1_epi16(0x101);
+  int x;
+  for (x = 0; x + 4 <= width; x += 4) {
+    const __m128i p = _mm_loadu_si128((const __m128i*)&argb[x]);
+    if (_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(p, amask), amask))
+        != 0xffff) {
+      const __m128i p_lo = _mm_unpacklo_epi8(p, zero);
+      const __m128i p_hi = _mm_unpackhi_epi8(p, zero);
+      const __m128i a_lo = _mm_shufflehi_epi16(
+          _mm_shufflelo_epi16(p_lo, _MM_SHUFFLE(3, 3, 3, 3)),
+          _MM_SHUFFLE(3, 3, 3, 3));
+      const __m128i a_hi = _mm_shufflehi_epi16(
+          _mm_shufflelo_epi16(p_hi, _MM_SHUFFLE(3, 3, 3, 3)),
+          _MM_SHUFFLE(3, 3, 3, 3));
+      const __m128i x_lo =
+          _mm_add_epi16(_mm_mullo_epi16(bg, _mm_sub_epi16(k255, a_lo)),
+                        _mm_mullo_epi16(p_lo, a_lo));
+      const __m128i x_hi =
+          _mm_add_epi16(_mm_mullo_epi16(bg, _mm_sub_epi16(k255, a_hi)),
+                        _mm_mullo_epi16(p_hi, a_hi));
+      const __m128i r_lo = _mm_mulhi_epu16(_mm_add_epi16(x_lo, one), k0101);
+      const __m128i r_hi = _mm_mulhi_epu16(_mm_add_epi16(x_hi, one), k0101);
+      _mm_storeu_si128((__m128i*)&argb[x],
+                       _mm_or_si128(_mm_packus_epi16(r_lo, r_hi), amask));
+    }
+  }
+  if (x < width) WebPBlendARGBRow_C(argb + x, width - x, background);
+}
+
+static void BlendLumaRow_SSE2(uint8_t* y_ptr, const uint8_t* a_ptr, int width,
+                              int Y0) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i y0 = _mm_set1_epi16(Y0);
+  const __m128i k255 = _mm_set1_epi16(255);
+  const __m128i one = _mm_set1_epi16(1);
+  const __m128i k0101 = _mm_set1_epi16(0x101);
+  int x;
+  for (x = 0; x + 16 <= width; x += 16) {
+    const __m128i A = _mm_loadu_si128((const __m128i*)&a_ptr[x]);
+    const __m128i Y = _mm_loadu_si128((const __m128i*)&y_ptr[x]);
+    const __m128i a_lo = _mm_unpacklo_epi8(A, zero);
+    const __m128i a_hi = _mm_unpackhi_epi8(A, zero);
+    const __m128i x_lo =
+        _mm_add_epi16(_mm_mullo_epi16(y0, _mm_sub_epi16(k255, a_lo)),
+                      _mm_mullo_epi16(_mm_unpacklo_epi8(Y, zero), a_lo));
+    const __m128i x_hi =
+        _mm_add_epi16(_mm_mullo_epi16(y0, _mm_sub_epi16(k255, a_hi)),
+                      _mm_mullo_epi16(_mm_unpackhi_epi8(Y, zero), a_hi));
+    const __m128i r_lo = _mm_mulhi_epu16(_mm_add_epi16(x_lo, one), k0101);
+    const __m128i r_hi = _mm_mulhi_epu16(_mm_add_epi16(x_hi, one), k0101);
+    _mm_storeu_si128((__m128i*)&y_ptr[x], _mm_packus_epi16(r_lo, r_hi));
+  }
+  if (x < width) WebPBlendLumaRow_C(y_ptr + x, a_ptr + x, width - x, Y0);
+}
+
+static void BlendChromaRow_SSE2(uint8_t* u_ptr, uint8_t* v_ptr,
+                                const uint8_t* a_ptr, const uint8_t* a_ptr2,
+                                int uv_width, int U0, int V0) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i mask_lo = _mm_set1_epi16(0xff);
+  const __m128i k1020 = _mm_set1_epi16(1020);
+  const __m128i round = _mm_set1_epi32(1024);
+  const __m128i u0 = _mm_set1_epi16(U0);
+  const __m128i v0 = _mm_set1_epi16(V0);
+  int x;
+  for (x = 0; x + 8 <= uv_width; x += 8) {
+    const __m128i A1 = _mm_loadu_si128((const __m128i*)&a_ptr[2 * x]);
+    const __m128i A2 = _mm_loadu_si128((const __m128i*)&a_ptr2[2 * x]);
+    // sum of the four alpha values of each 2x2 block
+    const __m128i alpha =
+        _mm_add_epi16(_mm_add_epi16(_mm_and_si128(A1, mask_lo),
+                                    _mm_srli_epi16(A1, 8)),
+                      _mm_add_epi16(_mm_and_si128(A2, mask_lo),
+                                    _mm_srli_epi16(A2, 8)));
+    const __m128i w_lo = _mm_unpacklo_epi16(_mm_sub_epi16(k1020, alpha),
+                                            alpha);
+    const __m128i w_hi = _mm_unpackhi_epi16(_mm_sub_epi16(k1020, alpha),
+                                            alpha);
+    int k;
+    for (k = 0; k < 2; ++k) {
+      uint8_t* const dst = (k == 0) ? u_ptr + x : v_ptr + x;
+      const __m128i c0 = (k == 0) ? u0 : v0;
+      const __m128i C = _mm_unpacklo_epi8(
+          _mm_loadl_epi64((const __m128i*)dst), zero);
+      // (c0 * (1020 - alpha) + c * alpha) * 0x101 + 1024) >> 18
+      const __m128i s_lo = _mm_madd_epi16(_mm_unpacklo_epi16(c0, C), w_lo);
+      const __m128i s_hi = _mm_madd_epi16(_mm_unpackhi_epi16(c0, C), w_hi);
+      const __m128i t_lo = _mm_srli_epi32(
+          _mm_add_epi32(_mm_add_epi32(s_lo, _mm_slli_epi32(s_lo, 8)), round),
+          18);
+      const __m128i t_hi = _mm_srli_epi32(
+          _mm_add_epi32(_mm_add_epi32(s_hi, _mm_slli_epi32(s_hi, 8)), round),
+          18);
+      const __m128i out = _mm_packs_epi32(t_lo, t_hi);
+      _mm_storel_epi64((__m128i*)dst, _mm_packus_epi16(out, out));
+    }
+  }
+  if (x < uv_width) {
+    WebPBlendChromaRow_C(u_ptr + x, v_ptr + x, a_ptr + 2 * x, a_ptr2 + 2 * x,
+                         uv_width - x, U0, V0);
+  }
+}
+
+//------------------------------------------------------------------------------
+// Entry point
+
+extern void WebPInitPictureToolsSSE2(void);
+
+WEBP_TSAN_IGNORE_FUNCTION void WebPInitPictureToolsSSE2(void) {
+  WebPIsTransparentARGBArea = IsTransparentARGBArea_SSE2;
+  WebPFlattenARGB = FlattenARGB_SSE2;
+  WebPSmoothenBlock = SmoothenBlock_SSE2;
+  WebPBlendARGBRow = BlendARGBRow_SSE2;
+  WebPBlendLumaRow = BlendLumaRow_SSE2;
+  WebPBlendChromaRow = BlendChromaRow_SSE2;
+}
+
+#else  // !WEBP_USE_SSE2
+
+WEBP_DSP_INIT_STUB(WebPInitPictureToolsSSE2)
+
+#endif  // WEBP_USE_SSE2
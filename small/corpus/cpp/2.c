@@ -137,6 +137,36 @@ typedef JLONG LOCFSERROR;       /* be sure calculation temps are big enough */
 typedef FSERROR *FSERRPTR;      /* pointer to error array */
 
 
+/* Declarations for the vector ordered-dither paths.
+ *
+ * colorindex[ci] is a step function of the (dithered) input value, so
+ *    colorindex[ci][v] = base + sum( step[k] for each k with v > thresh[k] )
+ * with one threshold per change of representative value.  Evaluated as
+ * compares and masked adds this maps 8 pixels at a time without any table
+ * lookups, and the padding of colorindex for ordered dither falls out for
+ * free: values below 0 match no threshold and values above _MAXJSAMPLE match
+ * all of them.  Components with more than ODITHER_MAX_STEPS steps use the
+ * scalar code.
+ */
+
+#if BITS_IN_JSAMPLE == 8
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define ODITHER_SIMD_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define ODITHER_SIMD_NEON
+#endif
+#endif
+
+#if defined(ODITHER_SIMD_SSE2) || defined(ODITHER_SIMD_NEON)
+#define ODITHER_SIMD
+#endif
+
+#define ODITHER_MAX_STEPS  16   /* max # of thresholds per component */
+
+
 /* Private subobject */
 
 #define MAX_Q_COMPS  4          /* max components I can handle */
@@ -161,6 +191,14 @@ typedef struct {
   int row_index;                /* cur row's vertical index in dither matrix */
   ODITHER_MATRIX_PTR odither[MAX_Q_COMPS]; /* one dither array per component */
 
+#ifdef ODITHER_SIMD
+  /* colorindex[] as thresholds, see above; nsteps[0] < 0 if not usable */
+  int nsteps[MAX_Q_COMPS];
+  INT16 index_base[MAX_Q_COMPS];
+  INT16 thresh[MAX_Q_COMPS][ODITHER_MAX_STEPS];
+  INT16 step[MAX_Q_COMPS][ODITHER_MAX_STEPS];
+#endif
+
   /* Variables for Floyd-Steinberg dithering */
   FSERRPTR fserrors[MAX_Q_COMPS]; /* accumulated errors */
   boolean on_odd_row;           /* flag to remember which row we are on */
@@ -666,6 +704,269 @@ void BlockExtractor::splitLandingPadPreds(Function &F) {
 }
 
 
+METHODDEF(void)
+quantize3_fs_dither(j_decompress_ptr cinfo, _JSAMPARRAY input_buf,
+                    _JSAMPARRAY output_buf, int num_rows)
+/* Fast path for out_color_components==3, with Floyd-Steinberg dithering */
+{
+  /* The three components are dithered in a single sweep instead of one
+   * sweep each.  Their error chains are independent, so the CPU can overlap
+   * them, and each input and output pixel is only touched once.
+   */
+  my_cquantize_ptr cquantize = (my_cquantize_ptr)cinfo->cquantize;
+  LOCFSERROR cur[3];            /* current error or pixel value */
+  LOCFSERROR belowerr[3];       /* error for pixel below cur */
+  LOCFSERROR bpreverr[3];       /* error for below/prev col */
+  LOCFSERROR bnexterr;          /* error for below/next col */
+  LOCFSERROR delta, val;
+  register FSERRPTR errorptr;
+  register _JSAMPROW input_ptr;
+  register _JSAMPROW output_ptr;
+  _JSAMPARRAY colorindex = cquantize->colorindex;
+  _JSAMPARRAY colormap = cquantize->sv_colormap;
+  _JSAMPLE *range_limit = (_JSAMPLE *)cinfo->sample_range_limit;
+  int pixcode, code;
+  int dir;                      /* 1 for left-to-right, -1 for right-to-left */
+  long errpos;                  /* fserrors[] index of column before current */
+  int ci;
+  int row;
+  JDIMENSION col;
+  JDIMENSION width = cinfo->output_width;
+
+  for (row = 0; row < num_rows; row++) {
+    input_ptr = input_buf[row];
+    output_ptr = output_buf[row];
+    if (cquantize->on_odd_row) {
+      /* work right to left in this row */
+      input_ptr += (width - 1) * 3;   /* so point to rightmost pixel */
+      output_ptr += width - 1;
+      dir = -1;
+      errpos = (long)width + 1; /* => entry after last column */
+    } else {
+      /* work left to right in this row */
+      dir = 1;
+      errpos = 0;               /* => entry before first column */
+    }
+    for (ci = 0; ci < 3; ci++)
+      cur[ci] = belowerr[ci] = bpreverr[ci] = 0;
+
+    for (col = width; col > 0; col--) {
+      pixcode = 0;
+      for (ci = 0; ci < 3; ci++) {
+        errorptr = cquantize->fserrors[ci] + errpos;
+        /* See quantize_fs_dither for the derivation of these steps. */
+        val = RIGHT_SHIFT(cur[ci] + errorptr[dir] + 8, 4);
+        val += input_ptr[ci];
+        val = range_limit[val];
+        code = colorindex[ci][val];
+        pixcode += code;
+        val -= colormap[ci][code];
+        bnexterr = val;
+        delta = val * 2;
+        val += delta;           /* form error * 3 */
+        errorptr[0] = (FSERROR)(bpreverr[ci] + val);
+        val += delta;           /* form error * 5 */
+        bpreverr[ci] = belowerr[ci] + val;
+        belowerr[ci] = bnexterr;
+        val += delta;           /* form error * 7 */
+        cur[ci] = val;
+      }
+      *output_ptr = (_JSAMPLE)pixcode;
+      input_ptr += dir * 3;
+      output_ptr += dir;
+      errpos += dir;
+    }
+    /* Post-loop cleanup: we must unload the final error values into the
+     * final fserrors[] entry.  Note we need not unload belowerr because
+     * it is for the dummy column before or after the actual array.
+     */
+    for (ci = 0; ci < 3; ci++)
+      cquantize->fserrors[ci][errpos] = (FSERROR)bpreverr[ci];
+    cquantize->on_odd_row = (cquantize->on_odd_row ? FALSE : TRUE);
+  }
+}
+
+
+#ifdef ODITHER_SIMD
+
+/*
+ * Express colorindex[] as thresholds for the vector ordered-dither path.
+ * nsteps[0] is set to -1 if some component has too many steps.
+ */
+
+LOCAL(void)
+create_odither_thresholds(j_decompress_ptr cinfo)
+{
+  my_cquantize_ptr cquantize = (my_cquantize_ptr)cinfo->cquantize;
+  _JSAMPROW indexptr;
+  int ci, j, n;
+
+  for (ci = 0; ci < cinfo->out_color_components; ci++) {
+    indexptr = cquantize->colorindex[ci];
+    cquantize->index_base[ci] = (INT16)indexptr[0];
+    n = 0;
+    for (j = 0; j < _MAXJSAMPLE; j++) {
+      if (indexptr[j + 1] == indexptr[j])
+        continue;
+      if (n == ODITHER_MAX_STEPS) {
+        cquantize->nsteps[0] = -1;
+        return;
+      }
+      cquantize->thresh[ci][n] = (INT16)j;
+      cquantize->step[ci][n] = (INT16)(indexptr[j + 1] - indexptr[j]);
+      n++;
+    }
+    cquantize->nsteps[ci] = n;
+  }
+}
+
+
+METHODDEF(void)
+quantize_ord_dither_simd(j_decompress_ptr cinfo, _JSAMPARRAY input_buf,
+                         _JSAMPARRAY output_buf, int num_rows)
+/* Ordered dithering, 8 pixels at a time, any number of components */
+{
+  my_cquantize_ptr cquantize = (my_cquantize_ptr)cinfo->cquantize;
+  register _JSAMPROW input_ptr;
+  register _JSAMPROW output_ptr;
+  int nc = cinfo->out_color_components;
+  int ci, k, pixcode;
+  int row;
+  JDIMENSION col;
+  JDIMENSION width = cinfo->output_width;
+#ifdef ODITHER_SIMD_SSE2
+  __m128i thresh[MAX_Q_COMPS][ODITHER_MAX_STEPS];
+  __m128i step[MAX_Q_COMPS][ODITHER_MAX_STEPS];
+  __m128i base[MAX_Q_COMPS];
+  __m128i dither[MAX_Q_COMPS][2];
+  __m128i v, acc, pix;
+  const __m128i zero = _mm_setzero_si128();
+#else
+  int16x8_t thresh[MAX_Q_COMPS][ODITHER_MAX_STEPS];
+  int16x8_t step[MAX_Q_COMPS][ODITHER_MAX_STEPS];
+  int16x8_t base[MAX_Q_COMPS];
+  int16x8_t dither[MAX_Q_COMPS][2];
+  int16x8_t v[MAX_Q_COMPS], acc, pix;
+#endif
+
+  for (ci = 0; ci < nc; ci++) {
+    for (k = 0; k < cquantize->nsteps[ci]; k++) {
+#ifdef ODITHER_SIMD_SSE2
+      thresh[ci][k] = _mm_set1_epi16(cquantize->thresh[ci][k]);
+      step[ci][k] = _mm_set1_epi16(cquantize->step[ci][k]);
+#else
+      thresh[ci][k] = vdupq_n_s16(cquantize->thresh[ci][k]);
+      step[ci][k] = vdupq_n_s16(cquantize->step[ci][k]);
+#endif
+    }
+#ifdef ODITHER_SIMD_SSE2
+    base[ci] = _mm_set1_epi16(cquantize->index_base[ci]);
+#else
+    base[ci] = vdupq_n_s16(cquantize->index_base[ci]);
+#endif
+  }
+
+  for (row = 0; row < num_rows; row++) {
+    input_ptr = input_buf[row];
+    output_ptr = output_buf[row];
+
+    /* One row of the dither matrix is exactly 16 columns, so col_index is
+     * implied by the position within each pair of 8-pixel groups.
+     */
+    for (ci = 0; ci < nc; ci++) {
+      int *dp = cquantize->odither[ci][cquantize->row_index];
+#ifdef ODITHER_SIMD_SSE2
+      dither[ci][0] = _mm_packs_epi32(_mm_loadu_si128((__m128i *)dp),
+                                      _mm_loadu_si128((__m128i *)(dp + 4)));
+      dither[ci][1] = _mm_packs_epi32(_mm_loadu_si128((__m128i *)(dp + 8)),
+                                      _mm_loadu_si128((__m128i *)(dp + 12)));
+#else
+      dither[ci][0] = vcombine_s16(vmovn_s32(vld1q_s32(dp)),
+                                   vmovn_s32(vld1q_s32(dp + 4)));
+      dither[ci][1] = vcombine_s16(vmovn_s32(vld1q_s32(dp + 8)),
+                                   vmovn_s32(vld1q_s32(dp + 12)));
+#endif
+    }
+
+    for (col = 0; col + 8 <= width; col += 8) {
+      _JSAMPROW p = input_ptr + col * nc;
+
+#ifdef ODITHER_SIMD_SSE2
+      pix = zero;
+      for (ci = 0; ci < nc; ci++, p++) {
+        if (nc == 1)
+          v = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i *)p), zero);
+        else
+          v = _mm_setr_epi16(p[0], p[nc], p[2 * nc], p[3 * nc], p[4 * nc],
+                             p[5 * nc], p[6 * nc], p[7 * nc]);
+        v = _mm_add_epi16(v, dither[ci][(col >> 3) & 1]);
+        acc = base[ci];
+        for (k = 0; k < cquantize->nsteps[ci]; k++)
+          acc = _mm_add_epi16(acc, _mm_and_si128(_mm_cmpgt_epi16(v,
+                                                   thresh[ci][k]),
+                                                 step[ci][k]));
+        pix = _mm_add_epi16(pix, acc);
+      }
+      _mm_storel_epi64((__m128i *)(output_ptr + col),
+                       _mm_packus_epi16(pix, pix));
+#else
+      switch (nc) {
+      case 1:
+        v[0] = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(p)));
+        break;
+      case 2: {
+        uint8x8x2_t x = vld2_u8(p);
+        v[0] = vreinterpretq_s16_u16(vmovl_u8(x.val[0]));
+        v[1] = vreinterpretq_s16_u16(vmovl_u8(x.val[1]));
+        break;
+      }
+      case 3: {
+        uint8x8x3_t x = vld3_u8(p);
+        v[0] = vreinterpretq_s16_u16(vmovl_u8(x.val[0]));
+        v[1] = vreinterpretq_s16_u16(vmovl_u8(x.val[1]));
+        v[2] = vreinterpretq_s16_u16(vmovl_u8(x.val[2]));
+        break;
+      }
+      default: {
+        uint8x8x4_t x = vld4_u8(p);
+        v[0] = vreinterpretq_s16_u16(vmovl_u8(x.val[0]));
+        v[1] = vreinterpretq_s16_u16(vmovl_u8(x.val[1]));
+        v[2] = vreinterpretq_s16_u16(vmovl_u8(x.val[2]));
+        v[3] = vreinterpretq_s16_u16(vmovl_u8(x.val[3]));
+        break;
+      }
+      }
+      pix = vdupq_n_s16(0);
+      for (ci = 0; ci < nc; ci++) {
+        int16x8_t d = vaddq_s16(v[ci], dither[ci][(col >> 3) & 1]);
+        acc = base[ci];
+        for (k = 0; k < cquantize->nsteps[ci]; k++)
+          acc = vaddq_s16(acc, vandq_s16(vreinterpretq_s16_u16(
+                                           vcgtq_s16(d, thresh[ci][k])),
+                                         step[ci][k]));
+        pix = vaddq_s16(pix, acc);
+      }
+      vst1_u8(output_ptr + col, vqmovun_s16(pix));
+#endif
+    }
+
+    /* Remaining columns: the padded colorindex absorbs the dither. */
+    for (; col < width; col++) {
+      pixcode = 0;
+      for (ci = 0; ci < nc; ci++)
+        pixcode += cquantize->colorindex[ci][input_ptr[col * nc + ci] +
+                     cquantize->odither[ci][cquantize->row_index]
+                                       [col & ODITHER_MASK]];
+      output_ptr[col] = (_JSAMPLE)pixcode;
+    }
+
+    cquantize->row_index = (cquantize->row_index + 1) & ODITHER_MASK;
+  }
+}
+
+#endif /* ODITHER_SIMD */
+
+
 /*
  * Allocate workspace for Floyd-Steinberg errors.
  */
@@ -700,6 +1001,55 @@ start_pass_1_quant(j_decompress_ptr cinfo, boolean is_pre_scan)
   cinfo->colormap = (JSAMPARRAY)cquantize->sv_colormap;
   cinfo->actual_number_of_colors = cquantize->sv_actual;
 
+  /* Initialize for desired dithering mode. */
+  switch (cinfo->dither_mode) {
+  case JDITHER_NONE:
+    if (cinfo->out_color_components == 3)
+      cquantize->pub._color_quantize = color_quantize3;
+    else
+      cquantize->pub._color_quantize = color_quantize;
+    break;
+  case JDITHER_ORDERED:
+    if (cinfo->out_color_components == 3)
+      cquantize->pub._color_quantize = quantize3_ord_dither;
+    else
+      cquantize->pub._color_quantize = quantize_ord_dither;
+    cquantize->row_index = 0;   /* initialize state for ordered dither */
+    /* If user changed to ordered dither from another mode,
+     * we must recreate the color index table with padding.
+     * This will cost extra space, but probably isn't very likely.
+     */
+    if (!cquantize->is_padded)
+      create_colorindex(cinfo);
+    /* Create ordered-dither tables if we didn't already. */
+    if (cquantize->odither[0] == NULL)
+      create_odither_tables(cinfo);
+#ifdef ODITHER_SIMD
+    /* Use the vector path unless a component has too many colors. */
+    create_odither_thresholds(cinfo);
+    if (cquantize->nsteps[0] >= 0)
+      cquantize->pub._color_quantize = quantize_ord_dither_simd;
+#endif
+    break;
+  case JDITHER_FS:
+    if (cinfo->out_color_components == 3)
+      cquantize->pub._color_quantize = quantize3_fs_dither;
+    else
+      cquantize->pub._color_quantize = quantize_fs_dither;
+    cquantize->on_odd_row = FALSE; /* initialize state for F-S dither */
+    /* Allocate Floyd-Steinberg workspace if didn't already. */
+    if (cquantize->fserrors[0] == NULL)
+      alloc_fs_workspace(cinfo);
+    /* Initialize the propagated errors to zero. */
+    arraysize = (size_t)((cinfo->output_width + 2) * sizeof(FSERROR));
+    for (i = 0; i < cinfo->out_color_components; i++)
+      jzero_far((void *)cquantize->fserrors[i], arraysize);
+    break;
+  default:
+    ERREXIT(cinfo, JERR_NOT_COMPILED);
+    break;
+  }
+
 status = 0;
 
 for (index = 0, item = data->items; index < data->numItems; ++index,